@@ -13,6 +13,9 @@ Rectangle {
     required property string currentFilePath
     required property bool showLineNumbers
 
+    // 使用场景图节点绘制文本（GPU 合成滚动），关闭时由 TextRenderer 自身光栅化
+    property bool sceneGraphRendering: false
+
     // 提供与原 EEditor 兼容的接口
     property alias textRenderer: textRenderer
     property alias document: documentModel
@@ -173,6 +176,12 @@ Rectangle {
             }
         }
 
+        // 场景图渲染层：接管 TextRenderer 的绘制，输入仍由 TextRenderer 处理
+        SceneGraphTextLayer {
+            anchors.fill: textRenderer
+            textRenderer: root.sceneGraphRendering ? textRenderer : null
+        }
+
         TextEditorController {
             id: editorController
             renderer: textRenderer
@@ -0,0 +1,148 @@
+#include "ChangeHistory.h"
+
+ChangeHistory::ChangeHistory(int capacity, qint64 textBudget)
+    : m_records(static_cast<size_t>(qMax(1, capacity)))
+    , m_textBudget(qMax<qint64>(0, textBudget))
+{
+}
+
+// ==============================================================================
+// 写入
+// ==============================================================================
+
+quint64 ChangeHistory::append(int position, int removedLength, const QString& insertedText, qint64 timestamp)
+{
+    const qint64 textLength = insertedText.size();
+    const bool omitText = textLength > m_textBudget;
+
+    // 容量已满时淘汰最旧的记录
+    if (m_count == capacity()) {
+        evictOldest();
+    }
+
+    // 文本区超出预算时继续淘汰，直到能容纳新文本
+    if (!omitText) {
+        while (m_count > 0 && retainedTextLength() + textLength > m_textBudget) {
+            evictOldest();
+        }
+    }
+
+    Record record;
+    record.sequence = m_nextSequence++;
+    record.timestamp = timestamp;
+    record.position = position;
+    record.removedLength = removedLength;
+    record.textLength = static_cast<int>(textLength);
+    record.textOmitted = omitText;
+    record.textOffset = m_arenaBase + m_arena.size();
+
+    if (!omitText && textLength > 0) {
+        m_arena.append(insertedText);
+    }
+
+    int tail = (m_head + m_count) % capacity();
+    m_records[tail] = record;
+    m_count++;
+
+    return record.sequence;
+}
+
+void ChangeHistory::clear()
+{
+    m_head = 0;
+    m_count = 0;
+    m_arena.clear();
+    m_arenaBase = 0;
+    // 序号不重置，保证外部消费者持有的序号仍然单调
+}
+
+// ==============================================================================
+// 查询
+// ==============================================================================
+
+ChangeRecord ChangeHistory::at(int index) const
+{
+    ChangeRecord result;
+    if (index < 0 || index >= m_count)
+        return result;
+
+    const Record& record = recordAt(index);
+    result.sequence = record.sequence;
+    result.timestamp = record.timestamp;
+    result.position = record.position;
+    result.removedLength = record.removedLength;
+    result.insertedLength = record.textLength;
+    result.textOmitted = record.textOmitted;
+
+    if (!record.textOmitted && record.textLength > 0) {
+        qsizetype offset = static_cast<qsizetype>(record.textOffset - m_arenaBase);
+        result.insertedText = QStringView(m_arena).mid(offset, record.textLength);
+    }
+
+    return result;
+}
+
+quint64 ChangeHistory::firstSequence() const
+{
+    if (m_count == 0)
+        return m_nextSequence;
+
+    return recordAt(0).sequence;
+}
+
+ChangeHistory::const_iterator ChangeHistory::since(quint64 sequence) const
+{
+    quint64 first = firstSequence();
+    if (sequence <= first)
+        return begin();
+
+    if (sequence >= m_nextSequence)
+        return end();
+
+    // 序号连续，可以直接换算下标
+    return const_iterator(this, static_cast<int>(sequence - first));
+}
+
+qint64 ChangeHistory::retainedTextLength() const
+{
+    if (m_count == 0)
+        return 0;
+
+    return m_arenaBase + m_arena.size() - recordAt(0).textOffset;
+}
+
+// ==============================================================================
+// 私有辅助方法
+// ==============================================================================
+
+const ChangeHistory::Record& ChangeHistory::recordAt(int index) const
+{
+    return m_records[static_cast<size_t>((m_head + index) % capacity())];
+}
+
+void ChangeHistory::evictOldest()
+{
+    if (m_count == 0)
+        return;
+
+    m_head = (m_head + 1) % capacity();
+    m_count--;
+
+    compactArena();
+}
+
+void ChangeHistory::compactArena()
+{
+    if (m_count == 0) {
+        m_arenaBase += m_arena.size();
+        m_arena.clear();
+        return;
+    }
+
+    // 已淘汰的前缀超过文本区一半时整体前移，均摊后每个字符只移动常数次
+    qint64 dead = recordAt(0).textOffset - m_arenaBase;
+    if (dead > 4096 && dead * 2 > m_arena.size()) {
+        m_arena.remove(0, static_cast<qsizetype>(dead));
+        m_arenaBase += dead;
+    }
+}
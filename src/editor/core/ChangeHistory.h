@@ -0,0 +1,106 @@
+#ifndef CHANGE_HISTORY_H
+#define CHANGE_HISTORY_H
+
+#include <QString>
+#include <QStringView>
+#include <QtGlobal>
+#include <iterator>
+#include <vector>
+
+// 变更记录视图 - 插入文本直接引用历史内部的文本区，不做拷贝
+// 注意：视图仅在下一次 append()/clear() 之前有效
+struct ChangeRecord {
+    quint64 sequence = 0;       // 单调递增的变更序号
+    qint64 timestamp = 0;       // 毫秒时间戳（since epoch）
+    int position = 0;
+    int removedLength = 0;
+    int insertedLength = 0;     // 插入文本的真实长度（即使文本被省略）
+    QStringView insertedText;   // 插入的文本（被省略时为空）
+    bool textOmitted = false;   // 插入文本超过文本区预算，未保留内容
+};
+
+// 固定容量的环形变更历史
+// - 记录本身为紧凑的定长结构，存放在预分配的环形数组中，淘汰最旧记录为 O(1)
+// - 插入文本统一追加到一个文本区（arena），按记录淘汰顺序回收，均摊 O(1)
+class ChangeHistory {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ChangeRecord;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = ChangeRecord;
+
+        const_iterator() = default;
+        const_iterator(const ChangeHistory* history, int index)
+            : m_history(history), m_index(index) {}
+
+        ChangeRecord operator*() const { return m_history->at(m_index); }
+        const_iterator& operator++() { ++m_index; return *this; }
+        const_iterator operator++(int) { const_iterator tmp = *this; ++m_index; return tmp; }
+        bool operator==(const const_iterator& other) const { return m_index == other.m_index && m_history == other.m_history; }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        const ChangeHistory* m_history = nullptr;
+        int m_index = 0;
+    };
+
+    static constexpr int DEFAULT_CAPACITY = 1000;
+    static constexpr qint64 DEFAULT_TEXT_BUDGET = 4 * 1024 * 1024; // 文本区最多保留的字符数
+
+    explicit ChangeHistory(int capacity = DEFAULT_CAPACITY, qint64 textBudget = DEFAULT_TEXT_BUDGET);
+
+    // 追加一条变更，返回其序号；容量满时淘汰最旧的记录
+    quint64 append(int position, int removedLength, const QString& insertedText, qint64 timestamp);
+    void clear();
+
+    // 查询
+    int size() const { return m_count; }
+    int capacity() const { return static_cast<int>(m_records.size()); }
+    bool isEmpty() const { return m_count == 0; }
+    ChangeRecord at(int index) const; // 0 为最旧的记录
+    ChangeRecord last() const { return at(m_count - 1); }
+
+    // 序号范围：[firstSequence, nextSequence)
+    quint64 firstSequence() const;
+    quint64 nextSequence() const { return m_nextSequence; }
+
+    // 迭代
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_count); }
+
+    // 从指定序号开始迭代（序号已被淘汰时从最旧的记录开始）
+    const_iterator since(quint64 sequence) const;
+
+    // 统计
+    qint64 retainedTextLength() const;
+    qint64 arenaSize() const { return m_arena.size(); }
+
+private:
+    struct Record {
+        quint64 sequence = 0;
+        qint64 timestamp = 0;
+        qint64 textOffset = 0; // 文本在 arena 流中的绝对偏移
+        int position = 0;
+        int removedLength = 0;
+        int textLength = 0;
+        bool textOmitted = false;
+    };
+
+    std::vector<Record> m_records;
+    int m_head = 0;   // 最旧记录的下标
+    int m_count = 0;
+    quint64 m_nextSequence = 1;
+
+    QString m_arena;
+    qint64 m_arenaBase = 0;  // m_arena[0] 对应的绝对偏移
+    qint64 m_textBudget;
+
+    const Record& recordAt(int index) const;
+    void evictOldest();
+    void compactArena();
+};
+
+#endif // CHANGE_HISTORY_H
@@ -8,6 +8,26 @@
 #include <QStringConverter>
 #include <QDateTime>
 #include <QTextStream>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QHashFunctions>
+
+namespace {
+// 文件块切分参数：块至少 16KB，之后在行哈希命中掩码的换行处切分，最大 256KB
+constexpr qint64 FILE_BLOCK_MIN_SIZE = 16 * 1024;
+constexpr qint64 FILE_BLOCK_MAX_SIZE = 256 * 1024;
+constexpr size_t FILE_BLOCK_CUT_MASK = 0x7;
+
+// 二进制快照格式
+constexpr quint32 SNAPSHOT_MAGIC = 0x45565346; // "EVSF"
+constexpr quint16 SNAPSHOT_VERSION = 2;     // 2：原始文本指纹改为 SHA-1
+
+enum SnapshotKind : quint8 {
+    SnapshotPieces = 0    // piece 列表 + add buffer，需要同一份原始文本
+};
+}
 
 DocumentModel::DocumentModel(QObject* parent)
     : QObject(parent)
@@ -27,6 +47,23 @@ DocumentModel::DocumentModel(QObject* parent)
         this, [this]() {
             setModified(true);
         });
+
+    // 统计服务监听 textChanged，只重算被编辑的块
+    m_statistics = new DocumentStatistics(this, this);
+
+    // 文件监控：持续写入的日志会连续触发通知，按固定间隔节流处理
+    m_fileWatcher = new QFileSystemWatcher(this);
+    m_fileChangeTimer = new QTimer(this);
+    m_fileChangeTimer->setSingleShot(true);
+    m_fileChangeTimer->setInterval(50);
+    connect(m_fileWatcher, &QFileSystemWatcher::fileChanged,
+        this, [this]() {
+            if (!m_fileChangeTimer->isActive()) {
+                m_fileChangeTimer->start();
+            }
+        });
+    connect(m_fileChangeTimer, &QTimer::timeout,
+        this, &DocumentModel::onWatchedFileChanged);
 }
 
 DocumentModel::~DocumentModel()
@@ -88,6 +125,13 @@ void DocumentModel::setEncoding(Encoding encoding)
 
 void DocumentModel::setModified(bool modified)
 {
+    // 事务期间推迟到提交时统一更新
+    if (m_transactionDepth > 0) {
+        m_hasPendingModified = true;
+        m_pendingModified = modified;
+        return;
+    }
+
     if (m_modified == modified)
         return;
 
@@ -105,6 +149,20 @@ void DocumentModel::setReadOnly(bool readOnly)
     emit readOnlyChanged(m_readOnly);
 }
 
+void DocumentModel::setTailMode(bool enabled)
+{
+    if (m_tailMode == enabled)
+        return;
+
+    m_tailMode = enabled;
+    emit tailModeChanged(m_tailMode);
+
+    // 开启时立即追上文件的最新内容
+    if (m_tailMode && isFileModifiedExternally()) {
+        refreshFromFile();
+    }
+}
+
 // ==============================================================================
 // 文本操作实现
 // ==============================================================================
@@ -122,18 +180,7 @@ void DocumentModel::insertText(int position, const QString& text)
     m_undoSystem->executeCommand(std::move(command));
 
     // 创建变更记录
-    TextChange change;
-    change.position = position;
-    change.removedLength = 0;
-    change.insertedText = text;
-    change.timestamp = QDateTime::currentDateTime();
-
-    m_changeHistory.append(change);
-
-    // 限制历史记录数量
-    if (m_changeHistory.size() > 1000) {
-        m_changeHistory.removeFirst();
-    }
+    recordChange(position, 0, text);
 
     setModified(true);
 }
@@ -155,18 +202,7 @@ void DocumentModel::removeText(int position, int length)
     m_undoSystem->executeCommand(std::move(command));
 
     // 创建变更记录
-    TextChange change;
-    change.position = position;
-    change.removedLength = length;
-    change.insertedText = "";
-    change.timestamp = QDateTime::currentDateTime();
-
-    m_changeHistory.append(change);
-
-    // 限制历史记录数量
-    if (m_changeHistory.size() > 1000) {
-        m_changeHistory.removeFirst();
-    }
+    recordChange(position, length, QString());
 
     setModified(true);
 }
@@ -188,22 +224,18 @@ void DocumentModel::replaceText(int position, int length, const QString& text)
     m_undoSystem->executeCommand(std::move(command));
 
     // 创建变更记录
-    TextChange change;
-    change.position = position;
-    change.removedLength = length;
-    change.insertedText = text;
-    change.timestamp = QDateTime::currentDateTime();
-
-    m_changeHistory.append(change);
-
-    // 限制历史记录数量
-    if (m_changeHistory.size() > 1000) {
-        m_changeHistory.removeFirst();
-    }
+    recordChange(position, length, text);
 
     setModified(true);
 }
 
+void DocumentModel::recordChange(int position, int removedLength, const QString& insertedText)
+{
+    // 环形缓冲区，满时 O(1) 淘汰最旧的记录
+    m_changeHistory.append(position, removedLength, insertedText,
+        QDateTime::currentMSecsSinceEpoch());
+}
+
 QString DocumentModel::getText(int position, int length) const
 {
     if (!m_textStorage)
@@ -302,14 +334,19 @@ bool DocumentModel::canRedo() const
 void DocumentModel::undo()
 {
     if (m_undoSystem && !m_readOnly) {
+        // 批量命令的撤销同样只发出一次变更通知
+        beginDeferredChanges();
         m_undoSystem->undo();
+        endDeferredChanges();
     }
 }
 
 void DocumentModel::redo()
 {
     if (m_undoSystem && !m_readOnly) {
+        beginDeferredChanges();
         m_undoSystem->redo();
+        endDeferredChanges();
     }
 }
 
@@ -339,8 +376,20 @@ bool DocumentModel::loadFromFile(const QString& filePath)
     Encoding detectedEncoding = detectFileEncoding(data);
     setEncoding(detectedEncoding);
 
-    // 转换文本
-    QString text = convertFromEncoding(data, detectedEncoding);
+    // 视图按变更增量更新，需要知道被替换的原文长度
+    int oldLength = textLength();
+
+    // 转换文本；兼容 ASCII 的编码按块解码，同时建立增量重载用的块表
+    QString text;
+    if (detectedEncoding == UTF16) {
+        m_fileBlocks.clear();
+        text = convertFromEncoding(data, detectedEncoding);
+    }
+    else {
+        m_fileBlocks = splitFileBlocks(data);
+        text = decodeFileBlocks(data, m_fileBlocks);
+    }
+    m_loadedFileSize = data.size();
 
     // 判断是否为大文件（超过64MB使用分块存储）
     if (data.size() > 64 * 1024 * 1024) {
@@ -356,6 +405,7 @@ bool DocumentModel::loadFromFile(const QString& filePath)
     // 更新最后修改时间
     QFileInfo fileInfo(filePath);
     m_lastModified = fileInfo.lastModified();
+    watchFile(filePath);
 
     // 清空变更历史
     m_changeHistory.clear();
@@ -366,7 +416,7 @@ bool DocumentModel::loadFromFile(const QString& filePath)
     // 发出文本变更信号
     TextChange change;
     change.position = 0;
-    change.removedLength = 0;
+    change.removedLength = oldLength;
     change.insertedText = text;
     change.timestamp = QDateTime::currentDateTime();
     emit textChanged(change);
@@ -421,6 +471,17 @@ bool DocumentModel::saveToFile(const QString& filePath)
     QFileInfo fileInfo(targetPath);
     m_lastModified = fileInfo.lastModified();
 
+    // 写出的内容即新的磁盘基线
+    m_loadedFileSize = data.size();
+    if (m_encoding == UTF16) {
+        m_fileBlocks.clear();
+    }
+    else {
+        m_fileBlocks = splitFileBlocks(data);
+        decodeFileBlocks(data, m_fileBlocks);
+    }
+    watchFile(targetPath);
+
     return true;
 }
 
@@ -618,21 +679,142 @@ QByteArray DocumentModel::convertToEncoding(const QString& text, Encoding encodi
 }
 
 // ==============================================================================
-// 批量操作支持
+// 编辑事务
 // ==============================================================================
 
-void DocumentModel::beginBatchEdit()
+void DocumentModel::notifyTextChanged(const TextChange& change)
 {
+    if (m_transactionDepth == 0) {
+        emit textChanged(change);
+        return;
+    }
+
+    // 将本次变更并入合并区间：区间外的文本保持不变
+    int insertedLength = change.insertedText.length();
+    int changeEnd = change.position + change.removedLength;
+
+    if (!m_hasPendingChange) {
+        m_hasPendingChange = true;
+        m_pendingStart = change.position;
+        m_pendingEnd = changeEnd;
+        m_pendingDelta = 0;
+    }
+    else {
+        m_pendingStart = qMin(m_pendingStart, change.position);
+        m_pendingEnd = qMax(m_pendingEnd, changeEnd);
+    }
+
+    m_pendingEnd += insertedLength - change.removedLength;
+    m_pendingDelta += insertedLength - change.removedLength;
+    m_pendingOpCount++;
+}
+
+void DocumentModel::beginTransaction(const QString& description)
+{
+    beginDeferredChanges();
+
     if (m_undoSystem) {
-        m_undoSystem->beginBatchEdit();
+        m_undoSystem->beginBatchEdit(description);
     }
 }
 
-void DocumentModel::endBatchEdit()
+void DocumentModel::commitTransaction()
 {
+    if (m_transactionDepth == 0)
+        return;
+
     if (m_undoSystem) {
         m_undoSystem->endBatchEdit();
     }
+
+    endDeferredChanges();
+}
+
+void DocumentModel::rollbackTransaction()
+{
+    if (m_transactionDepth == 0)
+        return;
+
+    // 撤销事务内已执行的命令，整个事务（包括外层）一并放弃
+    if (m_undoSystem) {
+        m_undoSystem->cancelBatchEdit();
+    }
+
+    // 撤销后文本与事务开始时相同：丢弃合并的变更，恢复修改标记，不发出通知也不重绘。
+    // 事务期间重新载入的外部修改无法撤销，仍按合并的变更通知
+    if (!m_pendingExternalChange) {
+        m_hasPendingChange = false;
+        m_pendingOpCount = 0;
+        m_hasPendingModified = true;
+        m_pendingModified = m_modifiedBeforeTransaction;
+    }
+
+    m_transactionDepth = 1;
+    endDeferredChanges();
+}
+
+void DocumentModel::beginDeferredChanges()
+{
+    if (m_transactionDepth++ == 0) {
+        m_hasPendingChange = false;
+        m_pendingOpCount = 0;
+        m_hasPendingModified = false;
+        m_modifiedBeforeTransaction = m_modified;
+        m_pendingExternalChange = false;
+    }
+}
+
+void DocumentModel::endDeferredChanges()
+{
+    if (m_transactionDepth == 0)
+        return;
+
+    if (--m_transactionDepth == 0) {
+        flushDeferredChanges();
+    }
+}
+
+void DocumentModel::flushDeferredChanges()
+{
+    int operationCount = m_pendingOpCount;
+
+    if (m_hasPendingModified) {
+        m_hasPendingModified = false;
+        setModified(m_pendingModified);
+    }
+
+    if (m_hasPendingChange) {
+        m_hasPendingChange = false;
+
+        // 一次性生成合并后的变更：[start, end - delta) 被替换为 [start, end)
+        TextChange change;
+        change.position = m_pendingStart;
+        change.removedLength = m_pendingEnd - m_pendingDelta - m_pendingStart;
+        change.insertedText = getText(m_pendingStart, m_pendingEnd - m_pendingStart);
+        change.timestamp = QDateTime::currentDateTime();
+
+        emit textChanged(change);
+    }
+
+    m_pendingOpCount = 0;
+
+    if (operationCount > 0) {
+        emit transactionCommitted(operationCount);
+    }
+}
+
+// ==============================================================================
+// 批量操作支持
+// ==============================================================================
+
+void DocumentModel::beginBatchEdit()
+{
+    beginTransaction();
+}
+
+void DocumentModel::endBatchEdit()
+{
+    commitTransaction();
 }
 
 // ==============================================================================
@@ -646,32 +828,16 @@ int DocumentModel::getCharacterCount() const
 
 int DocumentModel::getWordCount() const
 {
-    QString text = getFullText();
-    if (text.isEmpty())
-        return 0;
-
-    // 简单的单词计数
-    QRegularExpression wordRegex("\\b\\w+\\b");
-    QRegularExpressionMatchIterator iterator = wordRegex.globalMatch(text);
-
-    int count = 0;
-    while (iterator.hasNext()) {
-        iterator.next();
-        count++;
-    }
-
-    return count;
+    // 只有失效的块会被重新计算
+    m_statistics->refreshNow();
+    return m_statistics->wordCount();
 }
 
 int DocumentModel::getParagraphCount() const
 {
-    QString text = getFullText();
-    if (text.isEmpty())
-        return 0;
-
-    // 计算段落数（以双换行符分隔）
-    QStringList paragraphs = text.split(QRegularExpression("\\n\\s*\\n"), Qt::SkipEmptyParts);
-    return paragraphs.size();
+    // 段落：以空行分隔的连续非空行
+    m_statistics->refreshNow();
+    return m_statistics->paragraphCount();
 }
 
 // ==============================================================================
@@ -710,6 +876,7 @@ bool DocumentModel::restoreFromSnapshot(const QString& snapshot)
         return false;
 
     // 从快照恢复文档
+    int oldLength = textLength();
     m_textStorage = std::make_unique<PieceTable>(snapshot);
     clearUndoHistory();
     setModified(true);
@@ -717,7 +884,7 @@ bool DocumentModel::restoreFromSnapshot(const QString& snapshot)
     // 发出文本变更信号
     TextChange change;
     change.position = 0;
-    change.removedLength = 0;
+    change.removedLength = oldLength;
     change.insertedText = snapshot;
     change.timestamp = QDateTime::currentDateTime();
     emit textChanged(change);
@@ -725,6 +892,110 @@ bool DocumentModel::restoreFromSnapshot(const QString& snapshot)
     return true;
 }
 
+QByteArray DocumentModel::createBinarySnapshot() const
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    out << SNAPSHOT_MAGIC << SNAPSHOT_VERSION;
+
+    // Piece Table 只写增量，大小与编辑量成正比而不是与文档大小成正比；
+    // 分块存储的大文件没有 piece 列表，不退化为完整文本，由调用方改用其他方式保存
+    auto* pieceTable = dynamic_cast<const PieceTable*>(m_textStorage.get());
+    if (!pieceTable) {
+        qWarning() << "当前文档的存储方式不支持二进制快照";
+        return QByteArray();
+    }
+
+    out << quint8(SnapshotPieces);
+    pieceTable->writeSnapshot(out);
+
+    return data;
+}
+
+bool DocumentModel::restoreFromBinarySnapshot(const QByteArray& snapshot)
+{
+    if (m_readOnly)
+        return false;
+
+    QDataStream in(snapshot);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint8 kind = 0;
+    in >> magic >> version >> kind;
+
+    if (in.status() != QDataStream::Ok || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION) {
+        qWarning() << "无效的快照数据";
+        return false;
+    }
+
+    if (kind != SnapshotPieces) {
+        qWarning() << "未知的快照类型:" << kind;
+        return false;
+    }
+
+    auto* pieceTable = dynamic_cast<PieceTable*>(m_textStorage.get());
+    if (!pieceTable) {
+        qWarning() << "当前文档的存储方式不支持二进制快照";
+        return false;
+    }
+
+    PieceTable::SnapshotChange restored;
+    if (!pieceTable->readSnapshot(in, &restored))
+        return false;
+
+    clearUndoHistory();
+    setModified(true);
+
+    // 只通知与恢复前不同的范围，视图按普通编辑增量更新
+    if (restored.removedLength > 0 || restored.insertedLength > 0) {
+        TextChange change;
+        change.position = restored.position;
+        change.removedLength = restored.removedLength;
+        change.insertedText = getText(restored.position, restored.insertedLength);
+        change.timestamp = QDateTime::currentDateTime();
+        notifyTextChanged(change);
+    }
+
+    return true;
+}
+
+bool DocumentModel::supportsBinarySnapshot() const
+{
+    return dynamic_cast<const PieceTable*>(m_textStorage.get()) != nullptr;
+}
+
+bool DocumentModel::saveSnapshotToFile(const QString& filePath) const
+{
+    // 原子写入，避免崩溃时留下半个快照
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "无法写入快照文件:" << filePath;
+        return false;
+    }
+
+    const QByteArray snapshot = createBinarySnapshot();
+    if (snapshot.isEmpty())
+        return false;
+
+    file.write(snapshot);
+    return file.commit();
+}
+
+bool DocumentModel::restoreSnapshotFromFile(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "无法读取快照文件:" << filePath;
+        return false;
+    }
+
+    return restoreFromBinarySnapshot(file.readAll());
+}
+
 // ==============================================================================
 // 文件监控相关
 // ==============================================================================
@@ -738,7 +1009,8 @@ bool DocumentModel::isFileModifiedExternally() const
     if (!fileInfo.exists())
         return true; // 文件被删除
 
-    return fileInfo.lastModified() > m_lastModified;
+    // 修改时间精度可能只有秒级，同时比较大小以免漏掉快速追加
+    return fileInfo.lastModified() > m_lastModified || fileInfo.size() != m_loadedFileSize;
 }
 
 void DocumentModel::refreshFromFile()
@@ -752,5 +1024,287 @@ void DocumentModel::refreshFromFile()
         return;
     }
 
-    loadFromFile(m_filePath);
-}
\ No newline at end of file
+    if (!reloadIncrementally()) {
+        loadFromFile(m_filePath);
+    }
+}
+
+void DocumentModel::watchFile(const QString& filePath)
+{
+    const QStringList watched = m_fileWatcher->files();
+    if (!watched.isEmpty()) {
+        m_fileWatcher->removePaths(watched);
+    }
+
+    if (!filePath.isEmpty()) {
+        m_fileWatcher->addPath(filePath);
+    }
+}
+
+void DocumentModel::onWatchedFileChanged()
+{
+    // 以"写临时文件再重命名"方式保存的文件会从监视列表中移除
+    if (!m_filePath.isEmpty() && QFileInfo::exists(m_filePath) &&
+        !m_fileWatcher->files().contains(m_filePath)) {
+        m_fileWatcher->addPath(m_filePath);
+    }
+
+    // 自身保存也会触发通知
+    if (!isFileModifiedExternally())
+        return;
+
+    if (m_tailMode && !m_modified) {
+        refreshFromFile();
+    }
+    else {
+        emit fileModifiedExternally();
+    }
+}
+
+bool DocumentModel::reloadIncrementally()
+{
+    // UTF-16 中换行字节可能位于其他字符内部，无法按字节块对齐
+    if (!m_textStorage || m_encoding == UTF16)
+        return false;
+
+    // 块表必须与当前文本一致
+    qint64 knownChars = 0;
+    for (const FileBlock& block : m_fileBlocks) {
+        knownChars += block.charLength;
+    }
+    if (knownChars != textLength())
+        return false;
+
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    qint64 newSize = file.size();
+
+    // 只有跟随模式信任写入方只追加，文件变大时走只读首尾块的快速路径；
+    // 其余情况（包括手动刷新）都按块哈希比对整个文件，纯追加同样只插入新增部分
+    bool reloaded = m_tailMode && newSize > m_loadedFileSize && reloadAppended(file, newSize);
+    if (!reloaded) {
+        reloaded = reloadChangedBlocks(file);
+    }
+
+    if (reloaded) {
+        m_loadedFileSize = newSize;
+        m_lastModified = QFileInfo(m_filePath).lastModified();
+    }
+
+    return reloaded;
+}
+
+bool DocumentModel::reloadAppended(QFile& file, qint64 newSize)
+{
+    // 首块和末块都未变化即视为只追加，只需读取 O(块) 字节。
+    // 中间块不做校验：写入方同时改动了中间内容时这些改动不会被载入，只用于跟随模式
+    FileBlock lastBlock;
+    qint64 tailStart = 0;
+
+    if (!m_fileBlocks.isEmpty()) {
+        const FileBlock& firstBlock = m_fileBlocks.first();
+        if (m_fileBlocks.size() > 1) {
+            if (!file.seek(0))
+                return false;
+            QByteArray head = file.read(firstBlock.byteLength);
+            if (head.size() != firstBlock.byteLength ||
+                qHashBits(head.constData(), head.size()) != firstBlock.hash)
+                return false;
+        }
+
+        lastBlock = m_fileBlocks.last();
+        tailStart = m_loadedFileSize - lastBlock.byteLength;
+    }
+
+    // 末块可能以不完整的行结尾，连同新增字节一起重新切分
+    if (!file.seek(tailStart))
+        return false;
+
+    QByteArray tail = file.read(newSize - tailStart);
+    if (tail.size() != newSize - tailStart)
+        return false;
+
+    if (!m_fileBlocks.isEmpty() &&
+        qHashBits(tail.constData(), lastBlock.byteLength) != lastBlock.hash)
+        return false;
+
+    // ASCII 文档追加了非 ASCII 内容时需要重新检测编码
+    if (m_encoding == ASCII) {
+        for (qsizetype i = lastBlock.byteLength; i < tail.size(); ++i) {
+            if (static_cast<unsigned char>(tail[i]) > 127)
+                return false;
+        }
+    }
+
+    QList<FileBlock> blocks = splitFileBlocks(tail);
+    QString text = decodeFileBlocks(tail, blocks);
+
+    int tailPosition = textLength() - lastBlock.charLength;
+    QString oldTail = getText(tailPosition, lastBlock.charLength);
+
+    TextChange change;
+    if (text.startsWith(oldTail)) {
+        // 原末块文本不变，只插入新增部分
+        change.position = textLength();
+        change.removedLength = 0;
+        change.insertedText = text.mid(oldTail.length());
+        insertTextDirect(change.position, change.insertedText);
+    }
+    else {
+        // 原末块以不完整的字符结尾，连同新内容一起替换
+        change.position = tailPosition;
+        change.removedLength = lastBlock.charLength;
+        change.insertedText = text;
+        replaceTextDirect(change.position, change.removedLength, change.insertedText);
+    }
+
+    if (!m_fileBlocks.isEmpty()) {
+        m_fileBlocks.removeLast();
+    }
+    m_fileBlocks.append(blocks);
+
+    if (change.removedLength > 0 || !change.insertedText.isEmpty()) {
+        recordChange(change.position, change.removedLength, change.insertedText);
+        change.timestamp = QDateTime::currentDateTime();
+        m_pendingExternalChange = m_pendingExternalChange || m_transactionDepth > 0;
+        notifyTextChanged(change);
+    }
+
+    return true;
+}
+
+bool DocumentModel::reloadChangedBlocks(QFile& file)
+{
+    if (!file.seek(0))
+        return false;
+
+    QByteArray data = file.readAll();
+
+    // 编码变化时整体重新加载
+    if (detectFileEncoding(data) != m_encoding)
+        return false;
+
+    QList<FileBlock> blocks = splitFileBlocks(data);
+
+    auto sameBlock = [](const FileBlock& a, const FileBlock& b) {
+        return a.byteLength == b.byteLength && a.hash == b.hash;
+    };
+
+    // 找出首尾未变化的块
+    int oldCount = m_fileBlocks.size();
+    int newCount = blocks.size();
+
+    int prefix = 0;
+    while (prefix < oldCount && prefix < newCount && sameBlock(m_fileBlocks[prefix], blocks[prefix])) {
+        prefix++;
+    }
+
+    int suffix = 0;
+    while (suffix < oldCount - prefix && suffix < newCount - prefix &&
+        sameBlock(m_fileBlocks[oldCount - 1 - suffix], blocks[newCount - 1 - suffix])) {
+        suffix++;
+    }
+
+    if (prefix == oldCount && prefix == newCount)
+        return true;
+
+    // 未变化的块直接沿用字符数，只解码中间变化的块
+    qint64 byteStart = 0;
+    int charStart = 0;
+    for (int i = 0; i < prefix; ++i) {
+        blocks[i].charLength = m_fileBlocks[i].charLength;
+        byteStart += blocks[i].byteLength;
+        charStart += blocks[i].charLength;
+    }
+
+    for (int i = 0; i < suffix; ++i) {
+        blocks[newCount - 1 - i].charLength = m_fileBlocks[oldCount - 1 - i].charLength;
+    }
+
+    int removedChars = 0;
+    for (int i = prefix; i < oldCount - suffix; ++i) {
+        removedChars += m_fileBlocks[i].charLength;
+    }
+
+    QList<FileBlock> changedBlocks = blocks.mid(prefix, newCount - suffix - prefix);
+    qint64 byteLength = 0;
+    for (const FileBlock& block : changedBlocks) {
+        byteLength += block.byteLength;
+    }
+
+    QByteArray changedData = QByteArray::fromRawData(data.constData() + byteStart, byteLength);
+    QString text = decodeFileBlocks(changedData, changedBlocks);
+
+    for (int i = 0; i < changedBlocks.size(); ++i) {
+        blocks[prefix + i].charLength = changedBlocks[i].charLength;
+    }
+
+    replaceTextDirect(charStart, removedChars, text);
+    m_fileBlocks = blocks;
+
+    // 外部修改使撤销记录中的位置失效
+    clearUndoHistory();
+
+    recordChange(charStart, removedChars, text);
+
+    TextChange change;
+    change.position = charStart;
+    change.removedLength = removedChars;
+    change.insertedText = text;
+    change.timestamp = QDateTime::currentDateTime();
+    m_pendingExternalChange = m_pendingExternalChange || m_transactionDepth > 0;
+    notifyTextChanged(change);
+
+    return true;
+}
+
+QString DocumentModel::decodeFileBlocks(const QByteArray& data, QList<FileBlock>& blocks) const
+{
+    // 块都在换行处结束，兼容 ASCII 的编码可以逐块独立解码
+    QString text;
+    qint64 offset = 0;
+
+    for (FileBlock& block : blocks) {
+        QByteArray bytes = QByteArray::fromRawData(data.constData() + offset, block.byteLength);
+        QString blockText = convertFromEncoding(bytes, m_encoding);
+        block.charLength = blockText.length();
+        text += blockText;
+        offset += block.byteLength;
+    }
+
+    return text;
+}
+
+QList<DocumentModel::FileBlock> DocumentModel::splitFileBlocks(const QByteArray& data)
+{
+    QList<FileBlock> blocks;
+    qsizetype blockStart = 0;
+    qsizetype lineStart = 0;
+
+    while (lineStart < data.size()) {
+        qsizetype newline = data.indexOf('\n', lineStart);
+        qsizetype lineEnd = newline == -1 ? data.size() : newline + 1;
+        qsizetype blockSize = lineEnd - blockStart;
+
+        // 达到最小块大小后，由行内容决定是否在此处切分
+        bool cut = lineEnd == data.size();
+        if (!cut && blockSize >= FILE_BLOCK_MIN_SIZE) {
+            size_t lineHash = qHashBits(data.constData() + lineStart, lineEnd - lineStart);
+            cut = (lineHash & FILE_BLOCK_CUT_MASK) == 0 || blockSize >= FILE_BLOCK_MAX_SIZE;
+        }
+
+        if (cut) {
+            FileBlock block;
+            block.byteLength = blockSize;
+            block.hash = qHashBits(data.constData() + blockStart, blockSize);
+            blocks.append(block);
+            blockStart = lineEnd;
+        }
+
+        lineStart = lineEnd;
+    }
+
+    return blocks;
+}
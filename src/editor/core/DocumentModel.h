@@ -3,6 +3,8 @@
 
 #include "TextStorage.h"
 #include "UndoSystem.h"
+#include "ChangeHistory.h"
+#include "DocumentStatistics.h"
 #include <QObject>
 #include <QUrl>
 #include <QDateTime>
@@ -10,6 +12,10 @@
 #include <qqmlintegration.h>
 #include <memory>
 
+class QFileSystemWatcher;
+class QTimer;
+class QFile;
+
 //class DocumentModel;
 
 // 声明不透明指针类型
@@ -43,6 +49,8 @@ class DocumentModel : public QObject {
     Q_PROPERTY(QString fullText READ getFullText NOTIFY textChanged)
     Q_PROPERTY(bool canUndo READ canUndo NOTIFY undoAvailable)
     Q_PROPERTY(bool canRedo READ canRedo NOTIFY redoAvailable)
+    Q_PROPERTY(DocumentStatistics* statistics READ statistics CONSTANT)
+    Q_PROPERTY(bool tailMode READ tailMode WRITE setTailMode NOTIFY tailModeChanged)
 
 public:
     enum DocumentType {
@@ -67,7 +75,27 @@ private:
     bool m_modified;
     bool m_readOnly;
     QDateTime m_lastModified;
-    QList<TextChange> m_changeHistory;
+    ChangeHistory m_changeHistory;
+    DocumentStatistics* m_statistics = nullptr;
+
+    // 记录变更到环形历史
+    void recordChange(int position, int removedLength, const QString& insertedText);
+
+    // 编辑事务：事务期间只改动存储，变更在提交时合并为一次通知
+    int m_transactionDepth = 0;
+    bool m_hasPendingChange = false;
+    int m_pendingStart = 0;      // 合并变更的起点
+    int m_pendingEnd = 0;        // 合并变更在当前文本中的终点
+    int m_pendingDelta = 0;      // 累计长度变化
+    int m_pendingOpCount = 0;
+    bool m_hasPendingModified = false;
+    bool m_pendingModified = false;
+    bool m_modifiedBeforeTransaction = false;   // 回滚时恢复
+    bool m_pendingExternalChange = false;       // 事务期间有无法撤销的外部文件变化
+
+    void beginDeferredChanges();
+    void endDeferredChanges();
+    void flushDeferredChanges();
 
     // Qt6 编码相关的私有方法
     Encoding detectFileEncoding(const QByteArray& data) const;
@@ -75,9 +103,28 @@ private:
     QByteArray convertToEncoding(const QString& text, Encoding encoding) const;
     QStringConverter::Encoding encodingToQt(Encoding encoding) const;
 
-    // 文件监控相关
-    bool isFileModifiedExternally() const;
-    void refreshFromFile();
+    // 文件监控与增量重载
+    // 文件按内容切分为以换行结尾的块，记录每块的字节数、字符数和哈希；
+    // 块边界只取决于块内的行内容，插入或删除之后的块能重新对齐
+    struct FileBlock {
+        qint64 byteLength = 0;
+        int charLength = 0;
+        size_t hash = 0;
+    };
+
+    QFileSystemWatcher* m_fileWatcher = nullptr;
+    QTimer* m_fileChangeTimer = nullptr;
+    QList<FileBlock> m_fileBlocks;
+    qint64 m_loadedFileSize = 0;
+    bool m_tailMode = false;
+
+    void watchFile(const QString& filePath);
+    void onWatchedFileChanged();
+    bool reloadIncrementally();
+    bool reloadAppended(QFile& file, qint64 newSize);
+    bool reloadChangedBlocks(QFile& file);
+    QString decodeFileBlocks(const QByteArray& data, QList<FileBlock>& blocks) const;
+    static QList<FileBlock> splitFileBlocks(const QByteArray& data);
 
 public:
     explicit DocumentModel(QObject* parent = nullptr);
@@ -99,6 +146,11 @@ public:
     bool isReadOnly() const { return m_readOnly; }
     void setReadOnly(bool readOnly);
 
+    // 跟随模式：文件变化时自动增量重载（类似 tail -f）。
+    // 假定写入方只在末尾追加：文件变大且首尾块未变时只读取新增字节，不校验中间内容
+    bool tailMode() const { return m_tailMode; }
+    void setTailMode(bool enabled);
+
     // 文本操作
     Q_INVOKABLE void insertText(int position, const QString& text);
     Q_INVOKABLE void removeText(int position, int length);
@@ -125,20 +177,37 @@ public:
     Q_INVOKABLE bool loadFromFile(const QString& filePath);
     Q_INVOKABLE bool saveToFile(const QString& filePath = QString());
 
+    // 文件监控：按块哈希只替换变化的区域；跟随模式下只追加的增长只读取新增字节
+    Q_INVOKABLE bool isFileModifiedExternally() const;
+    Q_INVOKABLE void refreshFromFile();
+
     // 搜索
     Q_INVOKABLE QList<int> findText(const QString& pattern, bool caseSensitive = false, bool wholeWords = false) const;
 
+    // 最近变更记录（只读访问，迭代时不拷贝文本）
+    const ChangeHistory& changeHistory() const { return m_changeHistory; }
+
     // 撤销系统专用方法 - 直接操作存储，不触发撤销命令
     void insertTextDirect(int position, const QString& text);
     void removeTextDirect(int position, int length);
     void replaceTextDirect(int position, int length, const QString& text);
     QString getTextDirect(int position, int length) const;
 
-    // 批量操作支持
+    // 变更通知 - 事务期间合并，否则立即发出 textChanged
+    void notifyTextChanged(const TextChange& change);
+
+    // 编辑事务
+    Q_INVOKABLE void beginTransaction(const QString& description = QString());
+    Q_INVOKABLE void commitTransaction();
+    Q_INVOKABLE void rollbackTransaction();
+    Q_INVOKABLE bool isInTransaction() const { return m_transactionDepth > 0; }
+
+    // 批量操作支持（等价于编辑事务）
     Q_INVOKABLE void beginBatchEdit();
     Q_INVOKABLE void endBatchEdit();
 
-    // 统计信息
+    // 统计信息（增量、并行计算；状态栏可直接绑定 statistics 的属性）
+    DocumentStatistics* statistics() const { return m_statistics; }
     Q_INVOKABLE int getCharacterCount() const;
     Q_INVOKABLE int getWordCount() const;
     Q_INVOKABLE int getParagraphCount() const;
@@ -152,6 +221,15 @@ public:
     Q_INVOKABLE QString createSnapshot() const;
     Q_INVOKABLE bool restoreFromSnapshot(const QString& snapshot);
 
+    // 二进制快照：只记录 piece 列表和相对原始文件的 add buffer，创建和恢复都是 O(pieces)，
+    // 恢复时只通知变化的范围。只支持 Piece Table 存储；分块存储的大文件
+    // （supportsBinarySnapshot() 为 false）创建时返回空数组，保存和恢复返回 false
+    Q_INVOKABLE bool supportsBinarySnapshot() const;
+    Q_INVOKABLE QByteArray createBinarySnapshot() const;
+    Q_INVOKABLE bool restoreFromBinarySnapshot(const QByteArray& snapshot);
+    Q_INVOKABLE bool saveSnapshotToFile(const QString& filePath) const;
+    Q_INVOKABLE bool restoreSnapshotFromFile(const QString& filePath);
+
 signals:
     void textChanged(const TextChange& change);
     void modifiedChanged(bool modified);
@@ -160,6 +238,9 @@ signals:
     void filePathChanged(const QString& filePath);
     void undoAvailable(bool available);
     void redoAvailable(bool available);
+    void transactionCommitted(int operationCount);
+    void tailModeChanged(bool enabled);
+    void fileModifiedExternally();
 };
 
 #endif // DOCUMENT_MODEL_H
\ No newline at end of file
@@ -0,0 +1,315 @@
+#include "LineIndex.h"
+#include <QList>
+#include <algorithm>
+
+LineIndex::LineIndex()
+{
+    m_chunks.push_back(Chunk{ { 0 }, 0 });
+}
+
+// ==============================================================================
+// 构建与编辑
+// ==============================================================================
+
+void LineIndex::build(const QString& text)
+{
+    m_chunks.clear();
+    m_chunks.push_back(Chunk());
+    m_lineCount = 0;
+    m_length = static_cast<int>(text.length());
+
+    int lineStart = 0;
+    auto appendLine = [this](int length) {
+        if (static_cast<int>(m_chunks.back().lengths.size()) >= CHUNK_LINES) {
+            m_chunks.push_back(Chunk());
+        }
+        Chunk& chunk = m_chunks.back();
+        chunk.lengths.push_back(length);
+        chunk.characters += length;
+        m_lineCount++;
+    };
+
+    for (int i = 0; i < text.length(); ++i) {
+        if (text[i] == '\n') {
+            appendLine(i + 1 - lineStart);
+            lineStart = i + 1;
+        }
+    }
+    appendLine(m_length - lineStart);
+
+    m_treeDirty = true;
+}
+
+void LineIndex::insert(int position, const QString& text)
+{
+    if (text.isEmpty())
+        return;
+
+    int offset = 0;
+    int column = 0;
+    int chunkIndex = locatePosition(position, &offset, &column);
+    Chunk& chunk = m_chunks[chunkIndex];
+
+    // 插入文本中的换行把所在行拆开：第一段接在原行的 column 之前，最后一段接上原行的剩余部分
+    const int originalLength = chunk.lengths[offset];
+    const int textLength = static_cast<int>(text.length());
+    std::vector<int> newLines;
+    int firstLength = -1;
+    int segmentStart = 0;
+
+    for (int i = 0; i < textLength; ++i) {
+        if (text[i] != '\n')
+            continue;
+
+        if (firstLength < 0) {
+            firstLength = column + i + 1;
+        }
+        else {
+            newLines.push_back(i + 1 - segmentStart);
+        }
+        segmentStart = i + 1;
+    }
+
+    if (firstLength < 0) {
+        chunk.lengths[offset] += textLength;
+    }
+    else {
+        chunk.lengths[offset] = firstLength;
+        newLines.push_back(textLength - segmentStart + originalLength - column);
+        chunk.lengths.insert(chunk.lengths.begin() + offset + 1, newLines.begin(), newLines.end());
+    }
+
+    const int addedLines = firstLength < 0 ? 0 : static_cast<int>(newLines.size());
+    m_lineCount += addedLines;
+    m_length += textLength;
+    addToChunk(chunkIndex, addedLines, textLength);
+
+    if (static_cast<int>(chunk.lengths.size()) > CHUNK_CAPACITY) {
+        splitChunk(chunkIndex);
+    }
+}
+
+void LineIndex::remove(int position, int length)
+{
+    position = qBound(0, position, m_length);
+    length = qMin(length, m_length - position);
+    if (length <= 0)
+        return;
+
+    int firstOffset = 0;
+    int firstColumn = 0;
+    int firstChunk = locatePosition(position, &firstOffset, &firstColumn);
+
+    int lastOffset = 0;
+    int lastColumn = 0;
+    int lastChunk = locatePosition(position + length, &lastOffset, &lastColumn);
+
+    m_length -= length;
+
+    // 删除范围在一行之内
+    if (firstChunk == lastChunk && firstOffset == lastOffset) {
+        m_chunks[firstChunk].lengths[firstOffset] -= length;
+        addToChunk(firstChunk, 0, -length);
+        return;
+    }
+
+    // 起始行保留 firstColumn 之前的部分，接上结束行 lastColumn 之后的部分
+    const int mergedLength = firstColumn + m_chunks[lastChunk].lengths[lastOffset] - lastColumn;
+    Chunk& first = m_chunks[firstChunk];
+    addToChunk(firstChunk, 0, mergedLength - first.lengths[firstOffset]);
+    first.lengths[firstOffset] = mergedLength;
+
+    // 删除起始行之后到结束行（含）的各行，顺序处理受影响的块
+    int remaining = 0;
+    for (int i = firstChunk; i < lastChunk; ++i) {
+        remaining += static_cast<int>(m_chunks[i].lengths.size());
+    }
+    remaining += lastOffset - firstOffset;
+
+    int chunkIndex = firstChunk;
+    int offset = firstOffset + 1;
+    while (remaining > 0 && chunkIndex < static_cast<int>(m_chunks.size())) {
+        Chunk& chunk = m_chunks[chunkIndex];
+        int removed = qMin(remaining, static_cast<int>(chunk.lengths.size()) - offset);
+
+        if (removed > 0) {
+            auto begin = chunk.lengths.begin() + offset;
+            int characters = 0;
+            for (auto it = begin; it != begin + removed; ++it) {
+                characters += *it;
+            }
+            chunk.lengths.erase(begin, begin + removed);
+
+            addToChunk(chunkIndex, -removed, -characters);
+            remaining -= removed;
+            m_lineCount -= removed;
+        }
+
+        if (chunk.lengths.empty()) {
+            m_chunks.erase(m_chunks.begin() + chunkIndex);
+            m_treeDirty = true;
+        }
+        else {
+            chunkIndex++;
+        }
+
+        offset = 0;
+    }
+
+    mergeSmallChunks(qMax(0, firstChunk - 1));
+}
+
+// ==============================================================================
+// 查询
+// ==============================================================================
+
+int LineIndex::lineStart(int line) const
+{
+    int offset = 0;
+    int chunkIndex = locateLine(line, &offset);
+    if (chunkIndex < 0)
+        return 0;
+
+    const Chunk& chunk = m_chunks[chunkIndex];
+    int start = m_characterTree.prefixSum(chunkIndex);
+    for (int i = 0; i < offset; ++i) {
+        start += chunk.lengths[i];
+    }
+    return start;
+}
+
+int LineIndex::lineLength(int line) const
+{
+    int offset = 0;
+    int chunkIndex = locateLine(line, &offset);
+    if (chunkIndex < 0)
+        return 0;
+
+    // 除最后一行外都含换行符
+    return m_chunks[chunkIndex].lengths[offset] - (line < m_lineCount - 1 ? 1 : 0);
+}
+
+int LineIndex::lineAt(int position) const
+{
+    int offset = 0;
+    int column = 0;
+    int chunkIndex = locatePosition(position, &offset, &column);
+    return m_lineTree.prefixSum(chunkIndex) + offset;
+}
+
+// ==============================================================================
+// 块与块级索引
+// ==============================================================================
+
+void LineIndex::ensureTrees() const
+{
+    if (!m_treeDirty)
+        return;
+
+    QList<int> lineCounts;
+    QList<int> characters;
+    lineCounts.reserve(static_cast<qsizetype>(m_chunks.size()));
+    characters.reserve(static_cast<qsizetype>(m_chunks.size()));
+    for (const Chunk& chunk : m_chunks) {
+        lineCounts.append(static_cast<int>(chunk.lengths.size()));
+        characters.append(chunk.characters);
+    }
+
+    m_lineTree.build(lineCounts);
+    m_characterTree.build(characters);
+    m_treeDirty = false;
+}
+
+int LineIndex::locateLine(int line, int* offset) const
+{
+    *offset = 0;
+    if (line < 0 || line >= m_lineCount)
+        return -1;
+
+    ensureTrees();
+
+    int chunkIndex = m_lineTree.findIndex(line);
+    *offset = line - m_lineTree.prefixSum(chunkIndex);
+    return chunkIndex;
+}
+
+int LineIndex::locatePosition(int position, int* offset, int* column) const
+{
+    ensureTrees();
+
+    // 块内除最后一块外每行都以换行结尾，块的字符数不为 0；
+    // 位置恰好在块边界时属于后一块的第一行，文本末尾属于最后一块
+    position = qBound(0, position, m_length);
+    int chunkIndex = m_characterTree.findIndex(position);
+    int remaining = position - m_characterTree.prefixSum(chunkIndex);
+
+    const Chunk& chunk = m_chunks[chunkIndex];
+    const int lastLine = static_cast<int>(chunk.lengths.size()) - 1;
+    int line = 0;
+    while (line < lastLine && remaining >= chunk.lengths[line]) {
+        remaining -= chunk.lengths[line];
+        line++;
+    }
+
+    *offset = line;
+    *column = remaining;
+    return chunkIndex;
+}
+
+void LineIndex::addToChunk(int chunkIndex, int lines, int characters)
+{
+    m_chunks[chunkIndex].characters += characters;
+
+    // 结构已变化时等下次查询整体重建
+    if (!m_treeDirty) {
+        if (lines != 0) {
+            m_lineTree.add(chunkIndex, lines);
+        }
+        m_characterTree.add(chunkIndex, characters);
+    }
+}
+
+void LineIndex::splitChunk(int chunkIndex)
+{
+    // 一次粘贴可能带来很多行，按目标行数切成若干块
+    Chunk chunk = std::move(m_chunks[chunkIndex]);
+    std::vector<Chunk> parts;
+
+    for (size_t begin = 0; begin < chunk.lengths.size(); begin += CHUNK_LINES) {
+        size_t end = qMin(begin + CHUNK_LINES, chunk.lengths.size());
+        Chunk part;
+        part.lengths.assign(chunk.lengths.begin() + begin, chunk.lengths.begin() + end);
+        for (int length : part.lengths) {
+            part.characters += length;
+        }
+        parts.push_back(std::move(part));
+    }
+
+    m_chunks.erase(m_chunks.begin() + chunkIndex);
+    m_chunks.insert(m_chunks.begin() + chunkIndex,
+        std::make_move_iterator(parts.begin()), std::make_move_iterator(parts.end()));
+    m_treeDirty = true;
+}
+
+void LineIndex::mergeSmallChunks(int chunkIndex)
+{
+    // 检查删除位置附近的块，过小的块并入相邻块
+    int end = qMin(chunkIndex + 2, static_cast<int>(m_chunks.size()) - 1);
+
+    for (int i = end; i > chunkIndex && i > 0; --i) {
+        Chunk& previous = m_chunks[i - 1];
+        Chunk& current = m_chunks[i];
+
+        const int previousLines = static_cast<int>(previous.lengths.size());
+        const int currentLines = static_cast<int>(current.lengths.size());
+        bool tooSmall = previousLines < CHUNK_LINES / 4 || currentLines < CHUNK_LINES / 4;
+        if (!tooSmall || previousLines + currentLines > CHUNK_CAPACITY)
+            continue;
+
+        previous.lengths.insert(previous.lengths.end(), current.lengths.begin(), current.lengths.end());
+        previous.characters += current.characters;
+
+        m_chunks.erase(m_chunks.begin() + i);
+        m_treeDirty = true;
+    }
+}
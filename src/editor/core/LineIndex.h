@@ -0,0 +1,57 @@
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include "../service/FenwickTree.h"
+#include <QString>
+#include <vector>
+
+// 行索引
+// 保存每行的长度（含行尾换行符，最后一行不含），按块分组；块级的行数和字符数由树状数组索引。
+// 插入或删除文本只改动所在块内受影响的几项并更新树状数组，
+// 单次编辑为 O(log 块数 + 块大小 + 变化的行数)，与编辑位置之后的行数无关；
+// 块分裂、合并或删除后树状数组惰性重建，O(块数)
+class LineIndex {
+public:
+    static constexpr int CHUNK_LINES = 256;             // 重新切分时每块的目标行数
+    static constexpr int CHUNK_CAPACITY = 2 * CHUNK_LINES;
+
+    LineIndex();
+
+    // 按全文重建，O(n)
+    void build(const QString& text);
+
+    // 与文本存储同步的编辑，position 为编辑前的字符位置
+    void insert(int position, const QString& text);
+    void remove(int position, int length);
+
+    int lineCount() const { return m_lineCount; }
+    int length() const { return m_length; }
+
+    int lineStart(int line) const;
+    int lineLength(int line) const;     // 不含换行符
+    int lineAt(int position) const;
+
+private:
+    struct Chunk {
+        std::vector<int> lengths;
+        int characters = 0;
+    };
+
+    std::vector<Chunk> m_chunks;        // 至少一块，空文本为一个长度为 0 的行
+    int m_lineCount = 1;
+    int m_length = 0;
+
+    // 块级索引：结构变化后惰性重建，其余编辑就地更新
+    mutable FenwickTree<int> m_lineTree;
+    mutable FenwickTree<int> m_characterTree;
+    mutable bool m_treeDirty = true;
+
+    void ensureTrees() const;
+    int locateLine(int line, int* offset) const;
+    int locatePosition(int position, int* offset, int* column) const;
+    void addToChunk(int chunkIndex, int lines, int characters);
+    void splitChunk(int chunkIndex);
+    void mergeSmallChunks(int chunkIndex);
+};
+
+#endif // LINE_INDEX_H
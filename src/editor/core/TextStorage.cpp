@@ -4,7 +4,85 @@
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
+#include <QDataStream>
+#include <QCryptographicHash>
 #include <algorithm>
+#include <limits>
+
+namespace {
+using Piece = PieceTable::Piece;
+
+// 两个 piece 在各自偏移处引用同一段源文本，即对应字符必然相同。
+// add buffer 被快照替换后旧的 Added 引用不再可比
+bool sameReference(const Piece& a, int aOffset, const Piece& b, int bOffset, bool addedComparable)
+{
+    if (a.source != b.source || (a.source == Piece::Added && !addedComparable))
+        return false;
+    return a.start + aOffset == b.start + bOffset;
+}
+
+// 两份 piece 列表开头引用相同的字符数，O(pieces)
+int commonPrefix(const QList<Piece>& before, const QList<Piece>& after, bool addedComparable)
+{
+    int prefix = 0;
+    int i = 0, j = 0;
+    int beforeOffset = 0, afterOffset = 0;
+
+    while (i < before.size() && j < after.size()) {
+        if (beforeOffset == before[i].length) {
+            i++;
+            beforeOffset = 0;
+            continue;
+        }
+        if (afterOffset == after[j].length) {
+            j++;
+            afterOffset = 0;
+            continue;
+        }
+        if (!sameReference(before[i], beforeOffset, after[j], afterOffset, addedComparable))
+            break;
+
+        int step = qMin(before[i].length - beforeOffset, after[j].length - afterOffset);
+        prefix += step;
+        beforeOffset += step;
+        afterOffset += step;
+    }
+
+    return prefix;
+}
+
+// 两份 piece 列表末尾引用相同的字符数，不超过 limit
+int commonSuffix(const QList<Piece>& before, const QList<Piece>& after, bool addedComparable, int limit)
+{
+    int suffix = 0;
+    int i = before.size() - 1, j = after.size() - 1;
+    int beforeRemaining = i >= 0 ? before[i].length : 0;   // 当前 piece 尚未比较的字符数
+    int afterRemaining = j >= 0 ? after[j].length : 0;
+
+    while (i >= 0 && j >= 0 && suffix < limit) {
+        if (beforeRemaining == 0) {
+            if (--i >= 0)
+                beforeRemaining = before[i].length;
+            continue;
+        }
+        if (afterRemaining == 0) {
+            if (--j >= 0)
+                afterRemaining = after[j].length;
+            continue;
+        }
+        // 比较两段末尾的最后一个字符
+        if (!sameReference(before[i], beforeRemaining - 1, after[j], afterRemaining - 1, addedComparable))
+            break;
+
+        int step = qMin(qMin(beforeRemaining, afterRemaining), limit - suffix);
+        suffix += step;
+        beforeRemaining -= step;
+        afterRemaining -= step;
+    }
+
+    return suffix;
+}
+}
 
 // ==============================================================================
 // PieceTable 实现
@@ -12,8 +90,8 @@
 
 PieceTable::PieceTable()
 {
-    // 初始化空的piece table
-    m_lineStarts.append(0);
+    // 初始化空的piece table，行索引默认即为一个空行
+    m_lineIndexDirty = false;
 }
 
 PieceTable::PieceTable(const QString& initialText)
@@ -75,7 +153,10 @@ void PieceTable::insert(int position, const QString& text)
         }
     }
 
-    m_lineIndexDirty = true;
+    // 行索引有效时增量调整，只改动所在块，避免下次查询时全文重建
+    if (!m_lineIndexDirty) {
+        m_lineIndex.insert(position, text);
+    }
 }
 
 void PieceTable::remove(int position, int length)
@@ -154,7 +235,9 @@ void PieceTable::remove(int position, int length)
         m_pieces[modify.first].length = modify.second;
     }
 
-    m_lineIndexDirty = true;
+    if (!m_lineIndexDirty) {
+        m_lineIndex.remove(position, length);
+    }
 }
 
 void PieceTable::replace(int position, int length, const QString& text)
@@ -266,48 +349,35 @@ void PieceTable::updateLineIndex() const
     if (!m_lineIndexDirty)
         return;
 
-    m_lineStarts.clear();
-    m_lineStarts.append(0);
-
-    QString fullText = getFullText();
-    for (int i = 0; i < fullText.length(); ++i) {
-        if (fullText[i] == '\n') {
-            m_lineStarts.append(i + 1);
-        }
-    }
-
+    m_lineIndex.build(getFullText());
     m_lineIndexDirty = false;
 }
 
 int PieceTable::getLineCount() const
 {
     updateLineIndex();
-    return m_lineStarts.size();
+    return m_lineIndex.lineCount();
 }
 
 int PieceTable::getLineStart(int lineNumber) const
 {
     updateLineIndex();
-    if (lineNumber < 0 || lineNumber >= m_lineStarts.size())
-        return 0;
-    return m_lineStarts[lineNumber];
+    return m_lineIndex.lineStart(lineNumber);
 }
 
 int PieceTable::getLineEnd(int lineNumber) const
 {
     updateLineIndex();
-    if (lineNumber < 0 || lineNumber >= m_lineStarts.size())
+    if (lineNumber < 0 || lineNumber >= m_lineIndex.lineCount())
         return 0;
 
-    if (lineNumber == m_lineStarts.size() - 1) {
-        return length();
-    }
-    return m_lineStarts[lineNumber + 1] - 1; // 不包括换行符
+    return m_lineIndex.lineStart(lineNumber) + m_lineIndex.lineLength(lineNumber); // 不包括换行符
 }
 
 int PieceTable::getLineLength(int lineNumber) const
 {
-    return getLineEnd(lineNumber) - getLineStart(lineNumber);
+    updateLineIndex();
+    return m_lineIndex.lineLength(lineNumber);
 }
 
 QString PieceTable::getLine(int lineNumber) const
@@ -320,23 +390,7 @@ QString PieceTable::getLine(int lineNumber) const
 int PieceTable::positionToLine(int position) const
 {
     updateLineIndex();
-    position = qBound(0, position, length());
-
-    // 二分查找
-    int left = 0, right = m_lineStarts.size() - 1;
-    while (left <= right) {
-        int mid = (left + right) / 2;
-        if (m_lineStarts[mid] <= position) {
-            if (mid == m_lineStarts.size() - 1 || m_lineStarts[mid + 1] > position) {
-                return mid;
-            }
-            left = mid + 1;
-        }
-        else {
-            right = mid - 1;
-        }
-    }
-    return 0;
+    return m_lineIndex.lineAt(position);
 }
 
 int PieceTable::positionToColumn(int position) const
@@ -348,7 +402,7 @@ int PieceTable::positionToColumn(int position) const
 int PieceTable::lineColumnToPosition(int line, int column) const
 {
     updateLineIndex();
-    if (line < 0 || line >= m_lineStarts.size())
+    if (line < 0 || line >= m_lineIndex.lineCount())
         return 0;
 
     int lineStart = getLineStart(line);
@@ -358,6 +412,120 @@ int PieceTable::lineColumnToPosition(int line, int column) const
     return lineStart + column;
 }
 
+// 快照支持
+QByteArray PieceTable::originalFingerprint() const
+{
+    // 原始文本不会变化，只计算一次。按 UTF-8 分段送入哈希，与平台字节序和 Qt 版本无关
+    if (m_originalFingerprint.isEmpty()) {
+        constexpr int SEGMENT = 64 * 1024;
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        for (int i = 0; i < m_originalText.length(); i += SEGMENT) {
+            hash.addData(QStringView(m_originalText).mid(i, SEGMENT).toUtf8());
+        }
+        m_originalFingerprint = hash.result();
+    }
+    return m_originalFingerprint;
+}
+
+void PieceTable::writeSnapshot(QDataStream& out) const
+{
+    out << qint32(m_originalText.length());
+    out << originalFingerprint();
+
+    out << qint32(m_pieces.size());
+    for (const Piece& piece : m_pieces) {
+        out << quint8(piece.source) << qint32(piece.start) << qint32(piece.length);
+    }
+
+    // add buffer 即相对原始文件的全部增量
+    out << m_addedText;
+}
+
+bool PieceTable::readSnapshot(QDataStream& in, SnapshotChange* change)
+{
+    qint32 originalLength = 0;
+    QByteArray fingerprint;
+    in >> originalLength >> fingerprint;
+
+    // 快照只能恢复到同一份原始文本上
+    if (in.status() != QDataStream::Ok ||
+        originalLength != m_originalText.length() ||
+        fingerprint != originalFingerprint()) {
+        qWarning() << "快照与当前原始文本不匹配";
+        return false;
+    }
+
+    qint32 pieceCount = 0;
+    in >> pieceCount;
+    if (in.status() != QDataStream::Ok || pieceCount < 0)
+        return false;
+
+    // 快照可能来自损坏的文件：每条 piece 记录 9 字节，数量不能超过剩余数据，避免按伪造的数量分配内存
+    const qint64 recordSize = sizeof(quint8) + 2 * sizeof(qint32);
+    if (!in.device() || pieceCount > in.device()->bytesAvailable() / recordSize) {
+        qWarning() << "快照的 piece 数量超出数据长度";
+        return false;
+    }
+
+    QList<Piece> pieces;
+    pieces.reserve(pieceCount);
+    for (qint32 i = 0; i < pieceCount; ++i) {
+        quint8 source = 0;
+        qint32 start = 0;
+        qint32 length = 0;
+        in >> source >> start >> length;
+        if (in.status() != QDataStream::Ok || source > Piece::Added)
+            return false;
+        pieces.append(Piece(static_cast<Piece::Source>(source), start, length));
+    }
+
+    QString addedText;
+    in >> addedText;
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    // 校验 piece 范围和总长度（用 64 位计算，避免伪造的数值溢出），全部通过后才修改自身状态
+    qint64 totalLength = 0;
+    for (const Piece& piece : pieces) {
+        const qint64 bufferLength = piece.source == Piece::Original ? m_originalText.length() : addedText.length();
+        if (piece.start < 0 || piece.length < 0 || qint64(piece.start) + piece.length > bufferLength)
+            return false;
+        totalLength += piece.length;
+    }
+    if (totalLength > std::numeric_limits<int>::max()) {
+        qWarning() << "快照的文本长度超出范围";
+        return false;
+    }
+    const int newLength = static_cast<int>(totalLength);
+
+    // 当前 add buffer 已包含快照内容时保留现有缓冲，避免复制；此时两份列表中的 Added 引用可以比较
+    const bool addedComparable = m_addedText.startsWith(addedText);
+    if (!addedComparable) {
+        m_addedText = addedText;
+    }
+
+    const int oldLength = length();
+    SnapshotChange result;
+    result.position = commonPrefix(m_pieces, pieces, addedComparable);
+    const int suffix = commonSuffix(m_pieces, pieces, addedComparable,
+        qMin(oldLength, newLength) - result.position);
+    result.removedLength = oldLength - result.position - suffix;
+    result.insertedLength = newLength - result.position - suffix;
+
+    m_pieces = pieces;
+
+    // 行索引只替换变化的范围
+    if (!m_lineIndexDirty) {
+        m_lineIndex.remove(result.position, result.removedLength);
+        m_lineIndex.insert(result.position, getText(result.position, result.insertedLength));
+    }
+
+    if (change) {
+        *change = result;
+    }
+    return true;
+}
+
 // ==============================================================================
 // ChunkedTextStorage 实现
 // ==============================================================================
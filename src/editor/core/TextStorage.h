@@ -5,6 +5,9 @@
 #include <QByteArray>
 #include <QList>
 #include <memory>
+#include "LineIndex.h"
+
+class QDataStream;
 
 // 文本存储接口
 class ITextStorage {
@@ -42,12 +45,22 @@ public:
         Piece(Source src, int st, int len) : source(src), start(st), length(len) {}
     };
 
+    // 恢复快照前后文本不同的范围：[position, position + removedLength) 被替换为
+    // [position, position + insertedLength)
+    struct SnapshotChange {
+        int position = 0;
+        int removedLength = 0;
+        int insertedLength = 0;
+    };
+
 private:
     QString m_originalText;
     QString m_addedText;
     QList<Piece> m_pieces;
-    mutable QList<int> m_lineStarts; // 缓存行起始位置
+    // 行索引：编辑时按块增量调整；整体替换内容（快照恢复等）后标记为脏，下次查询时按全文重建
+    mutable LineIndex m_lineIndex;
     mutable bool m_lineIndexDirty = true;
+    mutable QByteArray m_originalFingerprint;
 
     void updateLineIndex() const;
     int findPieceIndex(int position) const;
@@ -73,6 +86,13 @@ public:
     int positionToLine(int position) const override;
     int positionToColumn(int position) const override;
     int lineColumnToPosition(int line, int column) const override;
+
+    // 二进制快照：只写入 piece 列表和 add buffer，原始文本用 SHA-1 指纹校验。
+    // 恢复时按 piece 引用比较前后两份 piece 列表得出变化的范围，O(pieces)，
+    // 行索引也只按这一范围调整
+    void writeSnapshot(QDataStream& out) const;
+    bool readSnapshot(QDataStream& in, SnapshotChange* change = nullptr);
+    QByteArray originalFingerprint() const;
 };
 
 // 大文件分页存储
@@ -36,7 +36,7 @@ void InsertTextCommand::execute()
     change.timestamp = m_timestamp;
 
     m_document->setModified(true);
-    emit m_document->textChanged(change);
+    m_document->notifyTextChanged(change);
 }
 
 void InsertTextCommand::undo()
@@ -59,7 +59,7 @@ void InsertTextCommand::undo()
         change.insertedText = "";
         change.timestamp = QDateTime::currentDateTime();
 
-        emit m_document->textChanged(change);
+        m_document->notifyTextChanged(change);
     }
 }
 
@@ -178,7 +178,7 @@ void RemoveTextCommand::execute()
         change.timestamp = QDateTime::currentDateTime();
 
         m_document->setModified(true);
-        emit m_document->textChanged(change);
+        m_document->notifyTextChanged(change);
     }
 }
 
@@ -200,7 +200,7 @@ void RemoveTextCommand::undo()
     change.insertedText = m_removedText;
     change.timestamp = QDateTime::currentDateTime();
 
-    emit m_document->textChanged(change);
+    m_document->notifyTextChanged(change);
 }
 
 bool RemoveTextCommand::canMerge(const IEditCommand* other) const
@@ -315,7 +315,7 @@ public:
         change.timestamp = m_timestamp;
 
         m_document->setModified(true);
-        emit m_document->textChanged(change);
+        m_document->notifyTextChanged(change);
     }
 
     void undo() override
@@ -331,7 +331,7 @@ public:
         change.insertedText = m_oldText;
         change.timestamp = QDateTime::currentDateTime();
 
-        emit m_document->textChanged(change);
+        m_document->notifyTextChanged(change);
     }
 
     bool canMerge(const IEditCommand* other) const override
@@ -370,6 +370,13 @@ void UndoSystem::executeCommand(std::unique_ptr<IEditCommand> command)
     if (!command)
         return;
 
+    // 批量编辑中：执行后收集到当前批次，结束时作为一个撤销单元入栈
+    if (m_batchDepth > 0) {
+        command->execute();
+        m_batchCommands.push_back(std::move(command));
+        return;
+    }
+
     QDateTime currentTime = QDateTime::currentDateTime();
 
     // 尝试与上一个命令合并
@@ -596,18 +603,65 @@ public:
     }
 };
 
-// 为 UndoSystem 添加批量编辑支持
+// 为 UndoSystem 添加批量编辑支持（可嵌套，只有最外层结束时才入栈）
 void UndoSystem::beginBatchEdit(const QString& description)
 {
-    // 可以通过成员变量跟踪批量编辑状态
-    // 这里简化实现，使用信号通知外部组件
-    Q_UNUSED(description)
-        // emit batchEditStarted(description);
+    if (m_batchDepth++ == 0) {
+        m_batchDescription = description.isEmpty() ? QString("批量编辑") : description;
+        m_batchCommands.clear();
+    }
 }
 
 void UndoSystem::endBatchEdit()
 {
-    // emit batchEditEnded();
+    if (m_batchDepth == 0)
+        return;
+
+    if (--m_batchDepth > 0)
+        return;
+
+    if (m_batchCommands.empty())
+        return;
+
+    auto batch = std::make_unique<BatchEditCommand>(m_batchDescription);
+    for (auto& command : m_batchCommands) {
+        batch->addCommand(std::move(command));
+    }
+    m_batchCommands.clear();
+
+    // 子命令已经执行过，直接入栈
+    m_undoStack.push_back(std::move(batch));
+    m_lastCommandTime = QDateTime::currentDateTime();
+
+    if (!m_redoStack.empty()) {
+        m_redoStack.clear();
+        emit redoAvailable(false);
+    }
+
+    while (m_undoStack.size() > static_cast<size_t>(m_maxUndoSteps)) {
+        m_undoStack.erase(m_undoStack.begin());
+    }
+
+    emit undoAvailable(true);
+    emit stackChanged();
+}
+
+void UndoSystem::cancelBatchEdit()
+{
+    if (m_batchDepth == 0)
+        return;
+
+    // 逆序撤销本批次已执行的命令并丢弃
+    for (auto it = m_batchCommands.rbegin(); it != m_batchCommands.rend(); ++it) {
+        (*it)->undo();
+    }
+    m_batchCommands.clear();
+    m_batchDepth = 0;
+}
+
+bool UndoSystem::isInBatchEdit() const
+{
+    return m_batchDepth > 0;
 }
 
 // 创建辅助函数，简化命令创建
@@ -69,6 +69,11 @@ private:
     QDateTime m_lastCommandTime;
     static constexpr int MERGE_TIME_LIMIT_MS = 1000;
 
+    // 批量编辑状态
+    int m_batchDepth = 0;
+    QString m_batchDescription;
+    std::vector<std::unique_ptr<IEditCommand>> m_batchCommands;
+
 public:
     explicit UndoSystem(QObject* parent = nullptr);
 
@@ -90,6 +95,8 @@ public:
     // 批量编辑支持
     void beginBatchEdit(const QString& description = QString());
     void endBatchEdit();
+    void cancelBatchEdit();
+    bool isInBatchEdit() const;
 
     // 历史记录查询
     QStringList getUndoHistory() const;
@@ -0,0 +1,125 @@
+#include "GlyphRunCache.h"
+#include <QTextLayout>
+#include <QTextOption>
+#include <QHash>
+
+GlyphRunCache::GlyphRunCache(qsizetype maxBytes)
+    : m_cache(maxBytes)
+{
+}
+
+const QList<GlyphRunCache::Run>& GlyphRunCache::runs(const QString& text, const QList<Span>& spans,
+    const QFont& font, qreal tabStop)
+{
+    size_t key = hashKey(text, spans, font, tabStop);
+
+    // 命中后仍比较完整的键，避免哈希冲突时画出别的行
+    if (Entry* entry = m_cache.object(key)) {
+        if (entry->text == text && entry->spans == spans &&
+            entry->font == font && entry->tabStop == tabStop) {
+            m_hits++;
+            return entry->runs;
+        }
+    }
+
+    m_misses++;
+
+    auto entry = new Entry;
+    entry->text = text;
+    entry->spans = spans;
+    entry->font = font;
+    entry->tabStop = tabStop;
+    entry->runs = shape(text, spans, font, tabStop);
+
+    qsizetype cost = estimateBytes(*entry);
+    if (cost > m_cache.maxCost()) {
+        m_uncached = std::move(*entry);
+        delete entry;
+        return m_uncached.runs;
+    }
+
+    m_cache.insert(key, entry, cost);
+    return entry->runs;
+}
+
+void GlyphRunCache::clear()
+{
+    m_cache.clear();
+    m_uncached = Entry();
+}
+
+void GlyphRunCache::setMaxBytes(qsizetype maxBytes)
+{
+    m_cache.setMaxCost(maxBytes);
+}
+
+size_t GlyphRunCache::hashKey(const QString& text, const QList<Span>& spans,
+    const QFont& font, qreal tabStop)
+{
+    size_t seed = qHashMulti(0, text, font.key(), tabStop);
+    for (const Span& span : spans) {
+        seed = qHashMulti(seed, span.start, span.length, span.color.rgba(), span.bold);
+    }
+    return seed;
+}
+
+QList<GlyphRunCache::Run> GlyphRunCache::shape(const QString& text, const QList<Span>& spans,
+    const QFont& font, qreal tabStop)
+{
+    QList<Run> result;
+    if (text.isEmpty())
+        return result;
+
+    // 整行一起塑形，字距和连字跨格式段边界保持一致
+    QTextLayout layout(text, font);
+
+    QTextOption option;
+    option.setWrapMode(QTextOption::NoWrap);
+    if (tabStop > 0) {
+        option.setTabStopDistance(tabStop);
+    }
+    layout.setTextOption(option);
+
+    QList<QTextLayout::FormatRange> formats;
+    for (const Span& span : spans) {
+        if (span.bold) {
+            QTextLayout::FormatRange range;
+            range.start = span.start;
+            range.length = span.length;
+            range.format.setFontWeight(QFont::Bold);
+            formats.append(range);
+        }
+    }
+    layout.setFormats(formats);
+
+    layout.beginLayout();
+    QTextLine line = layout.createLine();
+    if (line.isValid()) {
+        line.setPosition(QPointF(0, 0));
+    }
+    layout.endLayout();
+
+    // 按格式段取出字形串，颜色在绘制时由画笔提供
+    for (const Span& span : spans) {
+        const QList<QGlyphRun> glyphRuns = layout.glyphRuns(span.start, span.length);
+        for (const QGlyphRun& glyphRun : glyphRuns) {
+            result.append(Run{ glyphRun, span.color });
+        }
+    }
+
+    return result;
+}
+
+qsizetype GlyphRunCache::estimateBytes(const Entry& entry)
+{
+    // 每个字形一个索引和一个位置，另加文本副本和固定开销
+    static constexpr qsizetype BASE_BYTES = 256;
+    static constexpr qsizetype BYTES_PER_GLYPH = sizeof(quint32) + sizeof(QPointF);
+    static constexpr qsizetype BYTES_PER_RUN = 128;
+
+    qsizetype bytes = BASE_BYTES + entry.text.size() * sizeof(QChar);
+    for (const Run& run : entry.runs) {
+        bytes += BYTES_PER_RUN + run.glyphs.glyphIndexes().size() * BYTES_PER_GLYPH;
+    }
+    return bytes;
+}
@@ -0,0 +1,74 @@
+#ifndef GLYPH_RUN_CACHE_H
+#define GLYPH_RUN_CACHE_H
+
+#include <QCache>
+#include <QColor>
+#include <QFont>
+#include <QGlyphRun>
+#include <QList>
+#include <QString>
+
+// 字形串缓存
+// 一行文本按格式段整体塑形一次，得到的 QGlyphRun 以（行内容、格式段、字体、制表位）
+// 的哈希为键缓存，重绘时直接 drawGlyphRun。键只依赖内容而不依赖行号，
+// 行号移动不需要失效；内容或格式变化的行自然不再命中，由 LRU 按估算字节数淘汰
+class GlyphRunCache {
+public:
+    // 格式段：[start, start + length) 使用同一颜色和字重
+    struct Span {
+        int start = 0;
+        int length = 0;
+        QColor color;
+        bool bold = false;
+
+        bool operator==(const Span& other) const
+        {
+            return start == other.start && length == other.length &&
+                color == other.color && bold == other.bold;
+        }
+    };
+
+    // 一个字形串及其绘制颜色，字形位置相对于行的左上角（已包含基线偏移）
+    struct Run {
+        QGlyphRun glyphs;
+        QColor color;
+    };
+
+    static constexpr qsizetype DEFAULT_MAX_BYTES = 8 * 1024 * 1024;
+
+    explicit GlyphRunCache(qsizetype maxBytes = DEFAULT_MAX_BYTES);
+
+    // 返回该行的字形串，未命中时塑形并缓存；引用在下一次调用前有效
+    const QList<Run>& runs(const QString& text, const QList<Span>& spans,
+        const QFont& font, qreal tabStop);
+
+    void clear();
+    void setMaxBytes(qsizetype maxBytes);
+    int count() const { return static_cast<int>(m_cache.count()); }
+
+    quint64 hits() const { return m_hits; }
+    quint64 misses() const { return m_misses; }
+
+private:
+    struct Entry {
+        QString text;
+        QList<Span> spans;
+        QFont font;
+        qreal tabStop = 0;
+        QList<Run> runs;
+    };
+
+    QCache<size_t, Entry> m_cache;
+    Entry m_uncached;   // 超出整个缓存预算的行，只保留到下一次调用
+
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+
+    static size_t hashKey(const QString& text, const QList<Span>& spans,
+        const QFont& font, qreal tabStop);
+    static QList<Run> shape(const QString& text, const QList<Span>& spans,
+        const QFont& font, qreal tabStop);
+    static qsizetype estimateBytes(const Entry& entry);
+};
+
+#endif // GLYPH_RUN_CACHE_H
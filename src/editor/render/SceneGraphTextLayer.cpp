@@ -0,0 +1,617 @@
+#include "SceneGraphTextLayer.h"
+#include "../service/LayoutEngine.h"
+#include "../interaction/CursorManager.h"
+#include "../interaction/SelectionManager.h"
+#include "../service/SyntaxHighlighter.h"
+#include <QQuickWindow>
+#include <QSGNode>
+#include <QSGRectangleNode>
+#include <QSGTextNode>
+#include <QTextLayout>
+#include <QTextOption>
+#include <QMatrix4x4>
+#include <QHash>
+#include <QStringList>
+
+namespace {
+
+// 节点树：背景、当前行、配对括号、选区、文本块（裁剪到文本区）、行号区、光标，按绘制顺序排列
+class LayerRootNode : public QSGNode {
+public:
+    QSGRectangleNode* background = nullptr;
+    QSGRectangleNode* currentLine = nullptr;
+    QSGNode* brackets = nullptr;
+    QSGNode* selections = nullptr;
+    QSGClipNode* textClip = nullptr;
+    QSGRectangleNode* gutterBackground = nullptr;
+    QSGRectangleNode* gutterSeparator = nullptr;
+    QSGClipNode* gutterClip = nullptr;
+    QSGTransformNode* currentNumber = nullptr;
+    QSGNode* cursors = nullptr;
+
+    // 块序号 -> 块的变换节点，文本节点是它唯一的子节点
+    QHash<int, QSGTransformNode*> textBlocks;
+    QHash<int, QSGTransformNode*> numberBlocks;
+    int currentNumberLine = -1;
+};
+
+QSGClipNode* createClipNode()
+{
+    auto node = new QSGClipNode;
+    auto geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 4);
+    geometry->setDrawingMode(QSGGeometry::DrawTriangleStrip);
+    node->setGeometry(geometry);
+    node->setFlag(QSGNode::OwnsGeometry);
+    node->setIsRectangular(true);
+    return node;
+}
+
+void setClipRect(QSGClipNode* node, const QRectF& rect)
+{
+    if (node->clipRect() == rect)
+        return;
+
+    node->setClipRect(rect);
+    QSGGeometry::updateRectGeometry(node->geometry(), rect);
+    node->markDirty(QSGNode::DirtyGeometry);
+}
+
+// 按需增减子矩形节点并更新位置，选区和光标每帧只有少量矩形
+void syncRectangles(QQuickWindow* window, QSGNode* parent, const QList<QRect>& rects,
+    const QColor& color)
+{
+    while (parent->childCount() > rects.size()) {
+        QSGNode* last = parent->lastChild();
+        parent->removeChildNode(last);
+        delete last;
+    }
+
+    while (parent->childCount() < rects.size()) {
+        parent->appendChildNode(window->createRectangleNode());
+    }
+
+    QSGNode* child = parent->firstChild();
+    for (const QRect& rect : rects) {
+        auto node = static_cast<QSGRectangleNode*>(child);
+        node->setRect(rect);
+        node->setColor(color);
+        child = child->nextSibling();
+    }
+}
+
+void translateNode(QSGTransformNode* node, qreal x, qreal y)
+{
+    QMatrix4x4 matrix;
+    matrix.translate(x, y);
+    if (node->matrix() != matrix) {
+        node->setMatrix(matrix);
+    }
+}
+
+void layoutSingleLine(QTextLayout& layout, qreal tabStop)
+{
+    QTextOption option;
+    option.setWrapMode(QTextOption::NoWrap);
+    if (tabStop > 0) {
+        option.setTabStopDistance(tabStop);
+    }
+    layout.setTextOption(option);
+
+    layout.beginLayout();
+    QTextLine line = layout.createLine();
+    if (line.isValid()) {
+        line.setPosition(QPointF(0, 0));
+    }
+    layout.endLayout();
+}
+
+// 一个文本块：块内各显示行按语法格式整行排版后加入同一个文本节点，坐标相对于块的第一行。
+// 块按显示行切分，折叠隐藏的行不占位置；超长行只排版横向窗口内的一段，此时 windowed 置为 true
+QSGTransformNode* buildTextBlock(QQuickWindow* window, TextRenderer* renderer,
+    DocumentModel* document, int block, qreal lineHeight, bool* windowed)
+{
+    auto blockNode = new QSGTransformNode;
+    QSGTextNode* textNode = window->createTextNode();
+    textNode->setColor(renderer->textColor());
+    blockNode->appendChildNode(textNode);
+
+    const QFont font = renderer->font();
+    const qreal tabStop = renderer->layoutEngine()->tabWidth();
+    const int firstRow = block * SceneGraphTextLayer::BLOCK_LINES;
+    const int lastRow = qMin(firstRow + SceneGraphTextLayer::BLOCK_LINES, renderer->visibleRowCount()) - 1;
+
+    for (int row = firstRow; row <= lastRow; ++row) {
+        int lineNumber = renderer->lineAtRow(row);
+        QString lineText = document->getLine(lineNumber);
+        if (lineText.isEmpty())
+            continue;
+
+        const TextRenderer::LineWindow lineWindow = renderer->lineWindow(lineText);
+        QString text = lineText;
+        if (lineWindow.length != lineText.length()) {
+            *windowed = true;
+            text = lineText.mid(lineWindow.start, lineWindow.length);
+        }
+
+        QList<QTextLayout::FormatRange> formats;
+        const QList<GlyphRunCache::Span> spans = renderer->lineSpans(lineText, lineNumber, lineWindow);
+        for (const GlyphRunCache::Span& span : spans) {
+            QTextLayout::FormatRange range;
+            range.start = span.start;
+            range.length = span.length;
+            range.format.setForeground(span.color);
+            if (span.bold) {
+                range.format.setFontWeight(QFont::Bold);
+            }
+            formats.append(range);
+        }
+
+        QTextLayout layout(text, font);
+        layout.setFormats(formats);
+        layoutSingleLine(layout, tabStop);
+
+        textNode->addTextLayout(QPointF(lineWindow.x, (row - firstRow) * lineHeight), &layout);
+    }
+
+    return blockNode;
+}
+
+// 行号文本右对齐到行号区右侧留出 5 像素
+void addLineNumber(QSGTextNode* textNode, const QFont& font, int lineNumber,
+    qreal right, qreal y)
+{
+    QTextLayout layout(QString::number(lineNumber + 1), font);
+    layoutSingleLine(layout, 0);
+
+    qreal width = layout.lineCount() > 0 ? layout.lineAt(0).naturalTextWidth() : 0;
+    textNode->addTextLayout(QPointF(right - 5 - width, y), &layout);
+}
+
+QSGTransformNode* buildNumberBlock(QQuickWindow* window, TextRenderer* renderer,
+    int rowCount, int block, qreal lineHeight)
+{
+    auto blockNode = new QSGTransformNode;
+    QSGTextNode* textNode = window->createTextNode();
+    textNode->setColor(renderer->textColor().lighter(150));
+    blockNode->appendChildNode(textNode);
+
+    const QFont font = renderer->font();
+    const qreal right = renderer->lineNumberArea().width();
+    const int firstRow = block * SceneGraphTextLayer::BLOCK_LINES;
+    const int lastRow = qMin(firstRow + SceneGraphTextLayer::BLOCK_LINES, rowCount) - 1;
+
+    for (int row = firstRow; row <= lastRow; ++row) {
+        addLineNumber(textNode, font, renderer->lineAtRow(row), right, (row - firstRow) * lineHeight);
+    }
+
+    return blockNode;
+}
+
+void removeBlock(QSGNode* parent, QSGTransformNode* block)
+{
+    parent->removeChildNode(block);
+    delete block;
+}
+
+} // namespace
+
+SceneGraphTextLayer::SceneGraphTextLayer(QQuickItem* parent)
+    : QQuickItem(parent)
+{
+    setFlag(QQuickItem::ItemHasContents, true);
+}
+
+SceneGraphTextLayer::~SceneGraphTextLayer()
+{
+    if (m_textRenderer) {
+        disconnect(m_textRenderer, nullptr, this, nullptr);
+        m_textRenderer->setContentsPainted(true);
+    }
+}
+
+// ==============================================================================
+// 属性访问器
+// ==============================================================================
+
+TextRenderer* SceneGraphTextLayer::textRenderer() const
+{
+    return m_textRenderer;
+}
+
+void SceneGraphTextLayer::setTextRenderer(TextRenderer* renderer)
+{
+    if (m_textRenderer == renderer)
+        return;
+
+    if (m_textRenderer) {
+        disconnect(m_textRenderer, nullptr, this, nullptr);
+        if (m_textRenderer->cursorManager()) {
+            disconnect(m_textRenderer->cursorManager(), nullptr, this, nullptr);
+        }
+        if (m_textRenderer->selectionManager()) {
+            disconnect(m_textRenderer->selectionManager(), nullptr, this, nullptr);
+        }
+        if (m_textRenderer->syntaxHighlighter()) {
+            disconnect(m_textRenderer->syntaxHighlighter(), nullptr, this, nullptr);
+        }
+        m_textRenderer->setContentsPainted(true);
+    }
+
+    m_textRenderer = renderer;
+
+    if (m_textRenderer) {
+        auto requestUpdate = [this]() { update(); };
+        auto rebuildAll = [this]() { markAllDirty(); };
+
+        // 滚动、尺寸和焦点变化不需要重建文本块，只更新变换和装饰节点
+        connect(m_textRenderer, &TextRenderer::scrollXChanged, this, requestUpdate);
+        connect(m_textRenderer, &TextRenderer::scrollYChanged, this, requestUpdate);
+        connect(m_textRenderer, &QQuickItem::widthChanged, this, requestUpdate);
+        connect(m_textRenderer, &QQuickItem::heightChanged, this, requestUpdate);
+        connect(m_textRenderer, &QQuickItem::activeFocusChanged, this, requestUpdate);
+
+        connect(m_textRenderer, &TextRenderer::fontChanged, this, rebuildAll);
+        connect(m_textRenderer, &TextRenderer::textColorChanged, this, rebuildAll);
+        connect(m_textRenderer, &TextRenderer::backgroundColorChanged, this, requestUpdate);
+        connect(m_textRenderer, &TextRenderer::lineNumbersChanged, this, rebuildAll);
+        connect(m_textRenderer, &TextRenderer::lineNumberSeparatorColorChanged, this, requestUpdate);
+        connect(m_textRenderer, &TextRenderer::lineNumberExtraWidthChanged, this, rebuildAll);
+        // 折叠或展开后显示行与文档行的对应关系改变
+        connect(m_textRenderer, &TextRenderer::foldingChanged, this, rebuildAll);
+
+        connect(m_textRenderer, &TextRenderer::documentChanged, this, [this]() {
+            attachDocument(m_textRenderer->document());
+        });
+        connect(m_textRenderer, &QObject::destroyed, this, [this]() {
+            m_textRenderer = nullptr;
+            attachDocument(nullptr);
+            emit textRendererChanged();
+        });
+
+        if (m_textRenderer->cursorManager()) {
+            connect(m_textRenderer->cursorManager(), &CursorManager::cursorPositionChanged,
+                this, requestUpdate);
+            connect(m_textRenderer->cursorManager(), &CursorManager::cursorVisibilityChanged,
+                this, requestUpdate);
+        }
+
+        if (m_textRenderer->selectionManager()) {
+            connect(m_textRenderer->selectionManager(), &SelectionManager::selectionsChanged,
+                this, requestUpdate);
+        }
+
+        if (m_textRenderer->syntaxHighlighter()) {
+            connect(m_textRenderer->syntaxHighlighter(), &SyntaxHighlighter::languageChanged,
+                this, rebuildAll);
+            connect(m_textRenderer->syntaxHighlighter(), &SyntaxHighlighter::highlightingUpdated,
+                this, [this](int startLine, int endLine) {
+                    int startBlock = m_textRenderer->visibleRow(startLine) / BLOCK_LINES;
+                    if (endLine < 0) {
+                        m_dirtyFromBlock = qMin(m_dirtyFromBlock, startBlock);
+                    }
+                    else {
+                        int endBlock = m_textRenderer->visibleRow(endLine) / BLOCK_LINES;
+                        for (int block = startBlock; block <= endBlock; ++block) {
+                            m_dirtyBlocks.insert(block);
+                        }
+                    }
+                    update();
+                });
+        }
+
+        m_textRenderer->setContentsPainted(false);
+    }
+
+    attachDocument(m_textRenderer ? m_textRenderer->document() : nullptr);
+    emit textRendererChanged();
+}
+
+// ==============================================================================
+// 场景图更新
+// ==============================================================================
+
+QSGNode* SceneGraphTextLayer::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data)
+{
+    Q_UNUSED(data)
+
+    auto root = static_cast<LayerRootNode*>(oldNode);
+
+    if (!m_textRenderer || !m_document || !m_textRenderer->layoutEngine() || !window()) {
+        delete root;
+        return nullptr;
+    }
+
+    QQuickWindow* win = window();
+
+    if (!root) {
+        root = new LayerRootNode;
+        root->background = win->createRectangleNode();
+        root->currentLine = win->createRectangleNode();
+        root->brackets = new QSGNode;
+        root->selections = new QSGNode;
+        root->textClip = createClipNode();
+        root->gutterBackground = win->createRectangleNode();
+        root->gutterSeparator = win->createRectangleNode();
+        root->gutterClip = createClipNode();
+        root->cursors = new QSGNode;
+
+        root->appendChildNode(root->background);
+        root->appendChildNode(root->currentLine);
+        root->appendChildNode(root->brackets);
+        root->appendChildNode(root->selections);
+        root->appendChildNode(root->textClip);
+        root->appendChildNode(root->gutterBackground);
+        root->appendChildNode(root->gutterSeparator);
+        root->appendChildNode(root->gutterClip);
+        root->appendChildNode(root->cursors);
+
+        // 新的节点树没有任何块，全部按需构建
+        m_dirtyBlocks.clear();
+        m_windowedBlocks.clear();
+        m_dirtyFromBlock = 0;
+        m_dirtyNumbersFromBlock = 0;
+    }
+
+    m_textRenderer->beginHighlightFrame();
+
+    const qreal lineHeight = m_textRenderer->layoutEngine()->lineHeight();
+    const int rowCount = m_textRenderer->visibleRowCount();
+    const int scrollX = m_textRenderer->scrollX();
+    const int scrollY = m_textRenderer->scrollY();
+    const QColor backgroundColor = m_textRenderer->backgroundColor();
+    const QRectF bounds = boundingRect();
+    const QRectF textRect = m_textRenderer->textArea();
+    const bool showLineNumbers = m_textRenderer->showLineNumbers();
+
+    // 1. 背景
+    root->background->setRect(bounds);
+    root->background->setColor(backgroundColor);
+
+    // 2. 当前行和配对括号
+    CursorManager* cursorManager = m_textRenderer->cursorManager();
+    const bool focused = m_textRenderer->hasActiveFocus();
+    int currentLine = -1;
+    if (cursorManager && focused) {
+        currentLine = m_document->positionToLine(cursorManager->cursorPosition());
+        root->currentLine->setRect(m_textRenderer->lineRect(currentLine));
+    }
+    else {
+        root->currentLine->setRect(QRectF());
+    }
+    root->currentLine->setColor(backgroundColor.darker(103));
+    syncRectangles(win, root->brackets, m_textRenderer->bracketRects(), backgroundColor.darker(115));
+
+    // 3. 选区
+    SelectionManager* selectionManager = m_textRenderer->selectionManager();
+    syncRectangles(win, root->selections, m_textRenderer->selectionRects(),
+        selectionManager ? selectionManager->selectionColor() : QColor());
+
+    // 4. 文本块：保留可见块前后各一块，其余和内容已变化的块丢弃
+    int firstRow = qMax(0, static_cast<int>(scrollY / lineHeight));
+    int lastRow = qMin(rowCount - 1, static_cast<int>((scrollY + bounds.height()) / lineHeight));
+    int firstBlock = firstRow / BLOCK_LINES;
+    int lastBlock = lastRow >= firstRow ? lastRow / BLOCK_LINES : firstBlock - 1;
+
+    auto outsideKeptRange = [&](int block) {
+        return block < firstBlock - 1 || block > lastBlock + 1;
+    };
+
+    const int windowKey = m_textRenderer->horizontalWindowKey();
+    if (windowKey != m_windowKey || textRect.width() != m_windowWidth) {
+        m_dirtyBlocks.unite(m_windowedBlocks);
+        m_windowKey = windowKey;
+        m_windowWidth = textRect.width();
+    }
+
+    for (auto it = root->textBlocks.begin(); it != root->textBlocks.end();) {
+        int block = it.key();
+        if (block >= m_dirtyFromBlock || m_dirtyBlocks.contains(block) || outsideKeptRange(block)) {
+            m_windowedBlocks.remove(block);
+            removeBlock(root->textClip, it.value());
+            it = root->textBlocks.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (int block = firstBlock; block <= lastBlock; ++block) {
+        if (root->textBlocks.contains(block)) {
+            m_retainedBlocks++;
+            continue;
+        }
+
+        bool windowed = false;
+        QSGTransformNode* node = buildTextBlock(win, m_textRenderer, m_document, block, lineHeight, &windowed);
+        if (windowed) {
+            m_windowedBlocks.insert(block);
+        }
+        root->textClip->appendChildNode(node);
+        root->textBlocks.insert(block, node);
+        m_builtBlocks++;
+    }
+
+    // 滚动只改变平移；平移在 CPU 端按双精度算出，大文档末尾的坐标也不会损失精度
+    const qreal textOriginX = textRect.left() + TextRenderer::TEXT_LEFT_PADDING - scrollX;
+    for (auto it = root->textBlocks.cbegin(); it != root->textBlocks.cend(); ++it) {
+        translateNode(it.value(), textOriginX,
+            static_cast<qreal>(it.key()) * BLOCK_LINES * lineHeight - scrollY);
+    }
+
+    setClipRect(root->textClip, textRect);
+
+    // 5. 行号区
+    if (showLineNumbers) {
+        const QRectF numberRect = m_textRenderer->lineNumberArea();
+        root->gutterBackground->setRect(numberRect);
+        root->gutterBackground->setColor(backgroundColor);
+        root->gutterSeparator->setRect(QRectF(numberRect.right(), 0, 1, numberRect.height()));
+        root->gutterSeparator->setColor(m_textRenderer->lineNumberSeparatorColor());
+
+        for (auto it = root->numberBlocks.begin(); it != root->numberBlocks.end();) {
+            if (it.key() >= m_dirtyNumbersFromBlock || outsideKeptRange(it.key())) {
+                removeBlock(root->gutterClip, it.value());
+                it = root->numberBlocks.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+
+        for (int block = firstBlock; block <= lastBlock; ++block) {
+            if (!root->numberBlocks.contains(block)) {
+                QSGTransformNode* node = buildNumberBlock(win, m_textRenderer, rowCount, block, lineHeight);
+                root->gutterClip->appendChildNode(node);
+                root->numberBlocks.insert(block, node);
+            }
+        }
+
+        for (auto it = root->numberBlocks.cbegin(); it != root->numberBlocks.cend(); ++it) {
+            translateNode(it.value(), numberRect.left(),
+                static_cast<qreal>(it.key()) * BLOCK_LINES * lineHeight - scrollY);
+        }
+
+        // 当前行的行号使用正文颜色：盖住块内的浅色行号后重新绘制，只在当前行变化时重建
+        if (root->currentNumberLine != currentLine || m_dirtyNumbersFromBlock != NO_DIRTY_BLOCK) {
+            if (root->currentNumber) {
+                removeBlock(root->gutterClip, root->currentNumber);
+                root->currentNumber = nullptr;
+            }
+
+            if (currentLine >= 0) {
+                root->currentNumber = new QSGTransformNode;
+
+                QSGRectangleNode* cover = win->createRectangleNode();
+                cover->setRect(QRectF(0, 0, numberRect.width(), lineHeight));
+                cover->setColor(backgroundColor);
+                root->currentNumber->appendChildNode(cover);
+
+                QSGTextNode* textNode = win->createTextNode();
+                textNode->setColor(m_textRenderer->textColor());
+                addLineNumber(textNode, m_textRenderer->font(), currentLine, numberRect.width(), 0);
+                root->currentNumber->appendChildNode(textNode);
+
+                root->gutterClip->appendChildNode(root->currentNumber);
+            }
+
+            root->currentNumberLine = currentLine;
+        }
+
+        if (root->currentNumber) {
+            translateNode(root->currentNumber, numberRect.left(),
+                static_cast<qreal>(m_textRenderer->visibleRow(currentLine)) * lineHeight - scrollY);
+        }
+
+        setClipRect(root->gutterClip, numberRect);
+    }
+    else {
+        root->gutterBackground->setRect(QRectF());
+        root->gutterSeparator->setRect(QRectF());
+
+        for (QSGTransformNode* node : std::as_const(root->numberBlocks)) {
+            removeBlock(root->gutterClip, node);
+        }
+        root->numberBlocks.clear();
+
+        if (root->currentNumber) {
+            removeBlock(root->gutterClip, root->currentNumber);
+            root->currentNumber = nullptr;
+        }
+        root->currentNumberLine = -1;
+    }
+
+    // 6. 光标：只在获得焦点且闪烁可见时显示
+    QList<QRect> cursorRects;
+    if (cursorManager && focused && cursorManager->isBlinkVisible()) {
+        cursorRects = m_textRenderer->cursorRects();
+    }
+    syncRectangles(win, root->cursors, cursorRects, m_textRenderer->textColor());
+
+    m_dirtyBlocks.clear();
+    m_dirtyFromBlock = NO_DIRTY_BLOCK;
+    m_dirtyNumbersFromBlock = NO_DIRTY_BLOCK;
+
+    return root;
+}
+
+// ==============================================================================
+// 变更跟踪
+// ==============================================================================
+
+void SceneGraphTextLayer::attachDocument(DocumentModel* document)
+{
+    if (m_document == document) {
+        update();
+        return;
+    }
+
+    if (m_document) {
+        disconnect(m_document, nullptr, this, nullptr);
+    }
+
+    m_document = document;
+
+    if (m_document) {
+        connect(m_document, &DocumentModel::textChanged,
+            this, [this](const TextChange& change) { onTextChanged(change); });
+        m_knownLineCount = m_document->lineCount();
+    }
+    else {
+        m_knownLineCount = 0;
+    }
+
+    markAllDirty();
+}
+
+void SceneGraphTextLayer::onTextChanged(const TextChange& change)
+{
+    if (!m_document || !m_textRenderer || !m_textRenderer->layoutEngine())
+        return;
+
+    // 块按显示行切分（TextRenderer 已按同一变更更新布局和折叠）
+    int startBlock = m_textRenderer->visibleRow(m_document->positionToLine(change.position)) / BLOCK_LINES;
+    int lineCount = m_document->lineCount();
+
+    if (lineCount != m_knownLineCount) {
+        // 行数变化：之后的行整体移动；没有折叠时行号只有原来和现在的末尾之后才会变化，
+        // 有折叠时编辑之后各显示行的行号都会变化
+        bool folded = m_textRenderer->layoutEngine()->hasHiddenLines();
+        m_dirtyFromBlock = qMin(m_dirtyFromBlock, startBlock);
+        m_dirtyNumbersFromBlock = qMin(m_dirtyNumbersFromBlock,
+            folded ? startBlock : qMin(lineCount, m_knownLineCount) / BLOCK_LINES);
+        m_knownLineCount = lineCount;
+    }
+    else {
+        // 行数不变时只有插入文本覆盖的行所在的块需要重建
+        int endLine = m_document->positionToLine(change.position + change.insertedText.length());
+        int endBlock = m_textRenderer->visibleRow(endLine) / BLOCK_LINES;
+        for (int block = startBlock; block <= endBlock; ++block) {
+            m_dirtyBlocks.insert(block);
+        }
+    }
+
+    update();
+}
+
+void SceneGraphTextLayer::markAllDirty()
+{
+    m_dirtyBlocks.clear();
+    m_dirtyFromBlock = 0;
+    m_dirtyNumbersFromBlock = 0;
+    update();
+}
+
+QString SceneGraphTextLayer::getDebugInfo() const
+{
+    QStringList info;
+
+    info << QString("SceneGraphTextLayer Debug Info:");
+    info << QString("  Size: %1x%2").arg(width()).arg(height());
+    info << QString("  TextRenderer: %1").arg(m_textRenderer ? "Valid" : "Null");
+    info << QString("  Document: %1").arg(m_document ? "Valid" : "Null");
+    info << QString("  Block size: %1 lines").arg(BLOCK_LINES);
+    info << QString("  Blocks built: %1, retained: %2").arg(m_builtBlocks).arg(m_retainedBlocks);
+    info << QString("  Blocks with long lines: %1").arg(m_windowedBlocks.size());
+
+    return info.join("\n");
+}
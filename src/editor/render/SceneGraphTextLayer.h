@@ -0,0 +1,71 @@
+#ifndef SCENE_GRAPH_TEXT_LAYER_H
+#define SCENE_GRAPH_TEXT_LAYER_H
+
+#include <QQuickItem>
+#include <QSet>
+#include <qqmlintegration.h>
+#include <limits>
+
+// 包含完整类型定义以支持Q_PROPERTY
+#include "DocumentModel.h"
+#include "TextRenderer.h"
+
+class QSGNode;
+
+// 场景图文本渲染层
+// 叠放在 TextRenderer 上方，接管它的绘制：背景、当前行、选区、文本、行号和光标
+// 都以场景图节点输出，不再逐帧光栅化到图像再上传纹理。
+// 文本每 BLOCK_LINES 个显示行（跳过折叠的行）一个 QSGTextNode（字形图集），节点跨帧保留；
+// 滚动只改变各块变换节点的平移，只有内容变化的块才重建。
+// 输入、光标和选区状态仍由 TextRenderer 处理；节点均通过 QQuickWindow 创建，
+// 软件渲染后端同样可用
+class SceneGraphTextLayer : public QQuickItem {
+    Q_OBJECT
+        QML_ELEMENT
+
+        Q_PROPERTY(TextRenderer* textRenderer READ textRenderer WRITE setTextRenderer NOTIFY textRendererChanged)
+
+public:
+    static constexpr int BLOCK_LINES = 32;
+
+    explicit SceneGraphTextLayer(QQuickItem* parent = nullptr);
+    ~SceneGraphTextLayer();
+
+    TextRenderer* textRenderer() const;
+    void setTextRenderer(TextRenderer* renderer);
+
+    Q_INVOKABLE QString getDebugInfo() const;
+
+signals:
+    void textRendererChanged();
+
+protected:
+    QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) override;
+
+private:
+    static constexpr int NO_DIRTY_BLOCK = std::numeric_limits<int>::max();
+
+    TextRenderer* m_textRenderer = nullptr;
+    DocumentModel* m_document = nullptr;
+
+    // 需要重建的块：单独的块，以及某块及其之后的全部块（行数变化使后续行整体移动）
+    QSet<int> m_dirtyBlocks;
+    int m_dirtyFromBlock = 0;
+    int m_dirtyNumbersFromBlock = 0;
+    int m_knownLineCount = 0;
+
+    // 含超长行的块只排版了横向窗口内的一段，窗口分段或文本区宽度变化时重建
+    QSet<int> m_windowedBlocks;
+    int m_windowKey = 0;
+    qreal m_windowWidth = 0;
+
+    // 统计
+    int m_builtBlocks = 0;
+    int m_retainedBlocks = 0;
+
+    void attachDocument(DocumentModel* document);
+    void onTextChanged(const TextChange& change);
+    void markAllDirty();
+};
+
+#endif // SCENE_GRAPH_TEXT_LAYER_H
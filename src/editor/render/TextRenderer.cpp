@@ -5,6 +5,8 @@
 #include "../interaction/CursorManager.h"
 #include "../interaction/SelectionManager.h"
 #include "../service/SyntaxHighlighter.h"
+#include "../service/FoldingModel.h"
+#include "../service/SemanticTokenClient.h"
 
 #include <QPainter>
 #include <QTextLayout>
@@ -20,8 +22,7 @@
 #include <QDebug>
 #include <QFileInfo>
 #include <QElapsedTimer>
-
-static const int TEXT_LEFT_PADDING = 5; // 文本左侧内边距
+#include <QtMath>
 
 TextRenderer::TextRenderer(QQuickItem* parent)
     : QQuickPaintedItem(parent)
@@ -67,6 +68,12 @@ void TextRenderer::initializeComponents()
     // 创建语法高亮器
     m_syntaxHighlighter = new SyntaxHighlighter(this);
 
+    // 折叠状态：范围来自语法高亮器的行索引，隐藏状态写入布局引擎
+    m_foldingModel = new FoldingModel(m_layoutEngine, m_syntaxHighlighter, this);
+
+    // 语义 token 客户端：分析器未启动时不做任何事
+    m_semanticTokenClient = new SemanticTokenClient(m_syntaxHighlighter, this);
+
     // 创建输入管理器
     m_inputManager = new InputManager(this);
     //setupInputManager();
@@ -84,8 +91,9 @@ void TextRenderer::connectSignals()
     if (m_cursorManager) {
         connect(m_cursorManager, &CursorManager::cursorPositionChanged,
             this, &TextRenderer::onCursorChanged);
+        // 光标闪烁只重绘光标所在的单元
         connect(m_cursorManager, &CursorManager::cursorVisibilityChanged,
-            this, [this]() { this->update(); });
+            this, [this]() { this->updateCursorRegion(); });
         connect(m_cursorManager, &CursorManager::ensureVisibleRequested,
             this, [this](const QRect& rect) {
                 // 确保光标可见的逻辑
@@ -99,6 +107,39 @@ void TextRenderer::connectSignals()
             this, &TextRenderer::onSelectionChanged);
     }
 
+    // 语言变化后全部 token 都可能不同
+    if (m_syntaxHighlighter) {
+        connect(m_syntaxHighlighter, &SyntaxHighlighter::languageChanged,
+            this, [this]() {
+                // 折叠范围按语言的括号或缩进规则确定，换语言后原有折叠作废
+                if (m_foldingModel) {
+                    m_foldingModel->reset();
+                }
+                clearTiles();
+                update();
+            });
+        // 编辑使后续行的注释或字符串状态改变时，重绘这些行
+        connect(m_syntaxHighlighter, &SyntaxHighlighter::highlightingUpdated,
+            this, [this](int startLine, int endLine) {
+                if (endLine < 0) {
+                    invalidateTilesFrom(startLine);
+                    updateLinesFrom(startLine);
+                }
+                else {
+                    invalidateTiles(startLine, endLine);
+                    updateLineRange(startLine, endLine);
+                }
+                // 括号配对可能因新的分析结果改变
+                updateBracketRegion();
+            });
+    }
+
+    // 折叠变化后隐藏行由布局引擎的 layoutChanged 重绘
+    if (m_foldingModel) {
+        connect(m_foldingModel, &FoldingModel::foldingChanged,
+            this, &TextRenderer::foldingChanged);
+    }
+
     // 连接几何变化信号
     connect(this, &QQuickItem::widthChanged, this, &TextRenderer::onGeometryChanged);
     connect(this, &QQuickItem::heightChanged, this, &TextRenderer::onGeometryChanged);
@@ -123,6 +164,8 @@ void TextRenderer::setDocument(DocumentModel* document)
     }
 
     m_document = document;
+    m_knownLineCount = m_document ? m_document->lineCount() : 0;
+    clearTiles();
 
     if (m_document) {
         connect(m_document, &DocumentModel::textChanged,
@@ -130,22 +173,43 @@ void TextRenderer::setDocument(DocumentModel* document)
         connect(m_document, &DocumentModel::modifiedChanged,
             this, [this]() { this->update(); });
 
-        // 更新布局引擎的文本
+        // 布局引擎直接从文档读取行文本
         if (m_layoutEngine) {
-            m_layoutEngine->setText(m_document->getFullText());
+            m_layoutEngine->setDocument(m_document);
+        }
+        if (m_foldingModel) {
+            m_foldingModel->reset();
         }
 
         // 检测文件类型并设置语法高亮
         if (m_syntaxHighlighter) {
+            m_syntaxHighlighter->setDocument(m_document);
             m_syntaxHighlighter->setLanguageByFileExtension(
                 QFileInfo(m_document->filePath()).suffix());
         }
+        if (m_semanticTokenClient) {
+            m_semanticTokenClient->setDocument(m_document);
+        }
 
         // 将文档关联到选择管理器
         if (m_selectionManager) {
             m_selectionManager->setDocument(m_document);
         }
     }
+    else {
+        if (m_layoutEngine) {
+            m_layoutEngine->setDocument(nullptr);
+        }
+        if (m_foldingModel) {
+            m_foldingModel->reset();
+        }
+        if (m_syntaxHighlighter) {
+            m_syntaxHighlighter->setDocument(nullptr);
+        }
+        if (m_semanticTokenClient) {
+            m_semanticTokenClient->setDocument(nullptr);
+        }
+    }
 
     update();
     emit documentChanged();
@@ -162,6 +226,7 @@ void TextRenderer::setWordWrap(bool wrap)
         return;
 
     m_wordWrap = wrap;
+    clearTiles();
 
     if (m_layoutEngine) {
         m_layoutEngine->setWordWrap(wrap);
@@ -189,6 +254,10 @@ void TextRenderer::setFont(const QFont& font)
 
     m_font = font;
 
+    // 旧字体的字形串不会再命中
+    m_glyphRunCache.clear();
+    clearTiles();
+
     if (m_layoutEngine) {
         m_layoutEngine->setFont(font);
     }
@@ -224,6 +293,7 @@ void TextRenderer::setTextColor(const QColor& color)
         return;
 
     m_textColor = color;
+    clearTiles();
     update();
     emit textColorChanged();
 }
@@ -328,19 +398,25 @@ void TextRenderer::paint(QPainter* painter)
         return;
 
     painter->save();
+    beginHighlightFrame();
 
     // 设置渲染提示, 只在需要时启用抗锯齿，减少不必要的性能开销
     //painter->setRenderHint(QPainter::Antialiasing, true);
     painter->setRenderHint(QPainter::Antialiasing, false);
     painter->setRenderHint(QPainter::TextAntialiasing, true);
 
+    // 局部重绘时画笔已裁剪到脏区域，各步骤只处理与之相交的内容
     QRectF rect = boundingRect();
+    if (painter->hasClipping()) {
+        rect = rect.intersected(painter->clipBoundingRect());
+    }
 
     // 1. 绘制背景
     paintBackground(painter, rect);
 
-    // 2. 绘制当前行高亮
+    // 2. 绘制当前行高亮和配对括号
     paintCurrentLine(painter, rect);
+    paintMatchingBrackets(painter, rect);
 
     // 3. 绘制选择区域
     paintSelections(painter, rect);
@@ -400,7 +476,7 @@ void TextRenderer::paintLineNumbers(QPainter* painter, const QRectF& rect)
     QList<int> visibleLines = getVisibleLines();
 
     for (int lineNumber : visibleLines) {
-        qreal y = lineNumber * lineHeight - m_scrollY;
+        qreal y = visibleRow(lineNumber) * lineHeight - m_scrollY;
 
         if (y < rect.top() - lineHeight || y > rect.bottom() + lineHeight)
             continue;
@@ -429,108 +505,73 @@ void TextRenderer::paintText(QPainter* painter, const QRectF& rect)
     if (!m_document || !m_layoutEngine)
         return;
 
+    QRectF textRect = textArea();
+    QRectF target = textRect.intersected(rect);
+    if (target.isEmpty())
+        return;
+
     painter->save();
 
     // 设置剪切区域为文本区域
-    QRectF textRect = textArea();
-    painter->setClipRect(textRect.intersected(rect));
+    painter->setClipRect(target);
 
-    // 设置字体和颜色
-    painter->setFont(m_font);
-    painter->setPen(m_textColor);
-
-    QFontMetrics fm(m_font);
     qreal lineHeight = m_layoutEngine->lineHeight();
-
-    // 获取可见行
-    QList<int> visibleLines = getVisibleLines();
-
-    for (int lineNumber : visibleLines) {
-        QString lineText = m_document->getLine(lineNumber);
-        if (lineText.isEmpty())
-            continue;
-
-        qreal y = lineNumber * lineHeight - m_scrollY;
-        //qreal x = textRect.left() - m_scrollX;
-        qreal x = textRect.left() + TEXT_LEFT_PADDING - m_scrollX;
-
-		// TODO 这里paintHighlightedLine消耗CPU太高，需要优化，暂时先注释掉
-        // 如果有语法高亮
-        /*
-        if (m_syntaxHighlighter) {
-            QList<Token> tokens = m_syntaxHighlighter->tokenizeLine(lineText, lineNumber);
-            paintHighlightedLine(painter, lineText, tokens, QPointF(x, y));
+    qreal devicePixelRatio = painter->device() ? painter->device()->devicePixelRatio() : 1.0;
+
+    // 文档末尾所在的带之后没有内容
+    int lastDocumentBand = qMax(0, qFloor((visibleRowCount() * lineHeight - 1) / TILE_HEIGHT));
+
+    // 丢弃离开视口较远的图块，快速滚动时缓存不会无限增长
+    int firstVisibleBand = qMax(0, qFloor(static_cast<qreal>(m_scrollY) / TILE_HEIGHT));
+    int lastVisibleBand = qFloor((m_scrollY + height()) / TILE_HEIGHT);
+    for (auto it = m_textTiles.begin(); it != m_textTiles.end();) {
+        if (it.key() < firstVisibleBand - TILE_KEEP_MARGIN ||
+            it.key() > lastVisibleBand + TILE_KEEP_MARGIN) {
+            it = m_textTiles.erase(it);
         }
         else {
-            // 普通文本绘制
-            painter->drawText(QPointF(x, y + fm.ascent()), lineText);
+            ++it;
         }
-        */
-        painter->drawText(QPointF(x, y + fm.ascent()), lineText);
     }
 
-    painter->restore();
-}
-
-void TextRenderer::paintHighlightedLine(QPainter* painter, const QString& lineText,
-    const QList<Token>& tokens, const QPointF& position)
-{
-    QFontMetrics fm(m_font);
-    qreal x = position.x();
-    qreal y = position.y();
-
-    int lastPos = 0;
-
-    for (const Token& token : tokens) {
-        // 绘制token之前的普通文本
-        if (token.position > lastPos) {
-            QString normalText = lineText.mid(lastPos, token.position - lastPos);
-            painter->setPen(m_textColor);
-            painter->drawText(QPointF(x, y + fm.ascent()), normalText);
-            x += fm.horizontalAdvance(normalText);
-        }
-
-        // 绘制高亮的token
-        QString tokenText = lineText.mid(token.position, token.length);
-        QTextCharFormat format = m_syntaxHighlighter->getFormat(token.type);
-
-        // 应用格式
-        if (format.hasProperty(QTextFormat::ForegroundBrush)) {
-            painter->setPen(format.foreground().color());
-        }
-        else {
-            painter->setPen(m_textColor);
-        }
+    // 只处理与重绘区域相交的带；已有的图块只是换个位置贴图
+    int firstBand = qMax(0, qFloor((m_scrollY + target.top()) / TILE_HEIGHT));
+    int lastBand = qMin(lastDocumentBand, qFloor((m_scrollY + target.bottom() - 1) / TILE_HEIGHT));
 
-        if (format.fontWeight() == QFont::Bold) {
-            QFont boldFont = m_font;
-            boldFont.setBold(true);
-            painter->setFont(boldFont);
+    for (int band = firstBand; band <= lastBand; ++band) {
+        TextTile& tile = m_textTiles[band];
+        if (tile.image.isNull() || tile.scrollX != m_scrollX ||
+            !qFuzzyCompare(tile.width, textRect.width()) ||
+            !qFuzzyCompare(tile.image.devicePixelRatio(), devicePixelRatio)) {
+            renderTextTile(tile, band, textRect.width(), devicePixelRatio);
         }
 
-        painter->drawText(QPointF(x, y + fm.ascent()), tokenText);
-        x += fm.horizontalAdvance(tokenText);
+        painter->drawImage(QPointF(textRect.left(), static_cast<qreal>(band) * TILE_HEIGHT - m_scrollY),
+            tile.image);
+    }
 
-        // 恢复原字体
-        if (format.fontWeight() == QFont::Bold) {
-            painter->setFont(m_font);
-        }
+    painter->restore();
+}
 
-        lastPos = token.position + token.length;
-    }
+void TextRenderer::paintHighlightedLine(QPainter* painter, const QString& lineText,
+    const QList<GlyphRunCache::Span>& spans, const QPointF& position)
+{
+    const QList<GlyphRunCache::Run>& runs = m_glyphRunCache.runs(
+        lineText, spans, m_font, m_layoutEngine->tabWidth());
 
-    // 绘制剩余的普通文本
-    if (lastPos < lineText.length()) {
-        QString remainingText = lineText.mid(lastPos);
-        painter->setPen(m_textColor);
-        painter->drawText(QPointF(x, y + fm.ascent()), remainingText);
+    // 字形位置相对于行的左上角
+    for (const GlyphRunCache::Run& run : runs) {
+        painter->setPen(run.color);
+        painter->drawGlyphRun(position, run.glyphs);
     }
 }
 
 void TextRenderer::paintSelections(QPainter* painter, const QRectF& rect)
 {
-    if (!m_selectionManager || !m_selectionManager->hasSelection())
+    if (!m_selectionManager || !m_selectionManager->hasSelection()) {
+        m_paintedSelectionRect = QRect();
         return;
+    }
 
     painter->save();
 
@@ -538,11 +579,13 @@ void TextRenderer::paintSelections(QPainter* painter, const QRectF& rect)
     QColor selectionColor = m_selectionManager->selectionColor();
 
     QList<SelectionRange> selections = m_selectionManager->selections();
+    m_paintedSelectionRect = QRect();
 
     for (const SelectionRange& selection : selections) {
         QList<QRect> selectionRects = getSelectionRects(selection);
 
         for (const QRect& selRect : selectionRects) {
+            m_paintedSelectionRect |= selRect;
             if (rect.intersects(selRect)) {
                 painter->fillRect(selRect, selectionColor);
             }
@@ -559,6 +602,8 @@ void TextRenderer::paintCursors(QPainter* painter, const QRectF& rect)
 
     painter->save();
 
+    m_paintedCursorRects.clear();
+
     // 只在获得焦点且闪烁可见时绘制光标
     if (!hasActiveFocus() || !m_cursorManager->isBlinkVisible()) {
         painter->restore();
@@ -570,11 +615,8 @@ void TextRenderer::paintCursors(QPainter* painter, const QRectF& rect)
     QList<Cursor> cursors = m_cursorManager->cursors();
 
     for (const Cursor& cursor : cursors) {
-        QPoint cursorPoint = positionToPoint(cursor.position);
-        QFontMetrics fm(m_font);
-
-        QRect cursorRect(cursorPoint.x() - 1, cursorPoint.y(),
-            2, fm.height());
+        QRect cursorRect = this->cursorRect(cursor.position);
+        m_paintedCursorRects.append(cursorRect);
 
         if (rect.intersects(cursorRect)) {
             painter->drawLine(cursorRect.topLeft(), cursorRect.bottomLeft());
@@ -586,13 +628,16 @@ void TextRenderer::paintCursors(QPainter* painter, const QRectF& rect)
 
 void TextRenderer::paintCurrentLine(QPainter* painter, const QRectF& rect)
 {
-    if (!m_cursorManager || !hasActiveFocus())
+    if (!m_cursorManager || !hasActiveFocus()) {
+        m_paintedCurrentLine = -1;
         return;
+    }
 
     painter->save();
 
     int currentLine = m_document ?
         m_document->positionToLine(m_cursorManager->cursorPosition()) : 0;
+    m_paintedCurrentLine = currentLine;
 
     QRect lineRect = this->lineRect(currentLine);
 
@@ -604,6 +649,18 @@ void TextRenderer::paintCurrentLine(QPainter* painter, const QRectF& rect)
     painter->restore();
 }
 
+void TextRenderer::paintMatchingBrackets(QPainter* painter, const QRectF& rect)
+{
+    m_paintedBracketRects = bracketRects();
+
+    QColor bracketColor = m_backgroundColor.darker(115);
+    for (const QRect& bracketRect : std::as_const(m_paintedBracketRects)) {
+        if (rect.intersects(bracketRect)) {
+            painter->fillRect(bracketRect, bracketColor);
+        }
+    }
+}
+
 // ==============================================================================
 // 坐标转换方法
 // ==============================================================================
@@ -621,7 +678,7 @@ QPoint TextRenderer::positionToPoint(int position) const
 
     qreal x = textArea().left() + TEXT_LEFT_PADDING + fm.horizontalAdvance(
         m_document->getLine(line).left(column)) - m_scrollX;
-    qreal y = line * lineHeight - m_scrollY;
+    qreal y = visibleRow(line) * lineHeight - m_scrollY;
 
     return QPoint(static_cast<int>(x), static_cast<int>(y));
 }
@@ -638,10 +695,11 @@ int TextRenderer::pointToPosition(const QPointF& point) const
     qreal adjustedY = point.y() + m_scrollY;
 
     qreal lineHeight = m_layoutEngine->lineHeight();
-    int line = static_cast<int>(adjustedY / lineHeight);
+    int row = static_cast<int>(adjustedY / lineHeight);
 
-    // 边界检查
-    line = qBound(0, line, m_document->lineCount() - 1);
+    // 边界检查；折叠区域之后的显示行换算回文档行
+    row = qBound(0, row, visibleRowCount() - 1);
+    int line = lineAtRow(row);
 
     QString lineText = m_document->getLine(line);
     QFontMetrics fm(m_font);
@@ -667,7 +725,7 @@ QRect TextRenderer::lineRect(int lineNumber) const
         return QRect();
 
     qreal lineHeight = m_layoutEngine->lineHeight();
-    qreal y = lineNumber * lineHeight - m_scrollY;
+    qreal y = visibleRow(lineNumber) * lineHeight - m_scrollY;
 
     return QRect(0, static_cast<int>(y),
         static_cast<int>(width()),
@@ -686,14 +744,15 @@ QList<int> TextRenderer::getVisibleLines() const
         return visibleLines;
 
     qreal lineHeight = m_layoutEngine->lineHeight();
-    int firstLine = static_cast<int>(m_scrollY / lineHeight);
-    int lastLine = static_cast<int>((m_scrollY + height()) / lineHeight) + 1;
+    int firstRow = static_cast<int>(m_scrollY / lineHeight);
+    int lastRow = static_cast<int>((m_scrollY + height()) / lineHeight) + 1;
 
-    firstLine = qMax(0, firstLine);
-    lastLine = qMin(m_document->lineCount() - 1, lastLine);
+    firstRow = qMax(0, firstRow);
+    lastRow = qMin(visibleRowCount() - 1, lastRow);
 
-    for (int i = firstLine; i <= lastLine; ++i) {
-        visibleLines.append(i);
+    // 折叠隐藏的行不在其中
+    for (int row = firstRow; row <= lastRow; ++row) {
+        visibleLines.append(lineAtRow(row));
     }
 
     return visibleLines;
@@ -721,13 +780,51 @@ void TextRenderer::ensurePositionVisible(int position)
     }
 }
 
+bool TextRenderer::toggleFold(int lineNumber)
+{
+    return m_foldingModel && m_foldingModel->toggleFold(lineNumber);
+}
+
+void TextRenderer::foldAll()
+{
+    if (m_foldingModel) {
+        m_foldingModel->foldAll();
+    }
+}
+
+void TextRenderer::unfoldAll()
+{
+    if (m_foldingModel) {
+        m_foldingModel->unfoldAll();
+    }
+}
+
+bool TextRenderer::isFolded(int lineNumber) const
+{
+    return m_foldingModel && m_foldingModel->isFolded(lineNumber);
+}
+
+void TextRenderer::startSemanticTokenServer(const QString& program, const QStringList& arguments)
+{
+    if (m_semanticTokenClient) {
+        m_semanticTokenClient->start(program, arguments);
+    }
+}
+
+void TextRenderer::stopSemanticTokenServer()
+{
+    if (m_semanticTokenClient) {
+        m_semanticTokenClient->stop();
+    }
+}
+
 void TextRenderer::ensureLineVisible(int lineNumber)
 {
     if (!m_layoutEngine)
         return;
 
     qreal lineHeight = m_layoutEngine->lineHeight();
-    qreal lineY = lineNumber * lineHeight;
+    qreal lineY = visibleRow(lineNumber) * lineHeight;
 
     if (lineY < m_scrollY) {
         setScrollY(static_cast<int>(lineY));
@@ -811,7 +908,7 @@ void TextRenderer::wheelEvent(QWheelEvent* event)
     }
     else {
         int maxScroll = qMax(0, static_cast<int>(
-            (m_document ? m_document->lineCount() : 0) *
+            (m_document ? visibleRowCount() : 0) *
             (m_layoutEngine ? m_layoutEngine->lineHeight() : 20) - height()));
         setScrollY(qMin(maxScroll, m_scrollY + scrollStep *
             static_cast<int>(m_layoutEngine ? m_layoutEngine->lineHeight() : 20)));
@@ -961,12 +1058,13 @@ int TextRenderer::calculateVerticalCharacterMovement(int currentPos, MoveDirecti
     int currentColumn = m_document->positionToColumn(currentPos);
     int targetLine = currentLine;
 
-    // 计算目标行
+    // 计算目标行：按显示行移动，跨过折叠区域
+    int currentRow = visibleRow(currentLine);
     if (direction == MoveDirection::Up) {
-        targetLine = qMax(0, currentLine - 1);
+        targetLine = lineAtRow(qMax(0, currentRow - 1));
     }
     else if (direction == MoveDirection::Down) {
-        targetLine = qMin(m_document->lineCount() - 1, currentLine + 1);
+        targetLine = lineAtRow(qMin(visibleRowCount() - 1, currentRow + 1));
     }
 
     // 如果行号没有变化，返回原位置
@@ -1165,14 +1263,15 @@ int TextRenderer::calculatePageMovement(int currentPos, MoveDirection direction)
     int visibleLines = static_cast<int>(height() / lineHeight);
 
     int targetLine = currentLine;
+    int currentRow = visibleRow(currentLine);
 
     if (direction == MoveDirection::Up) {
         // 向上一页
-        targetLine = qMax(0, currentLine - visibleLines);
+        targetLine = lineAtRow(qMax(0, currentRow - visibleLines));
     }
     else if (direction == MoveDirection::Down) {
         // 向下一页
-        targetLine = qMin(m_document->lineCount() - 1, currentLine + visibleLines);
+        targetLine = lineAtRow(qMin(visibleRowCount() - 1, currentRow + visibleLines));
     }
 
     // 保持列位置
@@ -1234,27 +1333,81 @@ QVariant TextRenderer::inputMethodQuery(Qt::InputMethodQuery query) const
 // 槽函数实现
 // ==============================================================================
 
-void TextRenderer::onDocumentChanged()
+void TextRenderer::onDocumentChanged(const TextChange& change)
 {
-    if (m_layoutEngine && m_document) {
-        m_layoutEngine->setText(m_document->getFullText());
+    if (!m_document) {
+        update();
+        return;
+    }
+
+    // 只调整受影响的行，不重新切分全文；由此发出的 layoutChanged 在下面按变更范围处理
+    if (m_layoutEngine) {
+        m_applyingDocumentChange = true;
+        m_layoutEngine->updateText(change.position, change.removedLength, change.insertedText);
+        m_applyingDocumentChange = false;
+    }
+
+    int startLine = m_document->positionToLine(change.position);
+    int lineCount = m_document->lineCount();
+    int addedLines = change.insertedText.count(QLatin1Char('\n'));
+    int removedLines = m_knownLineCount - lineCount + addedLines;
+
+    // 语法高亮从编辑行开始增量更新，状态变化波及的后续行由 highlightingUpdated 通知
+    if (m_syntaxHighlighter) {
+        m_syntaxHighlighter->updateHighlighting(startLine, removedLines, addedLines);
+    }
+
+    // 之后的折叠随行号移动，编辑触及的折叠展开（展开时由 layoutChanged 整体重绘）
+    if (m_foldingModel) {
+        m_foldingModel->updateForEdit(startLine, removedLines, addedLines);
+    }
+
+    if (lineCount != m_knownLineCount) {
+        // 行数变化：之后的行整体移动，行号宽度也可能改变
+        invalidateTilesFrom(startLine);
+        m_knownLineCount = lineCount;
+        qreal oldLineNumberWidth = m_lineNumberWidth;
+        updateLineNumberWidth();
+
+        if (!qFuzzyCompare(oldLineNumberWidth, m_lineNumberWidth)) {
+            update();
+        }
+        else {
+            updateLinesFrom(startLine);
+        }
+    }
+    else {
+        // 行数不变时只有插入文本覆盖的行发生变化
+        int endLine = m_document->positionToLine(change.position + change.insertedText.length());
+        invalidateTiles(startLine, endLine);
+        updateLineRange(startLine, endLine);
     }
-    update();
 }
 
 void TextRenderer::onLayoutChanged()
 {
+    if (m_applyingDocumentChange)
+        return;
+
+    clearTiles();
     update();
 }
 
 void TextRenderer::onCursorChanged()
 {
-    update();
+    // 光标移入折叠区域时展开
+    if (m_foldingModel && m_document && m_cursorManager) {
+        m_foldingModel->revealLine(m_document->positionToLine(m_cursorManager->cursorPosition()));
+    }
+
+    updateCurrentLineRegion();
+    updateBracketRegion();
+    updateCursorRegion();
 }
 
 void TextRenderer::onSelectionChanged()
 {
-    update();
+    updateSelectionRegion();
 }
 
 void TextRenderer::onGeometryChanged()
@@ -1306,6 +1459,382 @@ void TextRenderer::updateLineNumberWidth()
     }
 }
 
+void TextRenderer::updateLineRange(int firstLine, int lastLine)
+{
+    if (firstLine > lastLine) {
+        qSwap(firstLine, lastLine);
+    }
+
+    // 行带覆盖整个宽度，包括行号区（当前行的行号颜色不同）
+    QRect band = lineRect(firstLine).united(lineRect(lastLine));
+    if (band.intersects(boundingRect().toAlignedRect())) {
+        update(band);
+    }
+}
+
+void TextRenderer::updateLinesFrom(int firstLine)
+{
+    QRect bounds = boundingRect().toAlignedRect();
+    QRect band = lineRect(firstLine);
+    band.setBottom(bounds.bottom());
+    if (band.intersects(bounds)) {
+        update(band);
+    }
+}
+
+void TextRenderer::updateCursorRegion()
+{
+    if (!m_cursorManager) {
+        update();
+        return;
+    }
+
+    // 上次绘制的光标和当前光标所在的单元，画笔宽 2 像素，略微外扩
+    const QMargins margins(2, 2, 2, 2);
+
+    for (const QRect& rect : std::as_const(m_paintedCursorRects)) {
+        update(rect.marginsAdded(margins));
+    }
+
+    const QList<Cursor> cursors = m_cursorManager->cursors();
+    for (const Cursor& cursor : cursors) {
+        update(cursorRect(cursor.position).marginsAdded(margins));
+    }
+}
+
+void TextRenderer::updateCurrentLineRegion()
+{
+    if (!m_document || !m_cursorManager) {
+        update();
+        return;
+    }
+
+    int currentLine = m_document->positionToLine(m_cursorManager->cursorPosition());
+    if (currentLine == m_paintedCurrentLine)
+        return;
+
+    if (m_paintedCurrentLine >= 0) {
+        updateLineRange(m_paintedCurrentLine, m_paintedCurrentLine);
+    }
+    updateLineRange(currentLine, currentLine);
+}
+
+void TextRenderer::updateBracketRegion()
+{
+    // 旧的和新的配对括号都要重绘，配对查找由括号索引完成，每次光标移动都可以调用
+    const QList<QRect> rects = bracketRects();
+    if (rects == m_paintedBracketRects)
+        return;
+
+    for (const QRect& rect : std::as_const(m_paintedBracketRects)) {
+        update(rect);
+    }
+    for (const QRect& rect : rects) {
+        update(rect);
+    }
+}
+
+void TextRenderer::updateSelectionRegion()
+{
+    // 旧选区和新选区的包围矩形
+    QRect region = m_paintedSelectionRect | selectionBoundingRect();
+    if (!region.isEmpty()) {
+        update(region);
+    }
+}
+
+TextRenderer::LineWindow TextRenderer::lineWindow(const QString& lineText) const
+{
+    LineWindow window;
+    window.length = static_cast<int>(lineText.length());
+
+    const int threshold = m_syntaxHighlighter
+        ? m_syntaxHighlighter->longLineThreshold() : SyntaxHighlighter::DEFAULT_LONG_LINE_LENGTH;
+    if (!m_layoutEngine || lineText.length() <= threshold)
+        return window;
+
+    // 覆盖当前分段及左右各一段；按等宽列换算，与布局引擎的等宽路径一致
+    const qreal characterWidth = m_layoutEngine->characterWidth();
+    const int tabColumns = qMax(1, qRound(m_layoutEngine->tabWidth() / characterWidth));
+    const qreal span = qMax<qreal>(1.0, textArea().width());
+    const int key = horizontalWindowKey();
+    const int firstColumn = qMax(0, qFloor((key - 1) * span / characterWidth));
+    const int lastColumn = qCeil((key + 2) * span / characterWidth);
+
+    // 起点取制表位对齐的列，窗口内的制表符与整行排版时落在同一位置
+    int visualColumn = 0;
+    int startColumn = 0;
+    int end = 0;
+    for (; end < lineText.length() && visualColumn < lastColumn; ++end) {
+        if (visualColumn <= firstColumn && visualColumn % tabColumns == 0) {
+            window.start = end;
+            startColumn = visualColumn;
+        }
+        visualColumn += lineText.at(end) == QLatin1Char('\t') ? tabColumns - visualColumn % tabColumns : 1;
+    }
+
+    // 不拆开代理对
+    if (window.start > 0 && lineText.at(window.start).isLowSurrogate()) {
+        window.start--;
+        startColumn--;
+    }
+    if (end < lineText.length() && lineText.at(end).isLowSurrogate()) {
+        end++;
+    }
+
+    window.length = end - window.start;
+    window.x = startColumn * characterWidth;
+    return window;
+}
+
+int TextRenderer::horizontalWindowKey() const
+{
+    return qFloor(m_scrollX / qMax<qreal>(1.0, textArea().width()));
+}
+
+void TextRenderer::beginHighlightFrame()
+{
+    m_highlightFrameTimer.start();
+}
+
+void TextRenderer::setHighlightFrameBudget(int milliseconds)
+{
+    m_highlightFrameBudget = qMax(0, milliseconds);
+}
+
+QList<GlyphRunCache::Span> TextRenderer::lineSpans(const QString& lineText, int lineNumber,
+    const LineWindow& window) const
+{
+    const int windowEnd = window.start + window.length;
+
+    QList<Token> tokens;
+    if (m_syntaxHighlighter) {
+        // 按行缓存的 token，由高亮器在后台分析；尚未分析的行按纯文本绘制。
+        // 超长行只取窗口内的一段，本帧预算未用完时先分析窗口
+        const bool withinBudget = !m_highlightFrameTimer.isValid() ||
+            m_highlightFrameTimer.elapsed() < m_highlightFrameBudget;
+        tokens = m_syntaxHighlighter->lineTokens(lineNumber, lineText, window.start, windowEnd, withinBudget);
+    }
+
+    // 按 token 切分为格式段，token 之间的普通文本使用默认颜色，相邻的同格式段合并
+    QList<GlyphRunCache::Span> spans;
+
+    auto appendSpan = [&](int start, int length, const QColor& color, bool bold) {
+        if (length <= 0)
+            return;
+
+        start -= window.start;
+        if (!spans.isEmpty()) {
+            GlyphRunCache::Span& last = spans.last();
+            if (last.start + last.length == start && last.color == color && last.bold == bold) {
+                last.length += length;
+                return;
+            }
+        }
+
+        spans.append(GlyphRunCache::Span{ start, length, color, bold });
+    };
+
+    int lastPos = window.start;
+
+    for (const Token& token : tokens) {
+        int start = qBound(lastPos, token.position, windowEnd);
+        int end = qBound(start, token.position + token.length, windowEnd);
+
+        // token之前的普通文本
+        appendSpan(lastPos, start - lastPos, m_textColor, false);
+
+        // 高亮的token
+        const SyntaxHighlighter::TokenStyle& style = m_syntaxHighlighter->tokenStyle(token.type);
+        appendSpan(start, end - start, style.hasColor ? style.color : m_textColor, style.bold);
+
+        lastPos = end;
+    }
+
+    // 剩余的普通文本
+    appendSpan(lastPos, windowEnd - lastPos, m_textColor, false);
+
+    return spans;
+}
+
+QList<QRect> TextRenderer::selectionRects() const
+{
+    QList<QRect> result;
+    if (!m_selectionManager || !m_selectionManager->hasSelection())
+        return result;
+
+    const QList<SelectionRange> selections = m_selectionManager->selections();
+    for (const SelectionRange& selection : selections) {
+        result.append(getSelectionRects(selection));
+    }
+
+    return result;
+}
+
+QList<QRect> TextRenderer::bracketRects() const
+{
+    QList<QRect> result;
+    if (!m_syntaxHighlighter || !m_cursorManager || !m_document || !hasActiveFocus())
+        return result;
+
+    // 优先匹配光标后的括号，其次是光标前的括号
+    int position = m_cursorManager->cursorPosition();
+    QPair<int, int> match = m_syntaxHighlighter->findMatchingBracket(position);
+    if (match.first < 0 && position > 0) {
+        match = m_syntaxHighlighter->findMatchingBracket(position - 1);
+    }
+    if (match.first < 0)
+        return result;
+
+    QFontMetrics fm(m_font);
+    for (int bracket : { match.first, match.second }) {
+        // 配对括号在折叠区域内时不标出
+        if (m_layoutEngine && m_layoutEngine->isLineHidden(m_document->positionToLine(bracket)))
+            continue;
+
+        QPoint left = positionToPoint(bracket);
+        QPoint right = positionToPoint(bracket + 1);
+        result.append(QRect(left.x(), left.y(), qMax(1, right.x() - left.x()), fm.height()));
+    }
+
+    return result;
+}
+
+QList<QRect> TextRenderer::cursorRects() const
+{
+    QList<QRect> result;
+    if (!m_cursorManager)
+        return result;
+
+    const QList<Cursor> cursors = m_cursorManager->cursors();
+    for (const Cursor& cursor : cursors) {
+        result.append(cursorRect(cursor.position));
+    }
+
+    return result;
+}
+
+int TextRenderer::visibleRow(int lineNumber) const
+{
+    return m_layoutEngine ? m_layoutEngine->visibleLineIndex(lineNumber) : lineNumber;
+}
+
+int TextRenderer::lineAtRow(int row) const
+{
+    return m_layoutEngine ? m_layoutEngine->lineAtVisibleIndex(row) : row;
+}
+
+int TextRenderer::visibleRowCount() const
+{
+    if (!m_document)
+        return 0;
+
+    return m_layoutEngine ? m_layoutEngine->visibleLineCount() : m_document->lineCount();
+}
+
+void TextRenderer::setContentsPainted(bool painted)
+{
+    if (m_contentsPainted == painted)
+        return;
+
+    // 不再有内容时场景图会释放该项的纹理，光栅化和上传都不再发生
+    m_contentsPainted = painted;
+    setFlag(QQuickItem::ItemHasContents, painted);
+    update();
+}
+
+void TextRenderer::renderTextTile(TextTile& tile, int band, qreal width, qreal devicePixelRatio)
+{
+    QSize pixelSize(qCeil(width * devicePixelRatio), qCeil(TILE_HEIGHT * devicePixelRatio));
+
+    tile.image = QImage(pixelSize, QImage::Format_ARGB32_Premultiplied);
+    tile.image.setDevicePixelRatio(devicePixelRatio);
+    tile.image.fill(Qt::transparent);
+    tile.scrollX = m_scrollX;
+    tile.width = width;
+
+    if (!m_document || !m_layoutEngine)
+        return;
+
+    QPainter tilePainter(&tile.image);
+    tilePainter.setRenderHint(QPainter::TextAntialiasing, true);
+    tilePainter.setFont(m_font);
+
+    // 与带相交的行都要绘制，跨越带边界的行在相邻两个图块中各画一部分
+    qreal lineHeight = m_layoutEngine->lineHeight();
+    qreal bandTop = static_cast<qreal>(band) * TILE_HEIGHT;
+    int firstRow = qFloor(bandTop / lineHeight);
+    int lastRow = qMin(visibleRowCount() - 1, qFloor((bandTop + TILE_HEIGHT - 1) / lineHeight));
+
+    for (int row = firstRow; row <= lastRow; ++row) {
+        int lineNumber = lineAtRow(row);
+        QString lineText = m_document->getLine(lineNumber);
+        if (lineText.isEmpty())
+            continue;
+
+        // 字形串按行内容和格式缓存，只有变化的行才重新塑形；超长行只塑形横向窗口内的一段
+        const LineWindow window = lineWindow(lineText);
+        const QString text = window.length == lineText.length()
+            ? lineText : lineText.mid(window.start, window.length);
+        QPointF position(TEXT_LEFT_PADDING - m_scrollX + window.x, row * lineHeight - bandTop);
+        paintHighlightedLine(&tilePainter, text, lineSpans(lineText, lineNumber, window), position);
+    }
+}
+
+void TextRenderer::invalidateTiles(int firstLine, int lastLine)
+{
+    if (m_textTiles.isEmpty() || !m_layoutEngine)
+        return;
+
+    if (firstLine > lastLine) {
+        qSwap(firstLine, lastLine);
+    }
+
+    // 图块按显示行切分，折叠区域之后的行上移
+    qreal lineHeight = m_layoutEngine->lineHeight();
+    int firstBand = qFloor(visibleRow(firstLine) * lineHeight / TILE_HEIGHT);
+    int lastBand = qFloor(((visibleRow(lastLine) + 1) * lineHeight - 1) / TILE_HEIGHT);
+
+    for (int band = firstBand; band <= lastBand; ++band) {
+        m_textTiles.remove(band);
+    }
+}
+
+void TextRenderer::invalidateTilesFrom(int firstLine)
+{
+    if (m_textTiles.isEmpty() || !m_layoutEngine)
+        return;
+
+    int firstBand = qFloor(visibleRow(firstLine) * m_layoutEngine->lineHeight() / TILE_HEIGHT);
+    m_textTiles.removeIf([firstBand](const QHash<int, TextTile>::iterator& it) {
+        return it.key() >= firstBand;
+    });
+}
+
+void TextRenderer::clearTiles()
+{
+    m_textTiles.clear();
+}
+
+QRect TextRenderer::cursorRect(int position) const
+{
+    QPoint cursorPoint = positionToPoint(position);
+    QFontMetrics fm(m_font);
+
+    return QRect(cursorPoint.x() - 1, cursorPoint.y(), 2, fm.height());
+}
+
+QRect TextRenderer::selectionBoundingRect() const
+{
+    QRect result;
+    const QList<QRect> rects = selectionRects();
+    for (const QRect& rect : rects) {
+        result |= rect;
+    }
+
+    return result;
+}
+
 QRectF TextRenderer::textArea() const
 {
     qreal left = m_showLineNumbers ? m_lineNumberWidth : 0;
@@ -1334,7 +1863,12 @@ QList<QRect> TextRenderer::getSelectionRects(const SelectionRange& selection) co
     qreal lineHeight = m_layoutEngine ? m_layoutEngine->lineHeight() : fm.lineSpacing();
     QRectF textRect = textArea();
 
-    for (int line = startLine; line <= endLine; ++line) {
+    // 按显示行遍历，选区跨过的折叠区域不逐行处理
+    for (int row = visibleRow(startLine); row < visibleRowCount(); ++row) {
+        int line = lineAtRow(row);
+        if (line > endLine)
+            break;
+
         QString lineText = m_document->getLine(line);
 
         int lineStart = m_document->lineColumnToPosition(line, 0);
@@ -1346,7 +1880,7 @@ QList<QRect> TextRenderer::getSelectionRects(const SelectionRange& selection) co
         if (selStart < selEnd) {
             qreal x1 = textRect.left() + fm.horizontalAdvance(lineText.left(selStart)) - m_scrollX;
             qreal x2 = textRect.left() + fm.horizontalAdvance(lineText.left(selEnd)) - m_scrollX;
-            qreal y = line * lineHeight - m_scrollY;
+            qreal y = row * lineHeight - m_scrollY;
 
             rects.append(QRect(static_cast<int>(x1), static_cast<int>(y),
                 static_cast<int>(x2 - x1), static_cast<int>(lineHeight)));
@@ -9,9 +9,13 @@
 #include <QRectF>
 #include <QPoint>
 #include <QList>
+#include <QHash>
+#include <QImage>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <qqmlintegration.h>
 #include "../core/DocumentModel.h"
+#include "GlyphRunCache.h"
 
 // 前向声明
 //class DocumentModel;
@@ -19,6 +23,8 @@ class LayoutEngine;
 class CursorManager;
 class SelectionManager;
 class SyntaxHighlighter;
+class FoldingModel;
+class SemanticTokenClient;
 class InputManager;
 class InputHandler;
 class QMouseEvent;
@@ -106,11 +112,57 @@ public:
     Q_INVOKABLE void ensurePositionVisible(int position);
     Q_INVOKABLE void ensureLineVisible(int lineNumber);
 
+    // 代码折叠
+    Q_INVOKABLE bool toggleFold(int lineNumber);
+    Q_INVOKABLE void foldAll();
+    Q_INVOKABLE void unfoldAll();
+    Q_INVOKABLE bool isFolded(int lineNumber) const;
+
+    // 语义高亮：启动本地的语言服务器（经标准输入输出通信），其语义 token 叠加在词法高亮之上
+    Q_INVOKABLE void startSemanticTokenServer(const QString& program,
+        const QStringList& arguments = QStringList());
+    Q_INVOKABLE void stopSemanticTokenServer();
+
     // 暴露布局引擎和其他管理器的访问方法，供控制器使用
     LayoutEngine* layoutEngine() const { return m_layoutEngine; }
     CursorManager* cursorManager() const { return m_cursorManager; }
     SelectionManager* selectionManager() const { return m_selectionManager; }
     SyntaxHighlighter* syntaxHighlighter() const { return m_syntaxHighlighter; }
+    FoldingModel* foldingModel() const { return m_foldingModel; }
+    SemanticTokenClient* semanticTokenClient() const { return m_semanticTokenClient; }
+
+    // 供场景图渲染层使用的几何与格式信息
+    static constexpr int TEXT_LEFT_PADDING = 5; // 文本左侧内边距
+    QRectF textArea() const;
+    QRectF lineNumberArea() const;
+    // 超长行只排版横向可见窗口附近的一段：[start, start + length)，x 为 start 处相对行首的横坐标。
+    // 窗口按视口宽度分段对齐，横向滚动不超过一段时不变；普通行的窗口即整行
+    struct LineWindow {
+        int start = 0;
+        int length = 0;
+        qreal x = 0;
+    };
+    LineWindow lineWindow(const QString& lineText) const;
+    int horizontalWindowKey() const;
+    // 窗口内的格式段，起点相对于 window.start
+    QList<GlyphRunCache::Span> lineSpans(const QString& lineText, int lineNumber,
+        const LineWindow& window) const;
+    // 每帧绘制前调用：本帧按需分析超长行窗口的时间从此计起，超出预算后其余超长行按纯文本绘制
+    void beginHighlightFrame();
+    int highlightFrameBudget() const { return m_highlightFrameBudget; }
+    void setHighlightFrameBudget(int milliseconds);
+    QList<QRect> selectionRects() const;
+    QList<QRect> cursorRects() const;
+    QList<QRect> bracketRects() const;  // 光标处括号及其配对括号
+
+    // 显示行：跳过折叠隐藏的行后的序号，纵坐标为显示行乘以行高；没有折叠时与行号相同
+    int visibleRow(int lineNumber) const;
+    int lineAtRow(int row) const;
+    int visibleRowCount() const;
+
+    // 关闭后不再光栅化自身内容（由 SceneGraphTextLayer 绘制），只负责输入和状态
+    bool contentsPainted() const { return m_contentsPainted; }
+    void setContentsPainted(bool painted);
 
     /*
 public:
@@ -161,6 +213,7 @@ signals:
     void lineNumbersChanged();
     void lineNumberSeparatorColorChanged();
     void lineNumberExtraWidthChanged();
+    void foldingChanged();
 
     void mousePressed(QPointF position, Qt::MouseButton button, Qt::KeyboardModifiers modifiers);
     void mouseMoved(QPointF position, Qt::MouseButtons buttons, Qt::KeyboardModifiers modifiers);
@@ -183,7 +236,7 @@ protected:
     QVariant inputMethodQuery(Qt::InputMethodQuery query) const override;
 
 private slots:
-    void onDocumentChanged();
+    void onDocumentChanged(const TextChange& change);
     void onLayoutChanged();
     void onCursorChanged();
     void onSelectionChanged();
@@ -195,6 +248,8 @@ private:
     CursorManager* m_cursorManager = nullptr;
     SelectionManager* m_selectionManager = nullptr;
     SyntaxHighlighter* m_syntaxHighlighter = nullptr;
+    FoldingModel* m_foldingModel = nullptr;
+    SemanticTokenClient* m_semanticTokenClient = nullptr;
     InputManager* m_inputManager = nullptr;
 
     bool m_wordWrap = false;
@@ -212,20 +267,64 @@ private:
     int m_lastClickCount = 0;
     qint64 m_lastClickTime = 0;
 
+    // 已塑形的行字形串，光标闪烁等不改变文本的重绘不再重新塑形
+    GlyphRunCache m_glyphRunCache;
+
+    // 局部重绘：记录上次绘制的光标、当前行、配对括号和选区位置，状态变化时只重绘旧区域和新区域
+    QList<QRect> m_paintedCursorRects;
+    int m_paintedCurrentLine = -1;
+    QRect m_paintedSelectionRect;
+    QList<QRect> m_paintedBracketRects;
+    int m_knownLineCount = 0;
+    bool m_applyingDocumentChange = false;
+
+    bool m_contentsPainted = true;
+
+    // 每帧按需分析超长行窗口的时间预算（毫秒）
+    static constexpr int DEFAULT_HIGHLIGHT_FRAME_BUDGET = 8;
+    int m_highlightFrameBudget = DEFAULT_HIGHLIGHT_FRAME_BUDGET;
+    QElapsedTimer m_highlightFrameTimer;
+
+    // 文本图块：按内容纵坐标切分的文本带（透明底，只含文字），滚动时直接贴图，
+    // 只有新露出的带才绘制；行内容变化时按行范围失效
+    struct TextTile {
+        QImage image;
+        int scrollX = 0;
+        qreal width = 0;
+    };
+    static constexpr int TILE_HEIGHT = 256;
+    static constexpr int TILE_KEEP_MARGIN = 2;  // 视口上下额外保留的图块数
+    QHash<int, TextTile> m_textTiles;
+
     // 私有渲染方法
     void paintBackground(QPainter* painter, const QRectF& rect);
     void paintLineNumbers(QPainter* painter, const QRectF& rect);
     void paintText(QPainter* painter, const QRectF& rect);
     void paintHighlightedLine(QPainter* painter, const QString& lineText,
-        const QList<Token>& tokens, const QPointF& position);
+        const QList<GlyphRunCache::Span>& spans, const QPointF& position);
     void paintSelections(QPainter* painter, const QRectF& rect);
     void paintCursors(QPainter* painter, const QRectF& rect);
     void paintCurrentLine(QPainter* painter, const QRectF& rect);
+    void paintMatchingBrackets(QPainter* painter, const QRectF& rect);
+
+    // 局部重绘
+    void updateLineRange(int firstLine, int lastLine);
+    void updateLinesFrom(int firstLine);
+    void updateCursorRegion();
+    void updateCurrentLineRegion();
+    void updateBracketRegion();
+    void updateSelectionRegion();
+    QRect cursorRect(int position) const;
+    QRect selectionBoundingRect() const;
+
+    // 文本图块
+    void renderTextTile(TextTile& tile, int band, qreal width, qreal devicePixelRatio);
+    void invalidateTiles(int firstLine, int lastLine);
+    void invalidateTilesFrom(int firstLine);
+    void clearTiles();
 
     // 私有辅助方法
     void updateLineNumberWidth();
-    QRectF textArea() const;
-    QRectF lineNumberArea() const;
     QList<QRect> getSelectionRects(const SelectionRange& selection) const;
     int getClickCount(QMouseEvent* event);
 
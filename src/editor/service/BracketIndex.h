@@ -0,0 +1,149 @@
+#ifndef BRACKET_INDEX_H
+#define BRACKET_INDEX_H
+
+#include <QList>
+#include <QtGlobal>
+
+// 一行（或连续若干行）括号的净效果：开括号记 +1，闭括号记 -1
+// sum：总和；minPrefix：从左向右的最小前缀和；maxSuffix：从右向左的最大后缀和（都包含空序列的 0）
+struct BracketBalance {
+    qint32 sum = 0;
+    qint32 minPrefix = 0;
+    qint32 maxSuffix = 0;
+
+    bool operator==(const BracketBalance& other) const
+    {
+        return sum == other.sum && minPrefix == other.minPrefix && maxSuffix == other.maxSuffix;
+    }
+    bool operator!=(const BracketBalance& other) const { return !(*this == other); }
+
+    // 左右两段拼接
+    static BracketBalance combine(const BracketBalance& left, const BracketBalance& right)
+    {
+        BracketBalance result;
+        result.sum = left.sum + right.sum;
+        result.minPrefix = qMin(left.minPrefix, left.sum + right.minPrefix);
+        result.maxSuffix = qMax(right.maxSuffix, right.sum + left.maxSuffix);
+        return result;
+    }
+};
+
+// 括号配对索引（线段树）
+// 按行保存括号的净效果，查找跨行的配对括号所在行为 O(log n)：
+// 向后查找时，第一个使未配对开括号数降到 0 的行即配对所在行；向前查找同理。
+// 单行更新 O(log n)，行数变化时 O(n) 重建
+class BracketIndex {
+public:
+    BracketIndex() = default;
+
+    void build(const QList<BracketBalance>& lines)
+    {
+        m_size = lines.size();
+        m_leaves = 1;
+        while (m_leaves < m_size) {
+            m_leaves *= 2;
+        }
+
+        m_tree.fill(BracketBalance(), 2 * m_leaves);
+        for (int i = 0; i < m_size; ++i) {
+            m_tree[m_leaves + i] = lines[i];
+        }
+        for (int node = m_leaves - 1; node > 0; --node) {
+            m_tree[node] = BracketBalance::combine(m_tree[2 * node], m_tree[2 * node + 1]);
+        }
+    }
+
+    void clear()
+    {
+        m_tree.clear();
+        m_size = 0;
+        m_leaves = 0;
+    }
+
+    int size() const { return m_size; }
+
+    void update(int line, const BracketBalance& balance)
+    {
+        if (line < 0 || line >= m_size)
+            return;
+
+        int node = m_leaves + line;
+        m_tree[node] = balance;
+        for (node /= 2; node > 0; node /= 2) {
+            m_tree[node] = BracketBalance::combine(m_tree[2 * node], m_tree[2 * node + 1]);
+        }
+    }
+
+    // 从 line 行（含）起向后，带着 open 个未配对的开括号，返回配对所在的行；
+    // *remaining 为进入该行时仍未配对的开括号数。没有配对时返回 -1
+    int findForward(int line, int open, int* remaining) const
+    {
+        if (line < 0 || line >= m_size || open <= 0)
+            return -1;
+        return descendForward(1, 0, m_leaves, line, open, remaining);
+    }
+
+    // 从 line 行（含）起向前，带着 close 个未配对的闭括号，返回配对所在的行；
+    // *remaining 为从该行行尾进入时仍未配对的闭括号数。没有配对时返回 -1
+    int findBackward(int line, int close, int* remaining) const
+    {
+        if (line < 0 || line >= m_size || close <= 0)
+            return -1;
+        return descendBackward(1, 0, m_leaves, line, close, remaining);
+    }
+
+private:
+    QList<BracketBalance> m_tree; // 下标从 1 开始，叶子从 m_leaves 开始
+    int m_size = 0;
+    int m_leaves = 0;
+
+    // 在节点 [nodeBegin, nodeEnd) 与 [from, +∞) 的交集中查找；未找到时把整段的效果计入 open
+    int descendForward(int node, int nodeBegin, int nodeEnd, int from, int& open, int* remaining) const
+    {
+        if (nodeEnd <= from || nodeBegin >= m_size)
+            return -1;
+
+        const BracketBalance& balance = m_tree[node];
+        if (nodeBegin >= from && open + balance.minPrefix > 0) {
+            open += balance.sum;
+            return -1;
+        }
+
+        if (nodeEnd - nodeBegin == 1) {
+            *remaining = open;
+            return nodeBegin;
+        }
+
+        int middle = (nodeBegin + nodeEnd) / 2;
+        int line = descendForward(2 * node, nodeBegin, middle, from, open, remaining);
+        if (line >= 0)
+            return line;
+        return descendForward(2 * node + 1, middle, nodeEnd, from, open, remaining);
+    }
+
+    // 在节点 [nodeBegin, nodeEnd) 与 [0, to] 的交集中从右向左查找；未找到时把整段的效果计入 close
+    int descendBackward(int node, int nodeBegin, int nodeEnd, int to, int& close, int* remaining) const
+    {
+        if (nodeBegin > to || nodeBegin >= m_size)
+            return -1;
+
+        const BracketBalance& balance = m_tree[node];
+        if (nodeEnd - 1 <= to && balance.maxSuffix < close) {
+            close -= balance.sum;
+            return -1;
+        }
+
+        if (nodeEnd - nodeBegin == 1) {
+            *remaining = close;
+            return nodeBegin;
+        }
+
+        int middle = (nodeBegin + nodeEnd) / 2;
+        int line = descendBackward(2 * node + 1, middle, nodeEnd, to, close, remaining);
+        if (line >= 0)
+            return line;
+        return descendBackward(2 * node, nodeBegin, middle, to, close, remaining);
+    }
+};
+
+#endif // BRACKET_INDEX_H
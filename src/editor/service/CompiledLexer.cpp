@@ -0,0 +1,528 @@
+#include "CompiledLexer.h"
+#include "SyntaxHighlighter.h"
+#include <QDataStream>
+#include <algorithm>
+#include <cstring>
+
+CompiledLexer::CompiledLexer(const LanguageDefinition& language)
+{
+    initialize(language);
+    buildKeywordTable(language);
+}
+
+CompiledLexer::CompiledLexer(const LanguageDefinition& language, QDataStream& keywordTable)
+{
+    initialize(language);
+    m_loadedFromCache = readKeywordTable(language, keywordTable);
+    if (!m_loadedFromCache) {
+        buildKeywordTable(language);
+    }
+}
+
+void CompiledLexer::initialize(const LanguageDefinition& language)
+{
+    m_lineComment = language.singleLineComment;
+    m_nestedComments = language.nestedComments;
+
+    // 只有开始符和结束符都存在时才识别块注释
+    if (!language.multiLineCommentStart.isEmpty() && !language.multiLineCommentEnd.isEmpty()) {
+        m_blockCommentStart = language.multiLineCommentStart;
+        m_blockCommentEnd = language.multiLineCommentEnd;
+    }
+
+    if (!language.escapeCharacter.isEmpty()) {
+        m_escape = language.escapeCharacter.at(0).unicode();
+    }
+
+    // 只支持单字符的字符串定界符
+    for (const QString& delimiter : language.stringDelimiters) {
+        if (delimiter.length() == 1) {
+            m_stringDelimiters.push_back(delimiter.at(0).unicode());
+        }
+    }
+    for (const QString& delimiter : language.multiLineStringDelimiters) {
+        if (delimiter.length() == 1) {
+            m_multiLineStringDelimiters.push_back(delimiter.at(0).unicode());
+        }
+    }
+
+    for (int c = 0; c < 128; ++c) {
+        m_charClasses[c] = classify(QChar(c));
+    }
+
+    buildOperatorTables();
+}
+
+// ==============================================================================
+// 扫描
+// ==============================================================================
+
+QList<Token> CompiledLexer::tokenizeLine(QStringView line, const LexerState& startState,
+    LexerState* endState) const
+{
+    QList<Token> tokens;
+    LexerState state = startState;
+
+    const int length = static_cast<int>(line.length());
+    int i = 0;
+
+    // 从上一行未闭合的块注释或字符串继续
+    if (state.kind == LexerState::InComment && !m_blockCommentStart.isEmpty()) {
+        i = scanBlockComment(line, 0, state);
+    }
+    else if (state.kind == LexerState::InString) {
+        i = scanString(line, 0, state);
+    }
+    else {
+        state = LexerState();
+    }
+
+    if (i > 0) {
+        tokens.append(Token(0, i, startState.kind == LexerState::InComment
+            ? TokenType::Comment : TokenType::String));
+    }
+
+    while (i < length && state.kind == LexerState::Normal) {
+        const QChar ch = line[i];
+        const quint8 cls = charClass(ch);
+
+        // 块注释
+        if ((cls & BlockCommentStart) && line.sliced(i).startsWith(m_blockCommentStart)) {
+            int commentStart = i;
+            state.kind = LexerState::InComment;
+            state.depth = 1;
+            i = scanBlockComment(line, i + static_cast<int>(m_blockCommentStart.length()), state);
+            tokens.append(Token(commentStart, i - commentStart, TokenType::Comment));
+            continue;
+        }
+
+        // 单行注释
+        if ((cls & LineCommentStart) && line.sliced(i).startsWith(m_lineComment)) {
+            tokens.append(Token(i, length - i, TokenType::Comment));
+            break;
+        }
+
+        // 字符串
+        if (cls & StringDelimiter) {
+            int stringStart = i;
+            state.kind = LexerState::InString;
+            state.delimiter = ch.unicode();
+            i = scanString(line, i + 1, state);
+            tokens.append(Token(stringStart, i - stringStart, TokenType::String));
+            continue;
+        }
+
+        // 数字
+        if (cls & Digit) {
+            int numberStart = i++;
+            while (i < length && (charClass(line[i]) & NumberPart)) {
+                i++;
+            }
+            tokens.append(Token(numberStart, i - numberStart, TokenType::Number));
+            continue;
+        }
+
+        // 标识符和关键字
+        if (cls & IdentifierStart) {
+            int identifierStart = i++;
+            while (i < length && (charClass(line[i]) & IdentifierPart)) {
+                i++;
+            }
+            tokens.append(Token(identifierStart, i - identifierStart,
+                classifyIdentifier(line.sliced(identifierStart, i - identifierStart))));
+            continue;
+        }
+
+        // 运算符；不是运算符的标点直接跳过
+        if (cls & Punctuation) {
+            int operatorLength = matchOperator(line, i);
+            if (operatorLength > 0) {
+                tokens.append(Token(i, operatorLength, TokenType::Operator));
+                i += operatorLength;
+            }
+            else {
+                i++;
+            }
+            continue;
+        }
+
+        i++;
+    }
+
+    if (endState) {
+        *endState = state;
+    }
+
+    return tokens;
+}
+
+quint8 CompiledLexer::classify(QChar ch) const
+{
+    quint8 cls = 0;
+
+    if (!m_blockCommentStart.isEmpty() && ch == m_blockCommentStart.at(0)) {
+        cls |= BlockCommentStart;
+    }
+    if (!m_lineComment.isEmpty() && ch == m_lineComment.at(0)) {
+        cls |= LineCommentStart;
+    }
+    if (std::find(m_stringDelimiters.begin(), m_stringDelimiters.end(), ch.unicode()) != m_stringDelimiters.end()) {
+        cls |= StringDelimiter;
+    }
+    if (ch.isDigit()) {
+        cls |= Digit;
+    }
+    if (ch.isLetter() || ch == '_') {
+        cls |= IdentifierStart;
+    }
+    if (ch.isLetterOrNumber() || ch == '_') {
+        cls |= IdentifierPart;
+    }
+    if (ch.isDigit() || ch == '.' || ch.toLower() == 'x' || ch.toLower() == 'e' ||
+        (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F')) {
+        cls |= NumberPart;
+    }
+    if (!ch.isLetterOrNumber() && !ch.isSpace()) {
+        cls |= Punctuation;
+    }
+
+    return cls;
+}
+
+quint8 CompiledLexer::charClass(QChar ch) const
+{
+    // ASCII 查表，其余字符按 Unicode 属性现场分类
+    return ch.unicode() < 128 ? m_charClasses[ch.unicode()] : classify(ch);
+}
+
+int CompiledLexer::matchOperator(QStringView line, int i) const
+{
+    const int remaining = static_cast<int>(line.length()) - i;
+
+    // 最长匹配：依次尝试三字符、双字符、单字符
+    if (remaining >= 3) {
+        for (const auto& op : m_tripleOperators) {
+            if (line[i] == op[0] && line[i + 1] == op[1] && line[i + 2] == op[2])
+                return 3;
+        }
+    }
+
+    char16_t first = line[i].unicode();
+    if (first >= 128)
+        return 0;
+
+    if (remaining >= 2) {
+        char16_t second = line[i + 1].unicode();
+        if (second < 128 && (m_pairOperators[first][second >> 6] & (quint64(1) << (second & 63))))
+            return 2;
+    }
+
+    return m_singleOperators[first] ? 1 : 0;
+}
+
+TokenType CompiledLexer::classifyIdentifier(QStringView identifier) const
+{
+    if (m_keywordSlots.empty())
+        return TokenType::Identifier;
+
+    const quint32 hash = hashWord(identifier);
+    const quint32 displacement = m_displacements[hash & m_bucketMask];
+    const KeywordSlot& slot = m_keywordSlots[slotHash(hash, displacement) & m_slotMask];
+    if (slot.type != TokenType::None && identifier == slot.word)
+        return slot.type;
+
+    return TokenType::Identifier;
+}
+
+int CompiledLexer::scanBlockComment(QStringView line, int from, LexerState& state) const
+{
+    int i = from;
+    while (true) {
+        int endPos = static_cast<int>(line.indexOf(m_blockCommentEnd, i));
+
+        // 可嵌套的块注释：结束符之前出现的开始符增加一层
+        if (m_nestedComments) {
+            int nestedPos = static_cast<int>(line.indexOf(m_blockCommentStart, i));
+            if (nestedPos != -1 && (endPos == -1 || nestedPos < endPos)) {
+                if (state.depth < 255) {
+                    state.depth++;
+                }
+                i = nestedPos + static_cast<int>(m_blockCommentStart.length());
+                continue;
+            }
+        }
+
+        // 注释延续到下一行
+        if (endPos == -1)
+            return static_cast<int>(line.length());
+
+        i = endPos + static_cast<int>(m_blockCommentEnd.length());
+        if (state.depth <= 1) {
+            state = LexerState();
+            return i;
+        }
+        state.depth--;
+    }
+}
+
+int CompiledLexer::scanString(QStringView line, int from, LexerState& state) const
+{
+    const char16_t delimiter = state.delimiter;
+
+    bool escaped = false;
+    for (int i = from; i < line.length(); ++i) {
+        char16_t ch = line[i].unicode();
+
+        if (escaped) {
+            escaped = false;
+        }
+        else if (m_escape != 0 && ch == m_escape) {
+            escaped = true;
+        }
+        else if (ch == delimiter) {
+            state = LexerState();
+            return i + 1;
+        }
+    }
+
+    // 未闭合的字符串只有在多行定界符或行尾续行符时延续到下一行
+    if (!escaped && std::find(m_multiLineStringDelimiters.begin(), m_multiLineStringDelimiters.end(),
+        delimiter) == m_multiLineStringDelimiters.end()) {
+        state = LexerState();
+    }
+
+    return static_cast<int>(line.length());
+}
+
+// ==============================================================================
+// 编译
+// ==============================================================================
+
+void CompiledLexer::buildOperatorTables()
+{
+    static const char* const operators[] = {
+        // 三字符运算符
+        "<<<", ">>>", "<<=", ">>=", "...",
+
+        // 双字符运算符
+        "++", "--", "==", "!=", "<=", ">=", "&&", "||", "<<", ">>",
+        "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "->", "::",
+
+        // 单字符运算符
+        "+", "-", "*", "/", "%", "=", "<", ">", "!", "&", "|", "^",
+        "~", "?", ":", ";", ",", ".", "(", ")", "[", "]", "{", "}"
+    };
+
+    for (const char* op : operators) {
+        const size_t length = strlen(op);
+        const auto first = static_cast<unsigned char>(op[0]);
+
+        if (length == 1) {
+            m_singleOperators[first] = true;
+        }
+        else if (length == 2) {
+            const auto second = static_cast<unsigned char>(op[1]);
+            m_pairOperators[first][second >> 6] |= quint64(1) << (second & 63);
+        }
+        else {
+            m_tripleOperators.push_back({ char16_t(op[0]), char16_t(op[1]), char16_t(op[2]) });
+        }
+    }
+}
+
+QHash<QString, TokenType> CompiledLexer::collectWords(const LanguageDefinition& language)
+{
+    // 同一个词出现在多个列表中时按 关键字 > 类型 > 函数 的优先级
+    QHash<QString, TokenType> words;
+    for (const QString& word : language.functions) {
+        words.insert(word, TokenType::Function);
+    }
+    for (const QString& word : language.types) {
+        words.insert(word, TokenType::Type);
+    }
+    for (const QString& word : language.keywords) {
+        words.insert(word, TokenType::Keyword);
+    }
+    return words;
+}
+
+void CompiledLexer::buildKeywordTable(const LanguageDefinition& language)
+{
+    const QHash<QString, TokenType> words = collectWords(language);
+
+    m_keywordCount = static_cast<int>(words.size());
+    if (words.isEmpty())
+        return;
+
+    struct Bucket {
+        std::vector<int> words;
+        quint32 index = 0;
+    };
+
+    const QList<QString> keys = words.keys();
+    std::vector<quint32> hashes(keys.size());
+    for (int i = 0; i < keys.size(); ++i) {
+        hashes[i] = hashWord(keys[i]);
+    }
+
+    // 槽数取不小于两倍词数的 2 的幂，平均每桶两个词；
+    // 某个桶找不到可用的位移值时加倍槽数重来
+    static constexpr quint32 MAX_DISPLACEMENT = 1u << 16;
+
+    quint32 slotCount = 8;
+    while (slotCount < 2 * static_cast<quint32>(keys.size())) {
+        slotCount *= 2;
+    }
+
+    while (true) {
+        const quint32 bucketCount = slotCount / 4;
+        std::vector<Bucket> buckets(bucketCount);
+        for (quint32 b = 0; b < bucketCount; ++b) {
+            buckets[b].index = b;
+        }
+        for (int i = 0; i < keys.size(); ++i) {
+            buckets[hashes[i] & (bucketCount - 1)].words.push_back(i);
+        }
+
+        // 词多的桶先放，越往后空槽越少，小桶更容易找到位置
+        std::sort(buckets.begin(), buckets.end(), [](const Bucket& a, const Bucket& b) {
+            return a.words.size() > b.words.size();
+        });
+
+        std::vector<quint32> displacements(bucketCount, 0);
+        std::vector<int> slotWord(slotCount, -1);
+        std::vector<quint32> placed;
+        bool failed = false;
+
+        for (const Bucket& bucket : buckets) {
+            if (bucket.words.empty())
+                break;
+
+            bool found = false;
+            for (quint32 displacement = 0; displacement < MAX_DISPLACEMENT && !found; ++displacement) {
+                placed.clear();
+                found = true;
+                for (int word : bucket.words) {
+                    quint32 slot = slotHash(hashes[word], displacement) & (slotCount - 1);
+                    if (slotWord[slot] >= 0 || std::find(placed.begin(), placed.end(), slot) != placed.end()) {
+                        found = false;
+                        break;
+                    }
+                    placed.push_back(slot);
+                }
+
+                if (found) {
+                    for (size_t k = 0; k < bucket.words.size(); ++k) {
+                        slotWord[placed[k]] = bucket.words[k];
+                    }
+                    displacements[bucket.index] = displacement;
+                }
+            }
+
+            if (!found) {
+                failed = true;
+                break;
+            }
+        }
+
+        if (failed) {
+            slotCount *= 2;
+            continue;
+        }
+
+        m_slotMask = slotCount - 1;
+        m_bucketMask = bucketCount - 1;
+        m_displacements = std::move(displacements);
+        placeWords(words);
+        return;
+    }
+}
+
+void CompiledLexer::writeKeywordTable(QDataStream& out) const
+{
+    out << m_slotMask << m_bucketMask << qint32(m_displacements.size());
+    for (quint32 displacement : m_displacements) {
+        out << displacement;
+    }
+}
+
+bool CompiledLexer::readKeywordTable(const LanguageDefinition& language, QDataStream& in)
+{
+    quint32 slotMask = 0;
+    quint32 bucketMask = 0;
+    qint32 bucketCount = 0;
+    in >> slotMask >> bucketMask >> bucketCount;
+
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    // 没有词时不记录位移值；否则槽数和桶数都必须是 2 的幂，且与位移值个数一致
+    const bool empty = bucketCount == 0 && slotMask == 0 && bucketMask == 0;
+    if (!empty && ((slotMask & (slotMask + 1)) != 0 || (bucketMask & (bucketMask + 1)) != 0 ||
+        bucketCount != qint64(bucketMask) + 1 || slotMask > (1u << 24) || bucketMask > slotMask))
+        return false;
+
+    std::vector<quint32> displacements(bucketCount);
+    for (quint32& displacement : displacements) {
+        in >> displacement;
+    }
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    m_slotMask = slotMask;
+    m_bucketMask = bucketMask;
+    m_displacements = std::move(displacements);
+
+    // 按缓存的参数放入词表，出现冲突说明缓存与语言定义不符
+    if (!placeWords(collectWords(language))) {
+        m_keywordSlots.clear();
+        m_displacements.clear();
+        m_slotMask = 0;
+        m_bucketMask = 0;
+        return false;
+    }
+    return true;
+}
+
+bool CompiledLexer::placeWords(const QHash<QString, TokenType>& words)
+{
+    m_keywordCount = static_cast<int>(words.size());
+    if (!words.isEmpty() && m_displacements.empty())
+        return false;
+
+    m_keywordSlots.assign(words.isEmpty() ? 0 : m_slotMask + 1, KeywordSlot());
+
+    for (auto it = words.cbegin(); it != words.cend(); ++it) {
+        const quint32 hash = hashWord(it.key());
+        const quint32 displacement = m_displacements[hash & m_bucketMask];
+        KeywordSlot& slot = m_keywordSlots[slotHash(hash, displacement) & m_slotMask];
+        if (slot.type != TokenType::None)
+            return false;
+        slot.word = it.key();
+        slot.type = it.value();
+    }
+    return true;
+}
+
+quint32 CompiledLexer::hashWord(QStringView word)
+{
+    // FNV-1a
+    quint32 hash = 2166136261u;
+    for (QChar ch : word) {
+        hash ^= ch.unicode();
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+quint32 CompiledLexer::slotHash(quint32 hash, quint32 displacement)
+{
+    // 位移值混入词的哈希后再充分扰动，使不同位移值得到互不相关的槽位
+    hash += displacement * 0x9E3779B9u;
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+    return hash;
+}
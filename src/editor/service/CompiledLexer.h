@@ -0,0 +1,115 @@
+#ifndef COMPILED_LEXER_H
+#define COMPILED_LEXER_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringView>
+#include <array>
+#include <vector>
+#include "TokenTypes.h"
+
+class LanguageDefinition;
+class QDataStream;
+
+// 行尾词法状态：下一行从这里继续分析。
+// 只有块注释和跨行字符串会跨越行边界，4 字节即可表示
+struct LexerState {
+    enum Kind : quint8 {
+        Normal,
+        InComment,
+        InString
+    };
+
+    Kind kind = Normal;
+    quint8 depth = 0;           // 块注释嵌套层数
+    char16_t delimiter = 0;     // 未闭合字符串的定界符
+
+    bool operator==(const LexerState& other) const
+    {
+        return kind == other.kind && depth == other.depth && delimiter == other.delimiter;
+    }
+    bool operator!=(const LexerState& other) const { return !(*this == other); }
+};
+
+// 编译后的词法分析器
+// 由 LanguageDefinition 一次性生成：ASCII 字符分类表决定每个位置进入哪个分支，
+// 关键字、类型和函数名放入完美哈希表，运算符按位表做最长匹配。
+// 一行只从左到右扫描一遍，不回溯，不分配临时字符串；编译后只读，可在多个线程中共享
+class CompiledLexer {
+public:
+    explicit CompiledLexer(const LanguageDefinition& language);
+    // 从磁盘缓存恢复：完美哈希表的参数从流中读取，不再搜索位移值。
+    // 参数与语言定义不符时退回重新生成，loadedFromCache() 返回 false
+    CompiledLexer(const LanguageDefinition& language, QDataStream& keywordTable);
+
+    void writeKeywordTable(QDataStream& out) const;
+    bool loadedFromCache() const { return m_loadedFromCache; }
+
+    QList<Token> tokenizeLine(QStringView line, const LexerState& startState,
+        LexerState* endState) const;
+
+    // 调试
+    int keywordCount() const { return m_keywordCount; }
+    int keywordTableSize() const { return static_cast<int>(m_keywordSlots.size()); }
+    int keywordBucketCount() const { return static_cast<int>(m_displacements.size()); }
+
+private:
+    enum CharClass : quint8 {
+        BlockCommentStart = 0x01,   // 块注释开始符的首字符
+        LineCommentStart = 0x02,    // 单行注释开始符的首字符
+        StringDelimiter = 0x04,
+        Digit = 0x08,
+        IdentifierStart = 0x10,
+        IdentifierPart = 0x20,
+        NumberPart = 0x40,
+        Punctuation = 0x80          // 既不是字母数字也不是空白，尝试匹配运算符
+    };
+
+    struct KeywordSlot {
+        QString word;
+        TokenType type = TokenType::None;
+    };
+
+    std::array<quint8, 128> m_charClasses{};
+
+    // 完美哈希（哈希-位移法）：词先按哈希分桶，每个桶选定一个位移值，
+    // 使桶内的词与其他桶的词落在不同的槽中。查找只需对词做一次哈希、一次比较
+    std::vector<KeywordSlot> m_keywordSlots;
+    std::vector<quint32> m_displacements;
+    quint32 m_slotMask = 0;
+    quint32 m_bucketMask = 0;
+    int m_keywordCount = 0;
+    bool m_loadedFromCache = false;
+
+    // 运算符：单字符和双字符用位表，三字符的很少，逐个比较
+    std::array<bool, 128> m_singleOperators{};
+    std::array<std::array<quint64, 2>, 128> m_pairOperators{};
+    std::vector<std::array<char16_t, 3>> m_tripleOperators;
+
+    QString m_blockCommentStart;
+    QString m_blockCommentEnd;
+    QString m_lineComment;
+    bool m_nestedComments = false;
+    char16_t m_escape = 0;
+    std::vector<char16_t> m_stringDelimiters;
+    std::vector<char16_t> m_multiLineStringDelimiters;
+
+    quint8 classify(QChar ch) const;
+    quint8 charClass(QChar ch) const;
+    int matchOperator(QStringView line, int i) const;
+    TokenType classifyIdentifier(QStringView identifier) const;
+    int scanBlockComment(QStringView line, int from, LexerState& state) const;
+    int scanString(QStringView line, int from, LexerState& state) const;
+
+    void buildOperatorTables();
+    void initialize(const LanguageDefinition& language);
+    static QHash<QString, TokenType> collectWords(const LanguageDefinition& language);
+    void buildKeywordTable(const LanguageDefinition& language);
+    bool readKeywordTable(const LanguageDefinition& language, QDataStream& in);
+    bool placeWords(const QHash<QString, TokenType>& words);
+    static quint32 hashWord(QStringView word);
+    static quint32 slotHash(quint32 hash, quint32 displacement);
+};
+
+#endif // COMPILED_LEXER_H
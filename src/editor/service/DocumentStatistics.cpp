@@ -0,0 +1,380 @@
+#include "DocumentStatistics.h"
+#include "../core/DocumentModel.h"
+#include <QtConcurrent/QtConcurrent>
+#include <QDebug>
+
+DocumentStatistics::DocumentStatistics(DocumentModel* document, QObject* parent)
+    : QObject(parent)
+    , m_document(document)
+    , m_watcher(new QFutureWatcher<ChunkResult>(this))
+{
+    // 连续输入时合并刷新请求
+    m_refreshTimer.setSingleShot(true);
+    m_refreshTimer.setInterval(100);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &DocumentStatistics::refresh);
+
+    connect(m_watcher, &QFutureWatcher<ChunkResult>::finished,
+        this, &DocumentStatistics::onComputationFinished);
+
+    if (m_document) {
+        connect(m_document, &DocumentModel::textChanged,
+            this, &DocumentStatistics::onTextChanged);
+    }
+
+    invalidate();
+}
+
+DocumentStatistics::~DocumentStatistics()
+{
+    // 计算任务只持有文本的共享副本，不引用 this，无需等待
+}
+
+// ==============================================================================
+// 统计值
+// ==============================================================================
+
+int DocumentStatistics::characterCount() const
+{
+    return m_knownLength;
+}
+
+int DocumentStatistics::wordCount() const
+{
+    return m_totals.words;
+}
+
+int DocumentStatistics::paragraphCount() const
+{
+    return m_totals.paragraphs;
+}
+
+int DocumentStatistics::lineCount() const
+{
+    return m_totals.newlines + 1;
+}
+
+bool DocumentStatistics::isUpToDate() const
+{
+    return dirtyChunkCount() == 0 && !m_watcher->isRunning();
+}
+
+int DocumentStatistics::dirtyChunkCount() const
+{
+    int count = 0;
+    for (const Chunk& chunk : m_chunks) {
+        if (chunk.dirty) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// ==============================================================================
+// 刷新
+// ==============================================================================
+
+void DocumentStatistics::refresh()
+{
+    if (!m_document)
+        return;
+
+    // 上一轮还在计算，完成后会再次检查失效块
+    if (m_watcher->isRunning())
+        return;
+
+    QList<ChunkJob> jobs = prepareJobs();
+    if (jobs.isEmpty()) {
+        if (m_totalsDirty) {
+            updateTotals();
+            emit statisticsChanged();
+        }
+        return;
+    }
+
+    m_watcher->setFuture(QtConcurrent::mapped(std::move(jobs), &DocumentStatistics::runJob));
+}
+
+void DocumentStatistics::refreshNow()
+{
+    if (!m_document)
+        return;
+
+    m_refreshTimer.stop();
+
+    QList<ChunkJob> jobs = prepareJobs();
+    if (!jobs.isEmpty()) {
+        // 正在进行的异步任务结果到达时会因为块已不再失效而被忽略
+        applyResults(QtConcurrent::blockingMapped<QList<ChunkResult>>(jobs, &DocumentStatistics::runJob));
+        emit statisticsChanged();
+    }
+    else if (m_totalsDirty) {
+        updateTotals();
+        emit statisticsChanged();
+    }
+}
+
+void DocumentStatistics::invalidate()
+{
+    m_chunks.clear();
+    m_knownLength = m_document ? m_document->textLength() : 0;
+
+    if (m_knownLength > 0) {
+        m_chunks.append(makeDirtyChunk(m_knownLength));
+    }
+
+    m_totalsDirty = true;
+    m_refreshTimer.start();
+}
+
+// ==============================================================================
+// 槽函数
+// ==============================================================================
+
+void DocumentStatistics::onTextChanged(const TextChange& change)
+{
+    if (!m_document)
+        return;
+
+    int removed = change.removedLength;
+    int inserted = change.insertedText.length();
+
+    // 无法增量对齐（例如重新加载文件）时整体重算
+    if (m_chunks.isEmpty() ||
+        m_knownLength - removed + inserted != m_document->textLength()) {
+        invalidate();
+        return;
+    }
+
+    // 受影响的块：包含变更起点的块到包含删除终点的块。
+    // 终点按半开区间查找，保证合并后块的末尾仍然紧跟一个未改动的换行符
+    int firstStart = 0;
+    int first = findChunk(change.position, &firstStart);
+    int lastStart = 0;
+    int last = findChunk(change.position + removed, &lastStart);
+
+    int mergedLength = lastStart + m_chunks[last].length - firstStart - removed + inserted;
+
+    m_chunks.remove(first, last - first + 1);
+    if (mergedLength > 0) {
+        m_chunks.insert(first, makeDirtyChunk(mergedLength));
+    }
+
+    m_knownLength += inserted - removed;
+    m_totalsDirty = true;
+    m_refreshTimer.start();
+}
+
+void DocumentStatistics::onComputationFinished()
+{
+    applyResults(m_watcher->future().results());
+    emit statisticsChanged();
+
+    // 计算期间又有新的编辑
+    if (dirtyChunkCount() > 0) {
+        m_refreshTimer.start();
+    }
+}
+
+// ==============================================================================
+// 私有辅助方法
+// ==============================================================================
+
+QList<DocumentStatistics::ChunkJob> DocumentStatistics::prepareJobs()
+{
+    QList<ChunkJob> jobs;
+    int start = 0;
+
+    for (int i = 0; i < m_chunks.size(); ++i) {
+        int length = m_chunks[i].length;
+
+        if (m_chunks[i].dirty) {
+            // 存储层不是线程安全的，文本在主线程取出后交给工作线程
+            QString text = m_document->getText(start, length);
+
+            // 过大的块按行切分，保证并行粒度并限制后续编辑的重算范围
+            QList<int> pieces = length > TARGET_CHUNK_SIZE * 2
+                ? splitAtLines(text, TARGET_CHUNK_SIZE)
+                : QList<int>{ length };
+
+            m_chunks.removeAt(i);
+
+            int offset = 0;
+            for (int j = 0; j < pieces.size(); ++j) {
+                Chunk chunk = makeDirtyChunk(pieces[j]);
+                m_chunks.insert(i + j, chunk);
+
+                ChunkJob job;
+                job.id = chunk.id;
+                job.source = text;
+                job.offset = offset;
+                job.length = pieces[j];
+                jobs.append(job);
+
+                offset += pieces[j];
+            }
+
+            i += pieces.size() - 1;
+        }
+
+        start += length;
+    }
+
+    return jobs;
+}
+
+void DocumentStatistics::applyResults(const QList<ChunkResult>& results)
+{
+    if (results.isEmpty())
+        return;
+
+    QHash<quint64, ChunkStatistics> byId;
+    byId.reserve(results.size());
+    for (const ChunkResult& result : results) {
+        byId.insert(result.id, result.stats);
+    }
+
+    // 只接受仍然存在且仍然失效的块；被编辑合并掉的块的结果直接丢弃
+    for (Chunk& chunk : m_chunks) {
+        if (!chunk.dirty)
+            continue;
+
+        auto it = byId.constFind(chunk.id);
+        if (it != byId.constEnd()) {
+            chunk.stats = it.value();
+            chunk.dirty = false;
+        }
+    }
+
+    // 所有块都就绪后再更新总数，避免显示半成品
+    if (dirtyChunkCount() == 0) {
+        updateTotals();
+    }
+}
+
+void DocumentStatistics::updateTotals()
+{
+    ChunkStatistics totals;
+    bool previousLastLineBlank = true;
+
+    for (const Chunk& chunk : m_chunks) {
+        const ChunkStatistics& stats = chunk.stats;
+        totals.characters += stats.characters;
+        totals.words += stats.words;
+        totals.newlines += stats.newlines;
+        totals.paragraphs += stats.paragraphs;
+
+        // 上一块末行与本块首行都非空：两段其实是同一个段落
+        if (!previousLastLineBlank && !stats.firstLineBlank) {
+            totals.paragraphs--;
+        }
+        previousLastLineBlank = stats.lastLineBlank;
+    }
+
+    m_totals = totals;
+    m_totalsDirty = false;
+}
+
+int DocumentStatistics::findChunk(int position, int* chunkStart) const
+{
+    int start = 0;
+    for (int i = 0; i < m_chunks.size(); ++i) {
+        int end = start + m_chunks[i].length;
+        if (position < end || i == m_chunks.size() - 1) {
+            *chunkStart = start;
+            return i;
+        }
+        start = end;
+    }
+
+    *chunkStart = 0;
+    return 0;
+}
+
+DocumentStatistics::Chunk DocumentStatistics::makeDirtyChunk(int length)
+{
+    Chunk chunk;
+    chunk.id = m_nextChunkId++;
+    chunk.length = length;
+    chunk.dirty = true;
+    return chunk;
+}
+
+QList<int> DocumentStatistics::splitAtLines(QStringView text, int targetSize)
+{
+    QList<int> lengths;
+    qsizetype start = 0;
+
+    while (start < text.size()) {
+        qsizetype end = text.size();
+
+        if (text.size() - start > targetSize) {
+            // 在目标大小之后的第一个换行符处切分；超长行不切分
+            qsizetype newline = text.indexOf(QLatin1Char('\n'), start + targetSize);
+            if (newline != -1) {
+                end = newline + 1;
+            }
+        }
+
+        lengths.append(static_cast<int>(end - start));
+        start = end;
+    }
+
+    return lengths;
+}
+
+DocumentStatistics::ChunkResult DocumentStatistics::runJob(const ChunkJob& job)
+{
+    ChunkResult result;
+    result.id = job.id;
+    result.stats = computeChunk(QStringView(job.source).mid(job.offset, job.length));
+    return result;
+}
+
+ChunkStatistics DocumentStatistics::computeChunk(QStringView text)
+{
+    ChunkStatistics stats;
+    stats.characters = static_cast<int>(text.size());
+
+    bool inWord = false;
+    bool firstLine = true;
+    bool lineHasContent = false;
+    bool previousLineHasContent = false;
+
+    auto finishLine = [&]() {
+        if (firstLine) {
+            stats.firstLineBlank = !lineHasContent;
+            firstLine = false;
+        }
+        // 段落 = 连续的非空行
+        if (lineHasContent && !previousLineHasContent) {
+            stats.paragraphs++;
+        }
+        previousLineHasContent = lineHasContent;
+        stats.lastLineBlank = !lineHasContent;
+        lineHasContent = false;
+    };
+
+    for (QChar ch : text) {
+        // 单词字符与 \w 保持一致：字母、数字、下划线
+        bool wordChar = ch.isLetterOrNumber() || ch.isMark() || ch == QLatin1Char('_');
+        if (wordChar && !inWord) {
+            stats.words++;
+        }
+        inWord = wordChar;
+
+        if (ch == QLatin1Char('\n')) {
+            stats.newlines++;
+            finishLine();
+        }
+        else if (!ch.isSpace()) {
+            lineHasContent = true;
+        }
+    }
+
+    // 块以换行符结尾时，最后的空段属于下一块
+    if (!text.isEmpty() && text.back() != QLatin1Char('\n')) {
+        finishLine();
+    }
+
+    return stats;
+}
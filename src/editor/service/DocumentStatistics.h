@@ -0,0 +1,114 @@
+#ifndef DOCUMENT_STATISTICS_H
+#define DOCUMENT_STATISTICS_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QString>
+#include <QStringView>
+#include <QFutureWatcher>
+#include <QTimer>
+
+class DocumentModel;
+struct TextChange;
+
+// 单个文本块的统计结果
+struct ChunkStatistics {
+    int characters = 0;
+    int words = 0;
+    int newlines = 0;
+    int paragraphs = 0;          // 块内连续非空行段的数量
+    bool firstLineBlank = true;  // 用于跨块合并段落
+    bool lastLineBlank = true;
+};
+
+// 文档统计服务
+// 文档按整行切分为若干块，每块的统计结果独立缓存；编辑只使受影响的块失效，
+// 失效块通过 QtConcurrent 并行重算。块边界总在行首，因此单词不会跨块，
+// 段落只需在相邻块之间按首尾行是否为空进行合并。
+class DocumentStatistics : public QObject {
+    Q_OBJECT
+
+    Q_PROPERTY(int characterCount READ characterCount NOTIFY statisticsChanged)
+    Q_PROPERTY(int wordCount READ wordCount NOTIFY statisticsChanged)
+    Q_PROPERTY(int paragraphCount READ paragraphCount NOTIFY statisticsChanged)
+    Q_PROPERTY(int lineCount READ lineCount NOTIFY statisticsChanged)
+    Q_PROPERTY(bool upToDate READ isUpToDate NOTIFY statisticsChanged)
+
+public:
+    explicit DocumentStatistics(DocumentModel* document, QObject* parent = nullptr);
+    ~DocumentStatistics();
+
+    // 统计值（可能为上次计算的结果，见 isUpToDate）
+    int characterCount() const;
+    int wordCount() const;
+    int paragraphCount() const;
+    int lineCount() const;
+    bool isUpToDate() const;
+
+    // 异步刷新：失效块在线程池中计算，完成后发出 statisticsChanged
+    Q_INVOKABLE void refresh();
+    // 同步刷新：阻塞直到失效块并行计算完成
+    void refreshNow();
+    // 丢弃全部缓存
+    void invalidate();
+
+    // 调试信息
+    int chunkCount() const { return m_chunks.size(); }
+    int dirtyChunkCount() const;
+
+    static constexpr int TARGET_CHUNK_SIZE = 64 * 1024;
+
+    // 纯函数，可在工作线程中调用
+    static ChunkStatistics computeChunk(QStringView text);
+
+signals:
+    void statisticsChanged();
+
+private:
+    // TextChange 在此仅前向声明，不作为槽注册到元对象系统
+    void onTextChanged(const TextChange& change);
+    void onComputationFinished();
+
+    struct Chunk {
+        quint64 id = 0;
+        int length = 0;
+        bool dirty = true;
+        ChunkStatistics stats;
+    };
+
+    // 一个待计算的块：source 为共享的文本，[offset, offset + length) 为块范围
+    struct ChunkJob {
+        quint64 id = 0;
+        QString source;
+        int offset = 0;
+        int length = 0;
+    };
+
+    struct ChunkResult {
+        quint64 id = 0;
+        ChunkStatistics stats;
+    };
+
+    DocumentModel* m_document = nullptr;
+    QList<Chunk> m_chunks;
+    quint64 m_nextChunkId = 1;
+    int m_knownLength = 0;      // 块长度之和，用于校验变更能否增量对齐
+
+    ChunkStatistics m_totals;
+    bool m_totalsDirty = true;
+
+    QFutureWatcher<ChunkResult>* m_watcher = nullptr;
+    QTimer m_refreshTimer;
+
+    QList<ChunkJob> prepareJobs();
+    void applyResults(const QList<ChunkResult>& results);
+    void updateTotals();
+    int findChunk(int position, int* chunkStart) const;
+    Chunk makeDirtyChunk(int length);
+
+    static QList<int> splitAtLines(QStringView text, int targetSize);
+    static ChunkResult runJob(const ChunkJob& job);
+};
+
+#endif // DOCUMENT_STATISTICS_H
@@ -0,0 +1,82 @@
+#ifndef FENWICK_TREE_H
+#define FENWICK_TREE_H
+
+#include <QList>
+
+// 树状数组（Fenwick tree）
+// 维护一组非负数值的前缀和：单点修改、前缀和查询、按累计值定位元素均为 O(log n)
+template <typename T>
+class FenwickTree {
+public:
+    FenwickTree() = default;
+
+    // O(n) 建树
+    void build(const QList<T>& values)
+    {
+        const int n = values.size();
+        m_tree.fill(T(), n + 1);
+
+        for (int i = 1; i <= n; ++i) {
+            m_tree[i] += values[i - 1];
+            int parent = i + (i & -i);
+            if (parent <= n) {
+                m_tree[parent] += m_tree[i];
+            }
+        }
+    }
+
+    void clear() { m_tree.clear(); }
+
+    int size() const { return m_tree.isEmpty() ? 0 : m_tree.size() - 1; }
+
+    // 第 index 个元素加上 delta
+    void add(int index, T delta)
+    {
+        const int n = size();
+        for (int i = index + 1; i <= n; i += i & -i) {
+            m_tree[i] += delta;
+        }
+    }
+
+    // [0, count) 的和
+    T prefixSum(int count) const
+    {
+        T sum = T();
+        for (int i = qMin(count, size()); i > 0; i -= i & -i) {
+            sum += m_tree[i];
+        }
+        return sum;
+    }
+
+    T total() const { return prefixSum(size()); }
+
+    // 累计值 target 落在哪个元素内：满足 prefixSum(i) <= target < prefixSum(i + 1) 的 i
+    // target 超出总和时返回最后一个元素；空树返回 -1
+    int findIndex(T target) const
+    {
+        const int n = size();
+        if (n == 0)
+            return -1;
+
+        int position = 0;
+        int step = 1;
+        while (step * 2 <= n) {
+            step *= 2;
+        }
+
+        for (; step > 0; step /= 2) {
+            int next = position + step;
+            if (next <= n && m_tree[next] <= target) {
+                position = next;
+                target -= m_tree[next];
+            }
+        }
+
+        return qMin(position, n - 1);
+    }
+
+private:
+    QList<T> m_tree; // 下标从 1 开始
+};
+
+#endif // FENWICK_TREE_H
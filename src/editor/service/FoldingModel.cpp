@@ -0,0 +1,267 @@
+#include "FoldingModel.h"
+#include "LayoutEngine.h"
+#include "SyntaxHighlighter.h"
+#include <QStringList>
+#include <limits>
+
+FoldingModel::FoldingModel(LayoutEngine* layoutEngine, SyntaxHighlighter* highlighter, QObject* parent)
+    : QObject(parent)
+    , m_layoutEngine(layoutEngine)
+    , m_highlighter(highlighter)
+{
+}
+
+FoldingModel::~FoldingModel()
+{
+}
+
+// ==============================================================================
+// 折叠与展开
+// ==============================================================================
+
+bool FoldingModel::fold(int line)
+{
+    if (!m_layoutEngine || !m_highlighter)
+        return false;
+
+    if (m_folds.contains(line))
+        return true;
+
+    int end = m_highlighter->foldingEnd(line);
+    if (end <= line)
+        return false;
+
+    m_folds.insert(line, end);
+    setHidden(line + 1, end, true);
+
+    emit foldingChanged();
+    return true;
+}
+
+bool FoldingModel::unfold(int line)
+{
+    auto it = m_folds.find(line);
+    if (it == m_folds.end())
+        return false;
+
+    int end = it.value();
+    m_folds.erase(it);
+
+    // 区域内仍折叠着的嵌套区域保持隐藏
+    refreshHidden(line + 1, end);
+
+    emit foldingChanged();
+    return true;
+}
+
+bool FoldingModel::toggleFold(int line)
+{
+    return isFolded(line) ? unfold(line) : fold(line);
+}
+
+void FoldingModel::foldAll()
+{
+    if (!m_layoutEngine || !m_highlighter)
+        return;
+
+    const QList<QPair<int, int>> ranges =
+        m_highlighter->foldingRanges(0, std::numeric_limits<int>::max());
+    if (ranges.isEmpty())
+        return;
+
+    int last = -1;
+    for (const QPair<int, int>& range : ranges) {
+        m_folds.insert(range.first, range.second);
+        last = qMax(last, range.second);
+    }
+
+    // 嵌套区域的并集一次写入
+    refreshHidden(ranges.first().first + 1, last);
+
+    emit foldingChanged();
+}
+
+void FoldingModel::unfoldAll()
+{
+    if (m_folds.isEmpty())
+        return;
+
+    int first = m_folds.firstKey() + 1;
+    int last = -1;
+    for (int end : std::as_const(m_folds)) {
+        last = qMax(last, end);
+    }
+
+    m_folds.clear();
+    setHidden(first, last, false);
+
+    emit foldingChanged();
+}
+
+bool FoldingModel::isFolded(int line) const
+{
+    return m_folds.contains(line);
+}
+
+bool FoldingModel::isLineHidden(int line) const
+{
+    return m_layoutEngine && m_layoutEngine->isLineHidden(line);
+}
+
+QList<QPair<int, int>> FoldingModel::foldedRanges() const
+{
+    QList<QPair<int, int>> ranges;
+    ranges.reserve(m_folds.size());
+    for (auto it = m_folds.cbegin(); it != m_folds.cend(); ++it) {
+        ranges.append(QPair<int, int>(it.key(), it.value()));
+    }
+    return ranges;
+}
+
+bool FoldingModel::revealLine(int line)
+{
+    int first = std::numeric_limits<int>::max();
+    int last = -1;
+
+    // 包含该行的折叠：标题行在它之前，隐藏范围延伸到它
+    for (auto it = m_folds.begin(); it != m_folds.end() && it.key() < line;) {
+        if (it.value() >= line) {
+            first = qMin(first, it.key() + 1);
+            last = qMax(last, it.value());
+            it = m_folds.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    if (last < 0)
+        return false;
+
+    refreshHidden(first, last);
+
+    emit foldingChanged();
+    return true;
+}
+
+// ==============================================================================
+// 编辑与重置
+// ==============================================================================
+
+void FoldingModel::updateForEdit(int startLine, int removedLines, int addedLines)
+{
+    if (m_folds.isEmpty() || !m_layoutEngine)
+        return;
+
+    // 布局引擎因行数对不上而整体重建时隐藏状态已经清除，折叠随之作废
+    if (!m_layoutEngine->hasHiddenLines()) {
+        m_folds.clear();
+        emit foldingChanged();
+        return;
+    }
+
+    const int lastEditedLine = startLine + removedLines;
+    const int delta = addedLines - removedLines;
+    const bool inPlace = removedLines == 0 && addedLines == 0;
+
+    // 变更前的行号换算到变更后；被删除的行归到编辑行
+    auto mapLine = [&](int line) {
+        if (line <= startLine)
+            return line;
+        if (line > lastEditedLine)
+            return line + delta;
+        return startLine;
+    };
+
+    QMap<int, int> folds;
+    int first = std::numeric_limits<int>::max();
+    int last = -1;
+
+    for (auto it = m_folds.cbegin(); it != m_folds.cend(); ++it) {
+        int start = it.key();
+        int end = it.value();
+
+        if (end + 1 < startLine) {
+            // 区域及其结束行都在编辑之前
+            folds.insert(start, end);
+        }
+        else if (start > lastEditedLine) {
+            // 区域在编辑之后，随行号移动；隐藏标记已随行度量一起移动
+            folds.insert(start + delta, end + delta);
+        }
+        else if (start == startLine && inPlace) {
+            // 只修改了标题行本身
+            folds.insert(start, end);
+        }
+        else {
+            // 编辑触及区域内部或结束行，展开
+            first = qMin(first, mapLine(start + 1));
+            last = qMax(last, mapLine(end));
+        }
+    }
+
+    m_folds = std::move(folds);
+
+    if (last >= first) {
+        refreshHidden(first, last);
+        emit foldingChanged();
+    }
+}
+
+void FoldingModel::reset()
+{
+    bool changed = !m_folds.isEmpty();
+    m_folds.clear();
+
+    if (m_layoutEngine && m_layoutEngine->hasHiddenLines()) {
+        m_layoutEngine->setLinesHidden(0, std::numeric_limits<int>::max(), false);
+        changed = true;
+    }
+
+    if (changed) {
+        emit foldingChanged();
+    }
+}
+
+QString FoldingModel::getDebugInfo() const
+{
+    QStringList info;
+
+    info << "FoldingModel Debug Info:";
+    info << QString("  Folded regions: %1").arg(m_folds.size());
+    if (m_layoutEngine) {
+        info << QString("  Visible lines: %1").arg(m_layoutEngine->visibleLineCount());
+    }
+
+    return info.join("\n");
+}
+
+// ==============================================================================
+// 私有辅助方法
+// ==============================================================================
+
+void FoldingModel::refreshHidden(int firstLine, int lastLine)
+{
+    if (lastLine < firstLine)
+        return;
+
+    setHidden(firstLine, lastLine, false);
+
+    // 折叠按标题行排序，逐个合并成不重叠的区间，嵌套区域不重复写入
+    int coveredEnd = firstLine - 1;
+    for (auto it = m_folds.cbegin(); it != m_folds.cend() && it.key() < lastLine; ++it) {
+        int from = qMax(coveredEnd + 1, it.key() + 1);
+        int to = qMin(lastLine, it.value());
+        if (from <= to) {
+            setHidden(from, to, true);
+            coveredEnd = to;
+        }
+    }
+}
+
+void FoldingModel::setHidden(int firstLine, int lastLine, bool hidden)
+{
+    if (m_layoutEngine && lastLine >= firstLine) {
+        m_layoutEngine->setLinesHidden(firstLine, lastLine - firstLine + 1, hidden);
+    }
+}
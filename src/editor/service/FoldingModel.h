@@ -0,0 +1,67 @@
+#ifndef FOLDING_MODEL_H
+#define FOLDING_MODEL_H
+
+#include <QObject>
+#include <QMap>
+#include <QList>
+#include <QPair>
+
+class LayoutEngine;
+class SyntaxHighlighter;
+
+// 代码折叠状态
+// 记录已折叠的区域（标题行 -> 隐藏的最后一行），并把隐藏状态写入 LayoutEngine 的行度量：
+// 隐藏行不占高度，绘制、坐标换算和视觉行映射都跳过它们。
+// 可折叠的范围由 SyntaxHighlighter 的括号/缩进索引按需给出（每行 O(log n)），不扫描全文；
+// 折叠或展开只改动区域内各行的状态位，十万行的区域也是一次顺序扫描。
+// 编辑后之后的折叠随行号移动，编辑触及的折叠被展开
+class FoldingModel : public QObject {
+    Q_OBJECT
+
+public:
+    explicit FoldingModel(LayoutEngine* layoutEngine, SyntaxHighlighter* highlighter,
+        QObject* parent = nullptr);
+    ~FoldingModel();
+
+    // 折叠 line 开始的区域；该行不可折叠时返回 false
+    bool fold(int line);
+    bool unfold(int line);
+    bool toggleFold(int line);
+    // 折叠全部可折叠的区域（包括嵌套的）
+    void foldAll();
+    void unfoldAll();
+
+    bool isFolded(int line) const;
+    bool isLineHidden(int line) const;
+    // (标题行, 隐藏的最后一行)，按标题行排序
+    QList<QPair<int, int>> foldedRanges() const;
+    int foldedCount() const { return m_folds.size(); }
+
+    // 展开包含 line 的所有折叠（光标移入折叠区域时），有变化时返回 true
+    bool revealLine(int line);
+
+    // 文档中 startLine 起的 removedLines + 1 行被替换为 addedLines + 1 行，
+    // 在 LayoutEngine 按同一变更更新行度量之后调用
+    void updateForEdit(int startLine, int removedLines, int addedLines);
+
+    // 文档或语言整体变化
+    void reset();
+
+    QString getDebugInfo() const;
+
+signals:
+    void foldingChanged();
+
+private:
+    LayoutEngine* m_layoutEngine = nullptr;
+    SyntaxHighlighter* m_highlighter = nullptr;
+
+    // 折叠区域互不交叉（只有嵌套或不相交），隐藏 [标题行 + 1, 结尾]
+    QMap<int, int> m_folds;
+
+    // 按当前的折叠重新确定 [firstLine, lastLine] 内各行的隐藏状态
+    void refreshHidden(int firstLine, int lastLine);
+    void setHidden(int firstLine, int lastLine, bool hidden);
+};
+
+#endif // FOLDING_MODEL_H
@@ -0,0 +1,91 @@
+#ifndef INDENT_INDEX_H
+#define INDENT_INDEX_H
+
+#include <QList>
+#include <QtGlobal>
+#include <limits>
+
+// 缩进索引（最小值线段树）
+// 按行保存缩进宽度，空白行记为 BLANK。查找某行之后第一个缩进不超过给定宽度的行为 O(log n)，
+// 按缩进折叠时该行之前即折叠区域的结尾。单行更新 O(log n)，行数变化时 O(n) 重建
+class IndentIndex {
+public:
+    static constexpr qint32 BLANK = std::numeric_limits<qint32>::max();
+
+    IndentIndex() = default;
+
+    void build(const QList<qint32>& indents)
+    {
+        m_size = indents.size();
+        m_leaves = 1;
+        while (m_leaves < m_size) {
+            m_leaves *= 2;
+        }
+
+        m_tree.fill(BLANK, 2 * m_leaves);
+        for (int i = 0; i < m_size; ++i) {
+            m_tree[m_leaves + i] = indents[i];
+        }
+        for (int node = m_leaves - 1; node > 0; --node) {
+            m_tree[node] = qMin(m_tree[2 * node], m_tree[2 * node + 1]);
+        }
+    }
+
+    void clear()
+    {
+        m_tree.clear();
+        m_size = 0;
+        m_leaves = 0;
+    }
+
+    int size() const { return m_size; }
+
+    qint32 indent(int line) const
+    {
+        if (line < 0 || line >= m_size)
+            return BLANK;
+        return m_tree[m_leaves + line];
+    }
+
+    void update(int line, qint32 indent)
+    {
+        if (line < 0 || line >= m_size)
+            return;
+
+        int node = m_leaves + line;
+        m_tree[node] = indent;
+        for (node /= 2; node > 0; node /= 2) {
+            m_tree[node] = qMin(m_tree[2 * node], m_tree[2 * node + 1]);
+        }
+    }
+
+    // 从 line 行（含）起向后第一个缩进不超过 indent 的非空白行，没有时返回 -1
+    int findNextAtMost(int line, qint32 indent) const
+    {
+        if (line < 0 || line >= m_size)
+            return -1;
+        return descend(1, 0, m_leaves, line, indent);
+    }
+
+private:
+    QList<qint32> m_tree; // 下标从 1 开始，叶子从 m_leaves 开始
+    int m_size = 0;
+    int m_leaves = 0;
+
+    int descend(int node, int nodeBegin, int nodeEnd, int from, qint32 indent) const
+    {
+        if (nodeEnd <= from || nodeBegin >= m_size || m_tree[node] > indent)
+            return -1;
+
+        if (nodeEnd - nodeBegin == 1)
+            return nodeBegin;
+
+        int middle = (nodeBegin + nodeEnd) / 2;
+        int line = descend(2 * node, nodeBegin, middle, from, indent);
+        if (line >= 0)
+            return line;
+        return descend(2 * node + 1, middle, nodeEnd, from, indent);
+    }
+};
+
+#endif // INDENT_INDEX_H
@@ -0,0 +1,260 @@
+#include "LanguageRegistry.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+// 随程序打包的语言定义（qt_add_qml_module 的 RESOURCES）
+const QString LANGUAGE_RESOURCE_DIR = QStringLiteral(":/qt/qml/EvaEdit/resources/languages");
+
+// 磁盘缓存格式；格式或编译方式变化时增加版本号，旧缓存因键不同自然失效
+constexpr quint32 CACHE_MAGIC = 0x45564C43; // "EVLC"
+constexpr quint16 CACHE_VERSION = 2;
+
+QStringList toStringList(const QJsonValue& value)
+{
+    QStringList result;
+    const QJsonArray array = value.toArray();
+    for (const QJsonValue& item : array) {
+        result.append(item.toString());
+    }
+    return result;
+}
+}
+
+LanguageRegistry& LanguageRegistry::instance()
+{
+    static LanguageRegistry registry;
+    return registry;
+}
+
+LanguageRegistry::LanguageRegistry()
+{
+    QString cacheRoot = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (!cacheRoot.isEmpty()) {
+        m_cacheDir = cacheRoot + "/languages";
+    }
+
+    loadLanguageFiles(LANGUAGE_RESOURCE_DIR);
+
+    // 资源缺失时至少保留纯文本，SyntaxHighlighter 以它为默认语言
+    if (!m_languages.contains("text")) {
+        LanguageDefinition text;
+        text.name = "text";
+        text.fileExtensions = QStringList{ "txt", "text", "log" };
+        registerLanguage(text);
+    }
+}
+
+// ==============================================================================
+// 查询
+// ==============================================================================
+
+void LanguageRegistry::registerLanguage(const LanguageDefinition& definition)
+{
+    auto language = std::make_shared<Language>();
+    language->definition = definition;
+    language->lexer = std::make_shared<const CompiledLexer>(definition);
+    m_languages.insert(definition.name, std::move(language));
+    m_compiled++;
+}
+
+std::shared_ptr<const LanguageRegistry::Language> LanguageRegistry::language(const QString& name) const
+{
+    return m_languages.value(name);
+}
+
+std::shared_ptr<const LanguageRegistry::Language> LanguageRegistry::languageForExtension(
+    const QString& extension) const
+{
+    QString lowercaseExt = extension.toLower();
+
+    for (auto it = m_languages.cbegin(); it != m_languages.cend(); ++it) {
+        if (it.value()->definition.fileExtensions.contains(lowercaseExt)) {
+            return it.value();
+        }
+    }
+
+    return nullptr;
+}
+
+QStringList LanguageRegistry::availableLanguages() const
+{
+    return m_languages.keys();
+}
+
+QString LanguageRegistry::getDebugInfo() const
+{
+    QStringList info;
+
+    info << "LanguageRegistry Debug Info:";
+    info << QString("  Languages: %1").arg(m_languages.size());
+    info << QString("  Loaded from cache: %1").arg(m_loadedFromCache);
+    info << QString("  Compiled: %1").arg(m_compiled);
+    info << QString("  Cache directory: %1").arg(m_cacheDir.isEmpty() ? "(disabled)" : m_cacheDir);
+
+    return info.join("\n");
+}
+
+// ==============================================================================
+// 加载
+// ==============================================================================
+
+void LanguageRegistry::loadLanguageFiles(const QString& directory)
+{
+    QDir dir(directory);
+    const QStringList files = dir.entryList(QStringList{ "*.json" }, QDir::Files, QDir::Name);
+
+    for (const QString& fileName : files) {
+        if (auto language = loadLanguageFile(dir.filePath(fileName))) {
+            m_languages.insert(language->definition.name, std::move(language));
+        }
+    }
+}
+
+std::shared_ptr<const LanguageRegistry::Language> LanguageRegistry::loadLanguageFile(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "无法读取语言定义:" << filePath;
+        return nullptr;
+    }
+
+    const QByteArray data = file.readAll();
+
+    // 缓存键：文件内容和缓存格式版本的哈希，语言文件一改即换成新的缓存文件
+    QString cachePath;
+    if (!m_cacheDir.isEmpty()) {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(data);
+        hash.addData(QByteArray::number(CACHE_VERSION));
+        cachePath = m_cacheDir + "/" + QString::fromLatin1(hash.result().toHex()) + ".bin";
+
+        if (auto cached = readCache(cachePath)) {
+            m_loadedFromCache++;
+            return cached;
+        }
+    }
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+        qWarning() << "语言定义解析失败:" << filePath << error.errorString();
+        return nullptr;
+    }
+
+    auto language = std::make_shared<Language>();
+    if (!parseDefinition(doc.object(), &language->definition)) {
+        qWarning() << "语言定义缺少名称:" << filePath;
+        return nullptr;
+    }
+
+    language->lexer = std::make_shared<const CompiledLexer>(language->definition);
+    m_compiled++;
+
+    if (!cachePath.isEmpty()) {
+        writeCache(cachePath, *language);
+    }
+
+    return language;
+}
+
+bool LanguageRegistry::parseDefinition(const QJsonObject& object, LanguageDefinition* definition)
+{
+    definition->name = object.value("name").toString();
+    if (definition->name.isEmpty())
+        return false;
+
+    definition->fileExtensions = toStringList(object.value("fileExtensions"));
+    definition->keywords = toStringList(object.value("keywords"));
+    definition->types = toStringList(object.value("types"));
+    definition->functions = toStringList(object.value("functions"));
+
+    definition->singleLineComment = object.value("singleLineComment").toString();
+    definition->multiLineCommentStart = object.value("multiLineCommentStart").toString();
+    definition->multiLineCommentEnd = object.value("multiLineCommentEnd").toString();
+    definition->nestedComments = object.value("nestedComments").toBool();
+
+    definition->stringDelimiters = toStringList(object.value("stringDelimiters"));
+    definition->multiLineStringDelimiters = toStringList(object.value("multiLineStringDelimiters"));
+    definition->escapeCharacter = object.value("escapeCharacter").toString();
+    definition->foldingByIndentation = object.value("foldingByIndentation").toBool();
+
+    return true;
+}
+
+// ==============================================================================
+// 磁盘缓存
+// ==============================================================================
+
+std::shared_ptr<const LanguageRegistry::Language> LanguageRegistry::readCache(const QString& cachePath) const
+{
+    QFile file(cachePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != CACHE_MAGIC || version != CACHE_VERSION)
+        return nullptr;
+
+    auto language = std::make_shared<Language>();
+    LanguageDefinition& definition = language->definition;
+    in >> definition.name >> definition.fileExtensions
+        >> definition.keywords >> definition.types >> definition.functions
+        >> definition.singleLineComment >> definition.multiLineCommentStart
+        >> definition.multiLineCommentEnd >> definition.nestedComments
+        >> definition.stringDelimiters >> definition.multiLineStringDelimiters
+        >> definition.escapeCharacter >> definition.foldingByIndentation;
+    if (in.status() != QDataStream::Ok || definition.name.isEmpty())
+        return nullptr;
+
+    // 缓存的完美哈希参数与词表不符时放弃缓存，由调用方重新解析和编译
+    auto lexer = std::make_shared<const CompiledLexer>(definition, in);
+    if (!lexer->loadedFromCache()) {
+        qWarning() << "语言缓存已损坏:" << cachePath;
+        return nullptr;
+    }
+
+    language->lexer = std::move(lexer);
+    return language;
+}
+
+void LanguageRegistry::writeCache(const QString& cachePath, const Language& language) const
+{
+    if (!QDir().mkpath(m_cacheDir))
+        return;
+
+    // 原子写入，多个进程同时启动时不会读到半个文件
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "无法写入语言缓存:" << cachePath;
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    const LanguageDefinition& definition = language.definition;
+    out << CACHE_MAGIC << CACHE_VERSION;
+    out << definition.name << definition.fileExtensions
+        << definition.keywords << definition.types << definition.functions
+        << definition.singleLineComment << definition.multiLineCommentStart
+        << definition.multiLineCommentEnd << definition.nestedComments
+        << definition.stringDelimiters << definition.multiLineStringDelimiters
+        << definition.escapeCharacter << definition.foldingByIndentation;
+    language.lexer->writeKeywordTable(out);
+
+    file.commit();
+}
@@ -0,0 +1,55 @@
+#ifndef LANGUAGE_REGISTRY_H
+#define LANGUAGE_REGISTRY_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include "SyntaxHighlighter.h"
+
+class QJsonObject;
+
+// 进程内共享的语言注册表
+// 语言定义来自 resources/languages 下的 JSON 文件，首次使用时加载并编译一次，
+// 之后所有 SyntaxHighlighter 共享同一份定义和词法分析器，新建标签页不再解析或编译。
+// 编译结果按语言文件内容的哈希缓存在磁盘上，下次启动命中时跳过 JSON 解析和完美哈希搜索。
+// 只在主线程中访问；取出的 Language 只读，可交给工作线程
+class LanguageRegistry {
+public:
+    struct Language {
+        LanguageDefinition definition;
+        std::shared_ptr<const CompiledLexer> lexer;
+    };
+
+    static LanguageRegistry& instance();
+
+    // 注册或替换一种语言（运行时补充的定义不写入磁盘缓存）
+    void registerLanguage(const LanguageDefinition& definition);
+
+    std::shared_ptr<const Language> language(const QString& name) const;
+    std::shared_ptr<const Language> languageForExtension(const QString& extension) const;
+    QStringList availableLanguages() const;
+
+    QString getDebugInfo() const;
+
+private:
+    LanguageRegistry();
+    Q_DISABLE_COPY(LanguageRegistry)
+
+    QHash<QString, std::shared_ptr<const Language>> m_languages;
+    QString m_cacheDir;
+
+    // 统计
+    int m_loadedFromCache = 0;
+    int m_compiled = 0;
+
+    void loadLanguageFiles(const QString& directory);
+    std::shared_ptr<const Language> loadLanguageFile(const QString& filePath);
+
+    std::shared_ptr<const Language> readCache(const QString& cachePath) const;
+    void writeCache(const QString& cachePath, const Language& language) const;
+
+    static bool parseDefinition(const QJsonObject& object, LanguageDefinition* definition);
+};
+
+#endif // LANGUAGE_REGISTRY_H
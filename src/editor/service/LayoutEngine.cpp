@@ -1,7 +1,11 @@
 #include "LayoutEngine.h"
 #include "SyntaxHighlighter.h"
+#include "../core/DocumentModel.h"
+#include "../core/TextStorage.h"
 #include <QTextOption>
 #include <QTextLine>
+#include <QFontInfo>
+#include <QtConcurrent/QtConcurrent>
 #include <QDebug>
 #include <cmath>
 #include <algorithm>
@@ -10,10 +14,23 @@ LayoutEngine::LayoutEngine(QObject* parent)
     : QObject(parent)
     , m_font("Consolas")//, 12)
     , m_fontMetrics(m_font)
+    , m_wrapWatcher(new QFutureWatcher<WrapResult>(this))
 {
     m_font.setPixelSize(12);
     // 重新初始化字体度量（因为字体已经修改）
     m_fontMetrics = QFontMetrics(m_font);
+    m_monospace = QFontInfo(m_font).fixedPitch();
+    m_monospaceAdvance = QFontMetricsF(m_font).horizontalAdvance(QLatin1Char('M'));
+
+    // 合并连续的编辑和参数变化，后续各轮之间也经由事件循环让出
+    m_wrapTimer.setSingleShot(true);
+    m_wrapTimer.setInterval(10);
+    connect(&m_wrapTimer, &QTimer::timeout, this, &LayoutEngine::startWrapPass);
+
+    connect(m_wrapWatcher, &QFutureWatcher<WrapResult>::resultReadyAt,
+        this, &LayoutEngine::onWrapResultReady);
+    connect(m_wrapWatcher, &QFutureWatcher<WrapResult>::finished,
+        this, &LayoutEngine::onWrapPassFinished);
 
     // 初始化视口信息
     m_viewport.rect = QRectF();
@@ -25,7 +42,9 @@ LayoutEngine::LayoutEngine(QObject* parent)
 
 LayoutEngine::~LayoutEngine()
 {
-    clearLineLayouts();
+    // 换行任务只持有行文本的副本，不引用 this，取消即可
+    m_wrapWatcher->cancel();
+    releaseAllLayouts();
 }
 
 // ==============================================================================
@@ -39,6 +58,8 @@ void LayoutEngine::setFont(const QFont& font)
 
     m_font = font;
     m_fontMetrics = QFontMetrics(m_font);
+    m_monospace = QFontInfo(m_font).fixedPitch();
+    m_monospaceAdvance = QFontMetricsF(m_font).horizontalAdvance(QLatin1Char('M'));
 
     // 字体变化时，所有布局都需要重新计算
     invalidateAllLayouts();
@@ -63,6 +84,10 @@ qreal LayoutEngine::lineHeight() const
 
 qreal LayoutEngine::characterWidth() const
 {
+    // 等宽字体使用精确（小数）字宽，与 QTextLayout 的字形定位一致，按列换算时不累积误差
+    if (m_monospace)
+        return m_monospaceAdvance;
+
     // Qt 6 中 averageCharacterWidth() 被移除，使用 'M' 字符的宽度作为替代
     return m_fontMetrics.horizontalAdvance('M');
 }
@@ -128,143 +153,128 @@ bool LayoutEngine::wordWrap() const
 // 布局管理
 // ==============================================================================
 
-void LayoutEngine::setText(const QString& text)
+void LayoutEngine::setDocument(DocumentModel* document)
 {
-    if (m_text == text)
+    if (m_document == document)
         return;
 
-    m_text = text;
+    m_document = document;
+    m_ownedText.reset();
 
-    // 清除所有现有布局
-    clearLineLayouts();
+    resetLines();
+}
 
-    // 重新创建行布局结构
-    QStringList lines = splitIntoLines(m_text);
+DocumentModel* LayoutEngine::document() const
+{
+    return m_document;
+}
 
-    for (int i = 0; i < lines.size(); ++i) {
-        LineLayout* lineLayout = new LineLayout;
-        lineLayout->lineNumber = i;
-        lineLayout->layout = nullptr;
-        lineLayout->width = 0;
-        lineLayout->height = lineHeight();
-        lineLayout->visible = false;
-        lineLayout->dirty = true;
+void LayoutEngine::setText(const QString& text)
+{
+    if (!m_document && m_ownedText && m_ownedText->length() == text.length() &&
+        m_ownedText->getFullText() == text)
+        return;
 
-        m_lineLayouts.append(lineLayout);
-    }
+    m_document = nullptr;
+    m_ownedText = std::make_unique<PieceTable>(text);
 
-    emit layoutChanged();
+    resetLines();
 }
 
-void LayoutEngine::updateText(int position, int removedLength, const QString& addedText)
+void LayoutEngine::resetLines()
 {
-    // 更新文本内容
-    m_text.remove(position, removedLength);
-    m_text.insert(position, addedText);
+    // 清除所有现有布局
+    releaseAllLayouts();
 
-    // 重新分析行结构
-    QStringList newLines = splitIntoLines(m_text);
+    // 行度量按块分配，不为每行单独创建对象
+    m_lineMetrics.reset(sourceLineCount(), lineHeight());
+    scheduleWrapPass();
 
-    // 找到变更影响的行范围
-    int startLine = positionToLine(position);
-    int endLine = startLine;
+    emit layoutChanged();
+}
 
-    // 计算影响的行数
-    int removedLines = 0;
-    for (int i = position; i < position + removedLength && i < m_text.length() + removedLength; ++i) {
-        if (m_text.at(qMin(i, m_text.length() - 1)) == '\n') {
-            removedLines++;
+void LayoutEngine::updateText(int position, int removedLength, const QString& addedText)
+{
+    // 关联文档时变更已经应用到文档；内部文本需要在这里应用
+    if (!m_document) {
+        if (!m_ownedText) {
+            m_ownedText = std::make_unique<PieceTable>();
         }
+        m_ownedText->replace(position, removedLength, addedText);
     }
 
+    // 变更位置之前的文本不变，起始行在变更前后相同；
+    // 删除的换行数由变更前后的行数差推出，无需读取旧文本
+    int startLine = positionToLine(position);
     int addedLines = addedText.count('\n');
-    int netLineChange = addedLines - removedLines;
-
-    // 调整行布局结构
-    if (netLineChange > 0) {
-        // 添加了行
-        for (int i = 0; i < netLineChange; ++i) {
-            LineLayout* lineLayout = new LineLayout;
-            lineLayout->lineNumber = startLine + i + 1;
-            lineLayout->layout = nullptr;
-            lineLayout->width = 0;
-            lineLayout->height = lineHeight();
-            lineLayout->visible = false;
-            lineLayout->dirty = true;
-
-            m_lineLayouts.insert(startLine + i + 1, lineLayout);
-        }
-
-        // 更新后续行的行号
-        for (int i = startLine + netLineChange + 1; i < m_lineLayouts.size(); ++i) {
-            m_lineLayouts[i]->lineNumber = i;
-        }
+    int oldLineCount = m_lineMetrics.lineCount();
+    int removedLines = oldLineCount - sourceLineCount() + addedLines;
 
+    if (removedLines < 0 || startLine + removedLines >= oldLineCount) {
+        // 与已知行数不一致（例如漏掉了某次变更），整体重建
+        resetLines();
+        return;
     }
-    else if (netLineChange < 0) {
-        // 删除了行
-        for (int i = 0; i < -netLineChange && startLine + 1 < m_lineLayouts.size(); ++i) {
-            delete m_lineLayouts[startLine + 1];
-            m_lineLayouts.removeAt(startLine + 1);
-        }
 
-        // 更新后续行的行号
-        for (int i = startLine + 1; i < m_lineLayouts.size(); ++i) {
-            m_lineLayouts[i]->lineNumber = i;
+    // 删除的行：释放其布局，后续行的缓存行号前移
+    if (removedLines > 0) {
+        for (int i = 1; i <= removedLines; ++i) {
+            releaseLayout(startLine + i);
         }
+        m_lineMetrics.removeLines(startLine + 1, removedLines);
+        shiftCachedLayouts(startLine + 1 + removedLines, -removedLines);
     }
 
-    // 标记受影响的行为脏
-    endLine = qMin(startLine + qMax(1, qAbs(netLineChange)), m_lineLayouts.size() - 1);
-    for (int i = startLine; i <= endLine; ++i) {
-        if (i < m_lineLayouts.size()) {
-            invalidateLineLayout(i);
-        }
+    // 新增的行
+    if (addedLines > 0) {
+        shiftCachedLayouts(startLine + 1, addedLines);
+        m_lineMetrics.insertLines(startLine + 1, addedLines, lineHeight());
     }
 
+    // 起始行内容已变化；新插入的行本身就是脏的，也没有缓存的布局
+    invalidateLineLayout(startLine);
+
+    // 进行中的换行任务按旧行号计算，丢弃后重新调度
+    scheduleWrapPass();
+
     emit layoutChanged();
 }
 
-LineLayout* LayoutEngine::getLineLayout(int lineNumber)
+QTextLayout* LayoutEngine::getLineLayout(int lineNumber)
 {
-    if (lineNumber < 0 || lineNumber >= m_lineLayouts.size())
+    if (lineNumber < 0 || lineNumber >= m_lineMetrics.lineCount())
         return nullptr;
 
-    LineLayout* lineLayout = m_lineLayouts[lineNumber];
-
-    // 如果布局是脏的，重新创建
-    if (lineLayout->dirty || !lineLayout->layout) {
-        createLineLayout(lineNumber);
+    // 缓存命中且度量未失效时直接返回
+    CachedLayout* entry = m_layoutCache.value(lineNumber);
+    if (entry && !m_lineMetrics.isDirty(lineNumber)) {
+        m_layoutCacheHits++;
+        touchLayout(entry);
+        return entry->layout;
     }
 
-    return lineLayout;
+    m_layoutCacheMisses++;
+    return createLineLayout(lineNumber);
 }
 
 void LayoutEngine::invalidateLineLayout(int lineNumber)
 {
-    if (lineNumber < 0 || lineNumber >= m_lineLayouts.size())
+    if (lineNumber < 0 || lineNumber >= m_lineMetrics.lineCount())
         return;
 
-    LineLayout* lineLayout = m_lineLayouts[lineNumber];
-    lineLayout->dirty = true;
-
-    if (lineLayout->layout) {
-        delete lineLayout->layout;
-        lineLayout->layout = nullptr;
-    }
+    m_lineMetrics.setDirty(lineNumber);
+    releaseLayout(lineNumber);
 
     emit lineLayoutUpdated(lineNumber);
 }
 
 void LayoutEngine::invalidateAllLayouts()
 {
-    for (LineLayout* lineLayout : m_lineLayouts) {
-        lineLayout->dirty = true;
-        if (lineLayout->layout) {
-            delete lineLayout->layout;
-            lineLayout->layout = nullptr;
-        }
-    }
+    releaseAllLayouts();
+
+    // 行高按新的字体度量估算，视觉行数沿用上次结果，等待后台换行计算修正
+    m_lineMetrics.resetAll(lineHeight(), m_wordWrap);
+    scheduleWrapPass();
 }
 
 // ==============================================================================
@@ -288,43 +298,15 @@ ViewportInfo LayoutEngine::viewport() const
 
 void LayoutEngine::updateVisibleLines()
 {
-    if (m_lineLayouts.isEmpty()) {
+    if (m_lineMetrics.lineCount() == 0) {
         m_viewport.firstVisibleLine = 0;
         m_viewport.lastVisibleLine = 0;
         return;
     }
 
-    qreal currentY = -m_viewport.scrollY;
-    qreal viewportBottom = m_viewport.rect.height() - m_viewport.scrollY;
-
-    m_viewport.firstVisibleLine = 0;
-    m_viewport.lastVisibleLine = m_lineLayouts.size() - 1;
-
-    // 找到第一个可见行
-    for (int i = 0; i < m_lineLayouts.size(); ++i) {
-        LineLayout* lineLayout = m_lineLayouts[i];
-        if (currentY + lineLayout->height > 0) {
-            m_viewport.firstVisibleLine = i;
-            break;
-        }
-        currentY += lineLayout->height;
-    }
-
-    // 找到最后一个可见行
-    currentY = -m_viewport.scrollY;
-    for (int i = 0; i < m_lineLayouts.size(); ++i) {
-        if (currentY > viewportBottom) {
-            m_viewport.lastVisibleLine = qMax(0, i - 1);
-            break;
-        }
-
-        LineLayout* lineLayout = m_lineLayouts[i];
-        currentY += lineLayout->height;
-
-        if (i == m_lineLayouts.size() - 1) {
-            m_viewport.lastVisibleLine = i;
-        }
-    }
+    // 视口上下边缘所在的行
+    m_viewport.firstVisibleLine = lineAtY(m_viewport.scrollY);
+    m_viewport.lastVisibleLine = lineAtY(m_viewport.scrollY + m_viewport.rect.height());
 }
 
 // ==============================================================================
@@ -333,55 +315,96 @@ void LayoutEngine::updateVisibleLines()
 
 QPointF LayoutEngine::positionToPoint(int position) const
 {
-    if (m_lineLayouts.isEmpty())
+    if (m_lineMetrics.lineCount() == 0)
         return QPointF(0, 0);
 
     // 找到位置所在的行
     int lineNumber = positionToLine(position);
-    int columnInLine = positionToColumn(position, lineNumber);
+    QString lineText = getLineText(lineNumber);
+    int columnInLine = qMin(positionToColumn(position, lineNumber), lineText.length());
 
     // 计算 Y 坐标
-    qreal y = 0;
-    for (int i = 0; i < lineNumber && i < m_lineLayouts.size(); ++i) {
-        y += m_lineLayouts[i]->height;
+    qreal y = lineTop(lineNumber);
+
+    // 等宽快速路径：定位视觉行后按列计算
+    if (isMonospaceLine(lineNumber, lineText)) {
+        QList<int> rowStarts = monospaceRowStarts(lineText);
+        int row = static_cast<int>(std::upper_bound(rowStarts.cbegin(), rowStarts.cend(), columnInLine)
+            - rowStarts.cbegin());
+        int rowStart = row > 0 ? rowStarts[row - 1] : 0;
+
+        qreal x = monospaceColumn(lineText, rowStart, columnInLine, m_tabWidth) * characterWidth();
+        return QPointF(x, y + row * lineHeight());
+    }
+
+    // 已塑形的行直接从布局取坐标，可处理换行和复杂文字
+    if (const QTextLayout* layout = cachedLayout(lineNumber)) {
+        QTextLine line = layout->lineForTextPosition(columnInLine);
+        if (line.isValid()) {
+            return QPointF(line.cursorToX(columnInLine), y + line.y());
+        }
     }
 
     // 计算 X 坐标
-    qreal x = 0;
-    if (lineNumber < m_lineLayouts.size()) {
-        QString lineText = getLineText(lineNumber);
-        QString textBeforeCursor = lineText.left(columnInLine);
+    QString textBeforeCursor = lineText.left(columnInLine);
 
-        // 处理制表符
-        QString expandedText = expandTabs(textBeforeCursor);
-        x = m_fontMetrics.horizontalAdvance(expandedText);
-    }
+    // 处理制表符
+    QString expandedText = expandTabs(textBeforeCursor);
+    qreal x = m_fontMetrics.horizontalAdvance(expandedText);
 
     return QPointF(x, y);
 }
 
 int LayoutEngine::pointToPosition(const QPointF& point) const
 {
-    if (m_lineLayouts.isEmpty())
+    if (m_lineMetrics.lineCount() == 0)
         return 0;
 
     // 找到点击的行
-    qreal currentY = 0;
-    int lineNumber = 0;
-
-    for (int i = 0; i < m_lineLayouts.size(); ++i) {
-        qreal lineBottom = currentY + m_lineLayouts[i]->height;
-        if (point.y() < lineBottom) {
-            lineNumber = i;
-            break;
-        }
-        currentY = lineBottom;
-        lineNumber = i;
-    }
+    int lineNumber = lineAtY(point.y());
 
     // 在行内找到列位置
     QString lineText = getLineText(lineNumber);
     qreal targetX = point.x();
+
+    // 等宽快速路径：按纵坐标确定视觉行，再按列查找
+    if (isMonospaceLine(lineNumber, lineText)) {
+        QList<int> rowStarts = monospaceRowStarts(lineText);
+        int row = qBound(0, static_cast<int>((point.y() - lineTop(lineNumber)) / lineHeight()),
+            static_cast<int>(rowStarts.size()));
+        int rowStart = row > 0 ? rowStarts[row - 1] : 0;
+        int rowEnd = row < rowStarts.size() ? rowStarts[row] : lineText.length();
+
+        qreal targetColumn = targetX / characterWidth();
+        int visualColumn = 0;
+        int column = rowStart;
+
+        for (; column < rowEnd; ++column) {
+            int width = lineText[column] == '\t' ? m_tabWidth - visualColumn % m_tabWidth : 1;
+            if (visualColumn + width / 2.0 > targetColumn)
+                break;
+            visualColumn += width;
+        }
+
+        // 换行处的位置显示在下一视觉行的开头，点击本行末尾时停在断行字符之前
+        if (row < rowStarts.size() && column == rowEnd && column > rowStart) {
+            column--;
+        }
+
+        return lineColumnToPosition(lineNumber, column);
+    }
+
+    // 已塑形的行交给布局做命中测试
+    if (const QTextLayout* layout = cachedLayout(lineNumber)) {
+        qreal lineY = point.y() - lineTop(lineNumber);
+        for (int i = 0; i < layout->lineCount(); ++i) {
+            QTextLine line = layout->lineAt(i);
+            if (lineY < line.y() + line.height() || i == layout->lineCount() - 1) {
+                return lineColumnToPosition(lineNumber, line.xToCursor(targetX));
+            }
+        }
+    }
+
     qreal currentX = 0;
     int column = 0;
 
@@ -411,16 +434,11 @@ int LayoutEngine::pointToPosition(const QPointF& point) const
 
 QRectF LayoutEngine::lineRect(int lineNumber) const
 {
-    if (lineNumber < 0 || lineNumber >= m_lineLayouts.size())
+    if (lineNumber < 0 || lineNumber >= m_lineMetrics.lineCount())
         return QRectF();
 
-    qreal y = 0;
-    for (int i = 0; i < lineNumber; ++i) {
-        y += m_lineLayouts[i]->height;
-    }
-
-    LineLayout* lineLayout = m_lineLayouts[lineNumber];
-    return QRectF(0, y, lineLayout->width, lineLayout->height);
+    return QRectF(0, lineTop(lineNumber),
+        m_lineMetrics.width(lineNumber), m_lineMetrics.height(lineNumber));
 }
 
 QRectF LayoutEngine::selectionRect(int startPos, int endPos) const
@@ -456,10 +474,19 @@ QList<int> LayoutEngine::getVisibleLines() const
 {
     QList<int> visibleLines;
 
-    for (int i = m_viewport.firstVisibleLine; i <= m_viewport.lastVisibleLine; ++i) {
-        if (i >= 0 && i < m_lineLayouts.size()) {
-            visibleLines.append(i);
-        }
+    int first = qMax(0, m_viewport.firstVisibleLine);
+    int last = qMin(m_viewport.lastVisibleLine, m_lineMetrics.lineCount() - 1);
+    if (first > last)
+        return visibleLines;
+
+    // 按可见行序号逐个取行，跳过折叠区域时不逐行检查
+    int index = m_lineMetrics.visibleLinesBefore(first);
+    int total = m_lineMetrics.visibleLineCount();
+    for (; index < total; ++index) {
+        int line = m_lineMetrics.lineAtVisibleIndex(index);
+        if (line > last)
+            break;
+        visibleLines.append(line);
     }
 
     return visibleLines;
@@ -481,86 +508,105 @@ void LayoutEngine::ensureLayoutForVisibleLines()
 int LayoutEngine::visualLineCount() const
 {
     if (!m_wordWrap) {
-        return m_lineLayouts.size();
-    }
-
-    int visualLines = 0;
-    for (const LineLayout* lineLayout : m_lineLayouts) {
-        if (lineLayout->layout) {
-            visualLines += lineLayout->layout->lineCount();
-        }
-        else {
-            visualLines += 1; // 估算
-        }
+        return m_lineMetrics.visibleLineCount();
     }
 
-    return visualLines;
+    return m_lineMetrics.totalVisualLines();
 }
 
 int LayoutEngine::logicalLineToVisualLine(int logicalLine) const
 {
-    if (!m_wordWrap || logicalLine < 0 || logicalLine >= m_lineLayouts.size()) {
+    if (logicalLine < 0 || logicalLine >= m_lineMetrics.lineCount()) {
         return logicalLine;
     }
 
-    int visualLine = 0;
-    for (int i = 0; i < logicalLine; ++i) {
-        const LineLayout* lineLayout = m_lineLayouts[i];
-        if (lineLayout->layout) {
-            visualLine += lineLayout->layout->lineCount();
-        }
-        else {
-            visualLine += 1;
-        }
+    // 不换行时每个可见行是一个视觉行
+    if (!m_wordWrap) {
+        return m_lineMetrics.visibleLinesBefore(logicalLine);
     }
 
-    return visualLine;
+    return m_lineMetrics.visualLinesBefore(logicalLine);
 }
 
 int LayoutEngine::visualLineToLogicalLine(int visualLine) const
 {
     if (!m_wordWrap) {
-        return visualLine;
+        return m_lineMetrics.lineAtVisibleIndex(visualLine);
     }
 
-    int currentVisualLine = 0;
-    for (int i = 0; i < m_lineLayouts.size(); ++i) {
-        const LineLayout* lineLayout = m_lineLayouts[i];
-        int linesInLayout = lineLayout->layout ? lineLayout->layout->lineCount() : 1;
-
-        if (currentVisualLine + linesInLayout > visualLine) {
-            return i;
-        }
+    return m_lineMetrics.lineAtVisualLine(visualLine);
+}
 
-        currentVisualLine += linesInLayout;
-    }
+qreal LayoutEngine::lineTop(int lineNumber) const
+{
+    return m_lineMetrics.heightBefore(lineNumber);
+}
 
-    return qMax(0, m_lineLayouts.size() - 1);
+int LayoutEngine::lineAtY(qreal y) const
+{
+    return m_lineMetrics.lineAtHeight(y);
 }
 
 // ==============================================================================
-// 私有辅助方法
+// 代码折叠
 // ==============================================================================
 
-void LayoutEngine::createLineLayout(int lineNumber)
+void LayoutEngine::setLinesHidden(int firstLine, int count, bool hidden)
 {
-    if (lineNumber < 0 || lineNumber >= m_lineLayouts.size())
+    if (count <= 0)
         return;
 
-    LineLayout* lineLayout = m_lineLayouts[lineNumber];
+    // 只改状态位和块汇总，已塑形的布局和行度量保留，展开时无需重新计算
+    m_lineMetrics.setHidden(firstLine, count, hidden);
+    updateVisibleLines();
+
+    emit layoutChanged();
+}
+
+bool LayoutEngine::isLineHidden(int lineNumber) const
+{
+    return m_lineMetrics.isHidden(lineNumber);
+}
+
+bool LayoutEngine::hasHiddenLines() const
+{
+    return m_lineMetrics.hasHiddenLines();
+}
+
+int LayoutEngine::visibleLineCount() const
+{
+    return m_lineMetrics.visibleLineCount();
+}
+
+int LayoutEngine::visibleLineIndex(int lineNumber) const
+{
+    return m_lineMetrics.visibleLinesBefore(lineNumber);
+}
+
+int LayoutEngine::lineAtVisibleIndex(int index) const
+{
+    return m_lineMetrics.lineAtVisibleIndex(index);
+}
+
+// ==============================================================================
+// 私有辅助方法
+// ==============================================================================
+
+QTextLayout* LayoutEngine::createLineLayout(int lineNumber)
+{
+    if (lineNumber < 0 || lineNumber >= m_lineMetrics.lineCount())
+        return nullptr;
 
     // 清除旧布局
-    if (lineLayout->layout) {
-        delete lineLayout->layout;
-    }
+    releaseLayout(lineNumber);
 
     // 创建新布局
-    lineLayout->layout = new QTextLayout();
-    lineLayout->layout->setFont(m_font);
+    QTextLayout* layout = new QTextLayout();
+    layout->setFont(m_font);
 
     // 设置文本内容
     QString lineText = getLineText(lineNumber);
-    lineLayout->layout->setText(lineText);
+    layout->setText(lineText);
 
     // 设置文本选项
     QTextOption textOption;
@@ -573,16 +619,16 @@ void LayoutEngine::createLineLayout(int lineNumber)
         textOption.setWrapMode(QTextOption::NoWrap);
     }
 
-    lineLayout->layout->setTextOption(textOption);
+    layout->setTextOption(textOption);
 
     // 开始布局过程
-    lineLayout->layout->beginLayout();
+    layout->beginLayout();
 
     qreal lineY = 0;
     qreal maxWidth = 0;
 
     while (true) {
-        QTextLine line = lineLayout->layout->createLine();
+        QTextLine line = layout->createLine();
         if (!line.isValid())
             break;
 
@@ -595,68 +641,505 @@ void LayoutEngine::createLineLayout(int lineNumber)
         maxWidth = qMax(maxWidth, line.naturalTextWidth());
     }
 
-    lineLayout->layout->endLayout();
+    layout->endLayout();
+
+    // 更新布局信息（同时清除脏标记）
+    m_lineMetrics.setMetrics(lineNumber, qMax(lineY, lineHeight()), // 至少一行高
+        qMax(1, layout->lineCount()), maxWidth);
+    m_lineMetrics.setComplex(lineNumber, containsComplexCharacters(lineText));
 
-    // 更新布局信息
-    lineLayout->width = maxWidth;
-    lineLayout->height = qMax(lineY, lineHeight()); // 至少一行高
-    lineLayout->dirty = false;
+    // 加入缓存，超出预算时淘汰最久未使用的布局
+    attachLayout(lineNumber, layout);
+    evictLayouts();
 
     emit lineLayoutUpdated(lineNumber);
+    return layout;
+}
+
+void LayoutEngine::attachLayout(int lineNumber, QTextLayout* layout)
+{
+    CachedLayout* entry = new CachedLayout;
+    entry->lineNumber = lineNumber;
+    entry->layout = layout;
+    entry->bytes = estimateLayoutBytes(layout);
+
+    // 插入表头
+    entry->next = m_lruHead;
+    if (m_lruHead) {
+        m_lruHead->prev = entry;
+    }
+    m_lruHead = entry;
+    if (!m_lruTail) {
+        m_lruTail = entry;
+    }
+
+    m_layoutCache.insert(lineNumber, entry);
+    m_cachedLayoutBytes += entry->bytes;
+}
+
+void LayoutEngine::releaseLayout(int lineNumber)
+{
+    CachedLayout* entry = m_layoutCache.take(lineNumber);
+    if (!entry)
+        return;
+
+    unlinkLayout(entry);
+    m_cachedLayoutBytes -= entry->bytes;
+
+    delete entry->layout;
+    delete entry;
+}
+
+void LayoutEngine::releaseAllLayouts()
+{
+    for (CachedLayout* entry : std::as_const(m_layoutCache)) {
+        delete entry->layout;
+        delete entry;
+    }
+
+    m_layoutCache.clear();
+    m_lruHead = nullptr;
+    m_lruTail = nullptr;
+    m_cachedLayoutBytes = 0;
 }
 
-void LayoutEngine::updateLineLayout(LineLayout* layout)
+void LayoutEngine::touchLayout(CachedLayout* entry)
 {
-    if (!layout || !layout->layout)
+    if (m_lruHead == entry)
         return;
 
-    // 重新计算布局
-    createLineLayout(layout->lineNumber);
+    unlinkLayout(entry);
+
+    entry->next = m_lruHead;
+    if (m_lruHead) {
+        m_lruHead->prev = entry;
+    }
+    m_lruHead = entry;
+    if (!m_lruTail) {
+        m_lruTail = entry;
+    }
 }
 
-void LayoutEngine::clearLineLayouts()
+void LayoutEngine::unlinkLayout(CachedLayout* entry)
 {
-    for (LineLayout* lineLayout : m_lineLayouts) {
-        if (lineLayout->layout) {
-            delete lineLayout->layout;
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    }
+    else {
+        m_lruHead = entry->next;
+    }
+
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    }
+    else {
+        m_lruTail = entry->prev;
+    }
+
+    entry->prev = nullptr;
+    entry->next = nullptr;
+}
+
+void LayoutEngine::evictLayouts()
+{
+    // 从表尾开始淘汰，跳过视口内的行；最近使用的布局总是保留
+    CachedLayout* candidate = m_lruTail;
+
+    while (candidate && candidate != m_lruHead &&
+        (m_layoutCache.size() > m_maxCachedLayouts || m_cachedLayoutBytes > m_maxCachedLayoutBytes)) {
+        CachedLayout* previous = candidate->prev;
+
+        if (!isLineInViewport(candidate->lineNumber)) {
+            releaseLayout(candidate->lineNumber);
+            m_layoutEvictions++;
         }
-        delete lineLayout;
+
+        candidate = previous;
+    }
+}
+
+void LayoutEngine::shiftCachedLayouts(int fromLine, int delta)
+{
+    if (delta == 0 || m_layoutCache.isEmpty())
+        return;
+
+    // 缓存的布局数量有上限，整体重建散列表的代价很小
+    QHash<int, CachedLayout*> shifted;
+    shifted.reserve(m_layoutCache.size());
+
+    for (CachedLayout* entry : std::as_const(m_layoutCache)) {
+        if (entry->lineNumber >= fromLine) {
+            entry->lineNumber += delta;
+        }
+        shifted.insert(entry->lineNumber, entry);
     }
-    m_lineLayouts.clear();
+
+    m_layoutCache.swap(shifted);
 }
 
-QStringList LayoutEngine::splitIntoLines(const QString& text) const
+const QTextLayout* LayoutEngine::cachedLayout(int lineNumber) const
 {
-    return text.split('\n');
+    CachedLayout* entry = m_layoutCache.value(lineNumber);
+    return entry ? entry->layout : nullptr;
+}
+
+bool LayoutEngine::isLineInViewport(int lineNumber) const
+{
+    return lineNumber >= m_viewport.firstVisibleLine && lineNumber <= m_viewport.lastVisibleLine;
 }
 
 // ==============================================================================
-// 辅助方法
+// 后台换行计算
 // ==============================================================================
 
-QString LayoutEngine::getLineText(int lineNumber) const
+bool LayoutEngine::isWrapActive() const
 {
-    QStringList lines = splitIntoLines(m_text);
-    if (lineNumber >= 0 && lineNumber < lines.size()) {
-        return lines[lineNumber];
+    return m_wordWrap && m_textWidth > 0;
+}
+
+void LayoutEngine::scheduleWrapPass()
+{
+    m_wrapGeneration++;
+
+    if (isWrapActive()) {
+        m_wrapTimer.start();
+    }
+    else {
+        m_wrapTimer.stop();
     }
-    return QString();
 }
 
-int LayoutEngine::positionToLine(int position) const
+void LayoutEngine::startWrapPass()
+{
+    // 上一轮还在计算，完成后会继续检查估算行
+    if (!isWrapActive() || m_wrapWatcher->isRunning())
+        return;
+
+    WrapJob prototype;
+    prototype.generation = m_wrapGeneration;
+    prototype.font = m_font;
+    prototype.width = m_textWidth;
+    prototype.tabStop = tabWidth();
+    prototype.monospace = m_monospace;
+
+    // 可见行在绘制时已经塑形，从视口开始向后收集，再回到文档开头
+    QList<WrapJob> jobs;
+    int collected = 0;
+
+    auto collect = [&](int from, int to) {
+        for (int line = m_lineMetrics.nextEstimatedLine(from);
+            line >= 0 && line < to && collected < WRAP_LINES_PER_ROUND;
+            line = m_lineMetrics.nextEstimatedLine(line + 1)) {
+            if (jobs.isEmpty() || jobs.last().lines.size() == WRAP_BATCH_LINES) {
+                jobs.append(prototype);
+            }
+            jobs.last().lines.append(line);
+            jobs.last().texts.append(getLineText(line));
+            collected++;
+        }
+    };
+
+    int start = qBound(0, m_viewport.firstVisibleLine, m_lineMetrics.lineCount());
+    collect(start, m_lineMetrics.lineCount());
+    collect(0, start);
+
+    if (jobs.isEmpty())
+        return;
+
+    m_wrapWatcher->setFuture(QtConcurrent::mapped(std::move(jobs), &LayoutEngine::runWrapJob));
+}
+
+void LayoutEngine::onWrapResultReady(int index)
+{
+    WrapResult result = m_wrapWatcher->resultAt(index);
+    if (result.generation != m_wrapGeneration)
+        return;
+
+    // 期间塑形过的行不再是估算状态，由行度量存储忽略
+    qreal height = lineHeight();
+    for (int i = 0; i < result.lines.size(); ++i) {
+        m_lineMetrics.setEstimatedVisualLines(result.lines[i], result.visualLines[i], height);
+    }
+
+    m_wrapResultsApplied = true;
+}
+
+void LayoutEngine::onWrapPassFinished()
+{
+    if (m_wrapResultsApplied) {
+        m_wrapResultsApplied = false;
+        updateVisibleLines();
+        emit layoutChanged();
+    }
+
+    // 还有估算行（包括本轮期间因变更而丢弃的）时继续下一轮
+    if (isWrapActive() && m_lineMetrics.estimatedLineCount() > 0) {
+        m_wrapTimer.start();
+    }
+}
+
+LayoutEngine::WrapResult LayoutEngine::runWrapJob(const WrapJob& job)
 {
-    int currentPos = 0;
-    QStringList lines = splitIntoLines(m_text);
+    WrapResult result;
+    result.generation = job.generation;
+    result.lines = job.lines;
+    result.visualLines.reserve(job.texts.size());
+
+    QFontMetricsF metrics(job.font);
+    for (const QString& text : job.texts) {
+        result.visualLines.append(countWrappedRows(text, metrics, job.width, job.tabStop, job.monospace));
+    }
+
+    return result;
+}
+
+int LayoutEngine::countWrappedRows(const QString& text, const QFontMetricsF& metrics,
+    qreal width, qreal tabStop, bool monospace)
+{
+    if (width <= 0 || text.isEmpty())
+        return 1;
+
+    // 等宽字体下只含单宽字符的行按字符列计算，不逐词测量
+    if (monospace && !containsComplexCharacters(text)) {
+        qreal charWidth = metrics.horizontalAdvance(QLatin1Char('M'));
+        int columns = qMax(1, static_cast<int>(width / charWidth));
+        int tabColumns = qMax(1, qRound(tabStop / charWidth));
+        return static_cast<int>(monospaceRowStarts(text, columns, tabColumns).size()) + 1;
+    }
+
+    auto measure = [&](int start, int length) -> qreal {
+        return metrics.horizontalAdvance(text.mid(start, length));
+    };
+
+    // 与 WrapAtWordBoundaryOrAnywhere 一致：在空白后断行，单词超过行宽时在任意字符处断开，
+    // 行尾的空白不引起换行
+    int rows = 1;
+    qreal x = 0;
+    int i = 0;
+    const int length = text.length();
 
-    for (int i = 0; i < lines.size(); ++i) {
-        int lineLength = lines[i].length();
-        if (currentPos + lineLength >= position) {
-            return i;
+    while (i < length) {
+        int wordEnd = i;
+        while (wordEnd < length && !text[wordEnd].isSpace()) {
+            wordEnd++;
+        }
+
+        if (wordEnd > i) {
+            qreal wordWidth = measure(i, wordEnd - i);
+            if (x > 0 && x + wordWidth > width) {
+                rows++;
+                x = 0;
+            }
+
+            if (wordWidth > width) {
+                for (int k = i; k < wordEnd; ++k) {
+                    qreal advance = measure(k, 1);
+                    if (x > 0 && x + advance > width) {
+                        rows++;
+                        x = 0;
+                    }
+                    x += advance;
+                }
+            }
+            else {
+                x += wordWidth;
+            }
+            i = wordEnd;
+        }
+
+        while (i < length && text[i].isSpace()) {
+            if (text[i] == '\t' && tabStop > 0) {
+                x += tabStop - std::fmod(x, tabStop);
+            }
+            else {
+                x += measure(i, 1);
+            }
+            i++;
         }
-        currentPos += lineLength + 1; // +1 for newline
     }
 
-    return qMax(0, lines.size() - 1);
+    return rows;
+}
+
+// ==============================================================================
+// 等宽快速路径
+// ==============================================================================
+
+bool LayoutEngine::isMonospaceLine(int lineNumber, const QString& text) const
+{
+    if (!m_monospace)
+        return false;
+
+    // 塑形过的行已记录分类结果，否则现场检查
+    if (m_lineMetrics.isClassified(lineNumber))
+        return !m_lineMetrics.isComplex(lineNumber);
+
+    return !containsComplexCharacters(text);
+}
+
+int LayoutEngine::wrapColumns() const
+{
+    if (!isWrapActive())
+        return 0;
+
+    return qMax(1, static_cast<int>(m_textWidth / characterWidth()));
+}
+
+QList<int> LayoutEngine::monospaceRowStarts(const QString& text) const
+{
+    int columns = wrapColumns();
+    if (columns <= 0)
+        return QList<int>();
+
+    return monospaceRowStarts(text, columns, m_tabWidth);
+}
+
+QList<int> LayoutEngine::monospaceRowStarts(const QString& text, int columns, int tabColumns)
+{
+    // 返回第一行之外各视觉行的起始下标。断行规则与 WrapAtWordBoundaryOrAnywhere 一致：
+    // 在空白后断行，单词超过行宽时在任意字符处断开，行尾的空白不引起换行
+    QList<int> rowStarts;
+    int column = 0;
+    int i = 0;
+    const int length = text.length();
+
+    while (i < length) {
+        int wordEnd = i;
+        while (wordEnd < length && !text[wordEnd].isSpace()) {
+            wordEnd++;
+        }
+
+        int wordColumns = wordEnd - i;
+        if (wordColumns > 0) {
+            if (column > 0 && column + wordColumns > columns) {
+                rowStarts.append(i);
+                column = 0;
+            }
+
+            // 超长单词每满一行断开一次
+            while (column + wordColumns > columns) {
+                int taken = columns - column;
+                i += taken;
+                wordColumns -= taken;
+                rowStarts.append(i);
+                column = 0;
+            }
+
+            column += wordColumns;
+            i = wordEnd;
+        }
+
+        while (i < length && text[i].isSpace()) {
+            column += text[i] == '\t' ? tabColumns - column % tabColumns : 1;
+            i++;
+        }
+    }
+
+    return rowStarts;
+}
+
+int LayoutEngine::monospaceColumn(const QString& text, int from, int to, int tabColumns)
+{
+    // [from, to) 展开制表符后占用的列数，制表位从 from 处起算
+    int column = 0;
+    for (int i = from; i < to; ++i) {
+        column += text[i] == '\t' ? tabColumns - column % tabColumns : 1;
+    }
+    return column;
+}
+
+bool LayoutEngine::isComplexCharacter(QChar ch)
+{
+    const char16_t code = ch.unicode();
+
+    if (code < 0x80)
+        return code < 0x20 && code != '\t';
+
+    if (ch.isSurrogate())
+        return true;
+
+    // 组合字符、零宽格式字符和控制字符不占一列
+    switch (ch.category()) {
+    case QChar::Mark_NonSpacing:
+    case QChar::Mark_SpacingCombining:
+    case QChar::Mark_Enclosing:
+    case QChar::Other_Format:
+    case QChar::Other_Control:
+        return true;
+    default:
+        break;
+    }
+
+    // 从右到左的文字需要双向重排
+    switch (ch.direction()) {
+    case QChar::DirR:
+    case QChar::DirAL:
+    case QChar::DirRLE:
+    case QChar::DirRLO:
+    case QChar::DirRLI:
+        return true;
+    default:
+        break;
+    }
+
+    // 东亚宽字符占两列（谚文字母、中日韩文字、全角形式等）
+    return (code >= 0x1100 && code <= 0x115F) ||
+        (code >= 0x2E80 && code <= 0xA4CF) ||
+        (code >= 0xAC00 && code <= 0xD7A3) ||
+        (code >= 0xF900 && code <= 0xFAFF) ||
+        (code >= 0xFE30 && code <= 0xFE4F) ||
+        (code >= 0xFF00 && code <= 0xFF60) ||
+        (code >= 0xFFE0 && code <= 0xFFE6);
+}
+
+bool LayoutEngine::containsComplexCharacters(const QString& text)
+{
+    for (QChar ch : text) {
+        if (isComplexCharacter(ch))
+            return true;
+    }
+    return false;
+}
+
+qint64 LayoutEngine::estimateLayoutBytes(const QTextLayout* layout)
+{
+    // QTextLayout 每个字形保存索引、advance、偏移和属性，约 40 字节；另有引擎和 QTextLine 的固定开销
+    constexpr qint64 BYTES_PER_CHARACTER = 40;
+    constexpr qint64 BYTES_PER_LINE = 64;
+    constexpr qint64 BASE_BYTES = 512;
+
+    return BASE_BYTES + layout->text().length() * BYTES_PER_CHARACTER + layout->lineCount() * BYTES_PER_LINE;
+}
+
+// ==============================================================================
+// 辅助方法
+// ==============================================================================
+
+int LayoutEngine::sourceLineCount() const
+{
+    if (m_document)
+        return m_document->lineCount();
+    if (m_ownedText)
+        return m_ownedText->getLineCount();
+    return 1;
+}
+
+QString LayoutEngine::getLineText(int lineNumber) const
+{
+    if (m_document)
+        return m_document->getLine(lineNumber);
+    if (m_ownedText && lineNumber >= 0 && lineNumber < m_ownedText->getLineCount())
+        return m_ownedText->getLine(lineNumber);
+    return QString();
+}
+
+int LayoutEngine::positionToLine(int position) const
+{
+    if (m_document)
+        return m_document->positionToLine(position);
+    if (m_ownedText)
+        return m_ownedText->positionToLine(qBound(0, position, m_ownedText->length()));
+    return 0;
 }
 
 int LayoutEngine::positionToColumn(int position, int lineNumber) const
@@ -667,24 +1150,17 @@ int LayoutEngine::positionToColumn(int position, int lineNumber) const
 
 int LayoutEngine::lineColumnToPosition(int lineNumber, int column) const
 {
-    QStringList lines = splitIntoLines(m_text);
-
-    if (lineNumber < 0 || lineNumber >= lines.size())
+    if (lineNumber < 0 || lineNumber >= sourceLineCount())
         return 0;
 
-    int position = 0;
+    if (m_document)
+        return m_document->lineColumnToPosition(lineNumber, column);
 
-    // 累加前面行的长度
-    for (int i = 0; i < lineNumber; ++i) {
-        position += lines[i].length() + 1; // +1 for newline
-    }
-
-    // 加上当前行的列偏移
-    int lineLength = lines[lineNumber].length();
-    column = qBound(0, column, lineLength);
-    position += column;
+    if (!m_ownedText)
+        return 0;
 
-    return position;
+    column = qBound(0, column, m_ownedText->getLine(lineNumber).length());
+    return m_ownedText->lineColumnToPosition(lineNumber, column);
 }
 
 QString LayoutEngine::expandTabs(const QString& text) const
@@ -716,29 +1192,41 @@ QString LayoutEngine::expandTabs(const QString& text) const
 // 获取行的实际渲染高度（考虑软换行）
 qreal LayoutEngine::getLineRenderHeight(int lineNumber) const
 {
-    if (lineNumber < 0 || lineNumber >= m_lineLayouts.size())
+    if (lineNumber < 0 || lineNumber >= m_lineMetrics.lineCount())
         return lineHeight();
 
-    const LineLayout* lineLayout = m_lineLayouts[lineNumber];
-    if (lineLayout->layout) {
-        return lineLayout->layout->boundingRect().height();
+    if (const QTextLayout* layout = cachedLayout(lineNumber)) {
+        return layout->boundingRect().height();
     }
 
-    return lineHeight();
+    return m_lineMetrics.height(lineNumber);
 }
 
 // 获取行的实际渲染宽度
 qreal LayoutEngine::getLineRenderWidth(int lineNumber) const
 {
-    if (lineNumber < 0 || lineNumber >= m_lineLayouts.size())
+    if (lineNumber < 0 || lineNumber >= m_lineMetrics.lineCount())
         return 0;
 
-    const LineLayout* lineLayout = m_lineLayouts[lineNumber];
-    if (lineLayout->layout) {
-        return lineLayout->layout->boundingRect().width();
+    if (const QTextLayout* layout = cachedLayout(lineNumber)) {
+        return layout->boundingRect().width();
     }
 
     QString lineText = getLineText(lineNumber);
+
+    // 等宽快速路径：最宽视觉行的列数乘以字宽
+    if (isMonospaceLine(lineNumber, lineText)) {
+        QList<int> rowStarts = monospaceRowStarts(lineText);
+        rowStarts.prepend(0);
+        rowStarts.append(lineText.length());
+
+        int columns = 0;
+        for (int i = 0; i + 1 < rowStarts.size(); ++i) {
+            columns = qMax(columns, monospaceColumn(lineText, rowStarts[i], rowStarts[i + 1], m_tabWidth));
+        }
+        return columns * characterWidth();
+    }
+
     QString expandedText = expandTabs(lineText);
     return m_fontMetrics.horizontalAdvance(expandedText);
 }
@@ -746,17 +1234,23 @@ qreal LayoutEngine::getLineRenderWidth(int lineNumber) const
 // 缓存管理
 void LayoutEngine::setMaxCachedLayouts(int maxLayouts)
 {
-    Q_UNUSED(maxLayouts)
-        // 可以实现LRU缓存来限制内存使用
+    m_maxCachedLayouts = qMax(1, maxLayouts);
+    evictLayouts();
+}
+
+void LayoutEngine::setMaxCachedLayoutBytes(qint64 maxBytes)
+{
+    m_maxCachedLayoutBytes = qMax<qint64>(0, maxBytes);
+    evictLayouts();
 }
 
 void LayoutEngine::clearLayoutCache()
 {
-    for (LineLayout* lineLayout : m_lineLayouts) {
-        if (lineLayout->layout && !lineLayout->visible) {
-            delete lineLayout->layout;
-            lineLayout->layout = nullptr;
-            lineLayout->dirty = true;
+    // 释放视口外的全部布局，行度量保留
+    const QList<int> lines = m_layoutCache.keys();
+    for (int lineNumber : lines) {
+        if (!isLineInViewport(lineNumber)) {
+            releaseLayout(lineNumber);
         }
     }
 }
@@ -764,31 +1258,22 @@ void LayoutEngine::clearLayoutCache()
 // 性能统计
 int LayoutEngine::getCachedLayoutCount() const
 {
-    int count = 0;
-    for (const LineLayout* lineLayout : m_lineLayouts) {
-        if (lineLayout->layout) {
-            count++;
-        }
-    }
-    return count;
+    return m_layoutCache.size();
 }
 
 qreal LayoutEngine::getTotalDocumentHeight() const
 {
-    qreal totalHeight = 0;
-    for (const LineLayout* lineLayout : m_lineLayouts) {
-        totalHeight += lineLayout->height;
-    }
-    return totalHeight;
+    return m_lineMetrics.totalHeight();
 }
 
 qreal LayoutEngine::getTotalDocumentWidth() const
 {
-    qreal maxWidth = 0;
-    for (const LineLayout* lineLayout : m_lineLayouts) {
-        maxWidth = qMax(maxWidth, lineLayout->width);
-    }
-    return maxWidth;
+    return m_lineMetrics.maxWidth();
+}
+
+int LayoutEngine::pendingWrapLineCount() const
+{
+    return isWrapActive() ? m_lineMetrics.estimatedLineCount() : 0;
 }
 
 // 调试支持
@@ -803,8 +1288,16 @@ QString LayoutEngine::getDebugInfo() const
     info << QString("  Tab width: %1 chars (%2 pixels)").arg(m_tabWidth).arg(tabWidth());
     info << QString("  Word wrap: %1").arg(m_wordWrap ? "enabled" : "disabled");
     info << QString("  Text width: %1").arg(m_textWidth);
-    info << QString("  Total lines: %1").arg(m_lineLayouts.size());
-    info << QString("  Cached layouts: %1").arg(getCachedLayoutCount());
+    info << QString("  Total lines: %1 (%2 metric chunks)")
+        .arg(m_lineMetrics.lineCount()).arg(m_lineMetrics.chunkCount());
+    info << QString("  Visible lines: %1").arg(m_lineMetrics.visibleLineCount());
+    info << QString("  Cached layouts: %1 / %2 (%3 / %4 KB)")
+        .arg(m_layoutCache.size()).arg(m_maxCachedLayouts)
+        .arg(m_cachedLayoutBytes / 1024).arg(m_maxCachedLayoutBytes / 1024);
+    info << QString("  Layout cache: %1 hits, %2 misses, %3 evictions")
+        .arg(m_layoutCacheHits).arg(m_layoutCacheMisses).arg(m_layoutEvictions);
+    info << QString("  Wrap estimates pending: %1 (%2 font)")
+        .arg(pendingWrapLineCount()).arg(m_monospace ? "monospace" : "proportional");
     info << QString("  Document size: %1 x %2").arg(getTotalDocumentWidth()).arg(getTotalDocumentHeight());
     info << QString("  Viewport: (%1, %2) %3x%4")
         .arg(m_viewport.rect.x()).arg(m_viewport.rect.y())
@@ -818,19 +1311,15 @@ QString LayoutEngine::getDebugInfo() const
 // 布局验证
 bool LayoutEngine::validateLayouts() const
 {
-    for (int i = 0; i < m_lineLayouts.size(); ++i) {
-        const LineLayout* lineLayout = m_lineLayouts[i];
+    if (!m_lineMetrics.validate())
+        return false;
 
-        if (lineLayout->lineNumber != i) {
+    for (auto it = m_layoutCache.constBegin(); it != m_layoutCache.constEnd(); ++it) {
+        if (it.value()->lineNumber != it.key() || it.key() >= m_lineMetrics.lineCount()) {
             qWarning() << "Layout validation failed: line number mismatch";
             return false;
         }
-
-        if (lineLayout->height <= 0) {
-            qWarning() << "Layout validation failed: invalid height";
-            return false;
-        }
     }
 
     return true;
-}
\ No newline at end of file
+}
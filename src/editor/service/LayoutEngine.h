@@ -9,17 +9,15 @@
 #include <QRectF>
 #include <QColor>
 #include <QStringList>
+#include <QHash>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <memory>
 #include "TokenTypes.h"
+#include "LineMetricsStore.h"
 
-struct LineLayout {
-    int lineNumber = 0;
-    QTextLayout* layout = nullptr;
-    qreal width = 0.0;
-    qreal height = 0.0;
-    bool visible = false;
-    bool dirty = true;
-    QList<Token> tokens; // 语法高亮tokens
-};
+class DocumentModel;
+class PieceTable;
 
 struct ViewportInfo {
     QRectF rect;
@@ -55,10 +53,17 @@ public:
     bool wordWrap() const;
 
     // 布局管理
+    // 关联文档后按需从文档读取行文本，不再保存全文副本；
+    // 文档变更后调用 updateText 传入同一变更
+    void setDocument(DocumentModel* document);
+    DocumentModel* document() const;
+
+    // 未关联文档时使用内部文本
     void setText(const QString& text);
     void updateText(int position, int removedLength, const QString& addedText);
 
-    LineLayout* getLineLayout(int lineNumber);
+    // 返回该行已塑形的布局（按需创建并放入缓存），指针在该行下次失效或被淘汰前有效
+    QTextLayout* getLineLayout(int lineNumber);
     void invalidateLineLayout(int lineNumber);
     void invalidateAllLayouts();
 
@@ -82,14 +87,29 @@ public:
     int logicalLineToVisualLine(int logicalLine) const;
     int visualLineToLogicalLine(int visualLine) const;
 
+    // 纵向定位（O(log n)）
+    qreal lineTop(int lineNumber) const;
+    int lineAtY(qreal y) const;
+
+    // 代码折叠：隐藏的行不占高度，视觉行和可见行的换算都跳过它们
+    void setLinesHidden(int firstLine, int count, bool hidden);
+    bool isLineHidden(int lineNumber) const;
+    bool hasHiddenLines() const;
+    int visibleLineCount() const;
+    int visibleLineIndex(int lineNumber) const;     // 该行之前的可见行数
+    int lineAtVisibleIndex(int index) const;
+
     // 高级功能
     qreal getLineRenderHeight(int lineNumber) const;
     qreal getLineRenderWidth(int lineNumber) const;
     void setMaxCachedLayouts(int maxLayouts);
+    void setMaxCachedLayoutBytes(qint64 maxBytes);
     void clearLayoutCache();
     int getCachedLayoutCount() const;
     qreal getTotalDocumentHeight() const;
     qreal getTotalDocumentWidth() const;
+    // 软换行时视觉行数仍为估算值、等待后台换行计算的行数
+    int pendingWrapLineCount() const;
     QString getDebugInfo() const;
     bool validateLayouts() const;
 
@@ -105,18 +125,105 @@ private:
     bool m_wordWrap = false;
     int m_tabWidth = 4;
 
-    QString m_text;
-    QList<LineLayout*> m_lineLayouts;
+    // 文本来源：关联的文档，或 setText 设置的内部文本
+    DocumentModel* m_document = nullptr;
+    std::unique_ptr<PieceTable> m_ownedText;
     ViewportInfo m_viewport;
 
+    // 每行的高度、宽度、视觉行数和脏标记（按块存放的结构数组，附带前缀和索引）
+    LineMetricsStore m_lineMetrics;
+
+    // 已塑形布局的 LRU 缓存：表头为最近使用，按数量和估算字节数双重限制，
+    // 视口内的行不会被淘汰。淘汰只释放 QTextLayout，行度量保留在 m_lineMetrics 中
+    static constexpr int DEFAULT_MAX_CACHED_LAYOUTS = 1000;
+    static constexpr qint64 DEFAULT_MAX_CACHED_LAYOUT_BYTES = 32 * 1024 * 1024;
+
+    struct CachedLayout {
+        int lineNumber = 0;
+        QTextLayout* layout = nullptr;
+        qint64 bytes = 0;  // 估算内存占用
+        CachedLayout* prev = nullptr;
+        CachedLayout* next = nullptr;
+    };
+
+    QHash<int, CachedLayout*> m_layoutCache;
+    CachedLayout* m_lruHead = nullptr;
+    CachedLayout* m_lruTail = nullptr;
+    qint64 m_cachedLayoutBytes = 0;
+    int m_maxCachedLayouts = DEFAULT_MAX_CACHED_LAYOUTS;
+    qint64 m_maxCachedLayoutBytes = DEFAULT_MAX_CACHED_LAYOUT_BYTES;
+
+    // 后台换行：未塑形行的视觉行数在线程池中按字体度量计算，按视口优先的顺序
+    // 分轮提交，每批结果到达后写入行度量，滚动条高度逐步收敛而不阻塞绘制
+    static constexpr int WRAP_BATCH_LINES = 512;
+    static constexpr int WRAP_LINES_PER_ROUND = 16 * WRAP_BATCH_LINES;
+
+    struct WrapJob {
+        quint64 generation = 0;
+        QList<int> lines;
+        QStringList texts;
+        QFont font;
+        qreal width = 0;
+        qreal tabStop = 0;
+        bool monospace = false;
+    };
+
+    struct WrapResult {
+        quint64 generation = 0;
+        QList<int> lines;
+        QList<int> visualLines;
+    };
+
+    QFutureWatcher<WrapResult>* m_wrapWatcher = nullptr;
+    QTimer m_wrapTimer;
+    quint64 m_wrapGeneration = 0;   // 文本或换行参数变化时递增，旧任务的结果被丢弃
+    bool m_wrapResultsApplied = false;
+    bool m_monospace = false;
+    qreal m_monospaceAdvance = 0;   // 等宽字体的精确字宽
+
+    quint64 m_layoutCacheHits = 0;
+    quint64 m_layoutCacheMisses = 0;
+    quint64 m_layoutEvictions = 0;
+
+    void attachLayout(int lineNumber, QTextLayout* layout);
+    void releaseLayout(int lineNumber);
+    void releaseAllLayouts();
+    void touchLayout(CachedLayout* entry);
+    void unlinkLayout(CachedLayout* entry);
+    void evictLayouts();
+    void shiftCachedLayouts(int fromLine, int delta);
+    const QTextLayout* cachedLayout(int lineNumber) const;
+    bool isLineInViewport(int lineNumber) const;
+
+    bool isWrapActive() const;
+    void scheduleWrapPass();
+    void startWrapPass();
+    void onWrapResultReady(int index);
+    void onWrapPassFinished();
+
+    // 等宽快速路径：行内只有单宽字符时，列、横坐标、制表符展开和换行点
+    // 都按字符列算术计算，不经过 QTextLayout 或逐字符的字体度量
+    bool isMonospaceLine(int lineNumber, const QString& text) const;
+    int wrapColumns() const;
+    QList<int> monospaceRowStarts(const QString& text) const;
+
+    // 纯函数，可在工作线程中调用
+    static WrapResult runWrapJob(const WrapJob& job);
+    static QList<int> monospaceRowStarts(const QString& text, int columns, int tabColumns);
+    static int monospaceColumn(const QString& text, int from, int to, int tabColumns);
+    static bool isComplexCharacter(QChar ch);
+    static bool containsComplexCharacters(const QString& text);
+    static int countWrappedRows(const QString& text, const QFontMetricsF& metrics,
+        qreal width, qreal tabStop, bool monospace);
+    static qint64 estimateLayoutBytes(const QTextLayout* layout);
+
     // 私有辅助方法
-    void createLineLayout(int lineNumber);
-    void updateLineLayout(LineLayout* layout);
-    void clearLineLayouts();
-    QStringList splitIntoLines(const QString& text) const;
+    QTextLayout* createLineLayout(int lineNumber);
+    void resetLines();
     void updateVisibleLines();
 
     // 文本处理辅助方法
+    int sourceLineCount() const;
     QString getLineText(int lineNumber) const;
     int positionToLine(int position) const;
     int positionToColumn(int position, int lineNumber) const;
@@ -0,0 +1,796 @@
+#include "LineMetricsStore.h"
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+LineMetricsStore::LineMetricsStore()
+{
+}
+
+LineMetricsStore::~LineMetricsStore()
+{
+}
+
+// ==============================================================================
+// 结构操作
+// ==============================================================================
+
+void LineMetricsStore::reset(int lineCount, qreal height)
+{
+    m_chunks.clear();
+    m_lineCount = qMax(0, lineCount);
+
+    // 每块一次分配
+    int remaining = m_lineCount;
+    while (remaining > 0) {
+        auto chunk = std::make_unique<Chunk>();
+        chunk->count = qMin(remaining, CHUNK_LINES);
+
+        std::fill_n(chunk->heights, chunk->count, float(height));
+        std::fill_n(chunk->widths, chunk->count, 0.0f);
+        std::fill_n(chunk->visualLines, chunk->count, 1);
+        std::fill_n(chunk->flags, chunk->count, NEW_LINE_FLAGS);
+
+        chunk->heightSum = height * chunk->count;
+        chunk->visualLineSum = chunk->count;
+        chunk->estimatedCount = chunk->count;
+        chunk->maxWidth = 0;
+
+        remaining -= chunk->count;
+        m_chunks.push_back(std::move(chunk));
+    }
+
+    m_indexDirty = true;
+}
+
+void LineMetricsStore::clear()
+{
+    m_chunks.clear();
+    m_lineCount = 0;
+    m_indexDirty = true;
+}
+
+void LineMetricsStore::insertLines(int line, int count, qreal height)
+{
+    if (count <= 0)
+        return;
+
+    if (m_chunks.empty()) {
+        reset(count, height);
+        return;
+    }
+
+    line = qBound(0, line, m_lineCount);
+
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    Chunk& chunk = *m_chunks[chunkIndex];
+
+    // 块内放得下时原地移动，否则连同新行一起重新切分
+    if (chunk.count + count > CHUNK_CAPACITY) {
+        splitInsert(chunkIndex, offset, count, height);
+        m_lineCount += count;
+        m_indexDirty = true;
+        return;
+    }
+
+    moveLines(chunk, offset, offset + count, chunk.count - offset);
+    std::fill_n(chunk.heights + offset, count, float(height));
+    std::fill_n(chunk.widths + offset, count, 0.0f);
+    std::fill_n(chunk.visualLines + offset, count, 1);
+    std::fill_n(chunk.flags + offset, count, NEW_LINE_FLAGS);
+
+    chunk.count += count;
+    chunk.heightSum += height * count;
+    chunk.visualLineSum += count;
+    chunk.estimatedCount += count;
+    m_lineCount += count;
+
+    if (!m_indexDirty) {
+        m_lineIndex.add(chunkIndex, count);
+        m_heightIndex.add(chunkIndex, height * count);
+        m_visualLineIndex.add(chunkIndex, count);
+        m_visibleLineIndex.add(chunkIndex, count);
+    }
+}
+
+void LineMetricsStore::removeLines(int line, int count)
+{
+    if (count <= 0 || line < 0 || line >= m_lineCount)
+        return;
+
+    count = qMin(count, m_lineCount - line);
+
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    int firstChunk = chunkIndex;
+
+    // 顺序处理受影响的块，不再逐块重新定位
+    int remaining = count;
+    while (remaining > 0 && chunkIndex < static_cast<int>(m_chunks.size())) {
+        Chunk& chunk = *m_chunks[chunkIndex];
+        int removed = qMin(remaining, chunk.count - offset);
+
+        moveLines(chunk, offset + removed, offset, chunk.count - offset - removed);
+        chunk.count -= removed;
+        remaining -= removed;
+        m_lineCount -= removed;
+
+        if (chunk.count == 0) {
+            m_chunks.erase(m_chunks.begin() + chunkIndex);
+        }
+        else {
+            recomputeChunk(chunk);
+            chunkIndex++;
+        }
+
+        offset = 0;
+    }
+
+    mergeSmallChunks(qMax(0, firstChunk - 1));
+    m_indexDirty = true;
+}
+
+// ==============================================================================
+// 单行访问
+// ==============================================================================
+
+qreal LineMetricsStore::height(int line) const
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0)
+        return 0;
+
+    return m_chunks[chunkIndex]->heights[offset];
+}
+
+qreal LineMetricsStore::width(int line) const
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0)
+        return 0;
+
+    return m_chunks[chunkIndex]->widths[offset];
+}
+
+int LineMetricsStore::visualLines(int line) const
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0)
+        return 1;
+
+    return m_chunks[chunkIndex]->visualLines[offset];
+}
+
+bool LineMetricsStore::isDirty(int line) const
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0)
+        return true;
+
+    return m_chunks[chunkIndex]->flags[offset] & Dirty;
+}
+
+bool LineMetricsStore::isEstimated(int line) const
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0)
+        return false;
+
+    return m_chunks[chunkIndex]->flags[offset] & Estimated;
+}
+
+bool LineMetricsStore::isClassified(int line) const
+{
+    return lineFlags(line) & Classified;
+}
+
+bool LineMetricsStore::isComplex(int line) const
+{
+    return lineFlags(line) & Complex;
+}
+
+bool LineMetricsStore::isHidden(int line) const
+{
+    return lineFlags(line) & Hidden;
+}
+
+void LineMetricsStore::setMetrics(int line, qreal height, int visualLines, qreal width)
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0)
+        return;
+
+    Chunk& chunk = *m_chunks[chunkIndex];
+
+    qreal heightDelta = float(height) - chunk.heights[offset];
+    int visualLineDelta = visualLines - chunk.visualLines[offset];
+    float oldWidth = chunk.widths[offset];
+
+    chunk.heights[offset] = float(height);
+    chunk.visualLines[offset] = visualLines;
+    chunk.widths[offset] = float(width);
+
+    if (chunk.flags[offset] & Estimated) {
+        chunk.estimatedCount--;
+    }
+    chunk.flags[offset] &= ~(Dirty | Estimated);
+
+    // 隐藏行的度量照常更新，但不计入汇总
+    if (chunk.flags[offset] & Hidden) {
+        heightDelta = 0;
+        visualLineDelta = 0;
+    }
+
+    chunk.heightSum += heightDelta;
+    chunk.visualLineSum += visualLineDelta;
+
+    if (width >= chunk.maxWidth) {
+        chunk.maxWidth = float(width);
+    }
+    else if (oldWidth >= chunk.maxWidth) {
+        // 原来的最宽行变窄，重新扫描本块
+        chunk.maxWidth = *std::max_element(chunk.widths, chunk.widths + chunk.count);
+    }
+
+    if (!m_indexDirty) {
+        m_heightIndex.add(chunkIndex, heightDelta);
+        m_visualLineIndex.add(chunkIndex, visualLineDelta);
+    }
+}
+
+void LineMetricsStore::setEstimatedVisualLines(int line, int visualLines, qreal lineHeight)
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0)
+        return;
+
+    Chunk& chunk = *m_chunks[chunkIndex];
+
+    // 已经塑形的行度量是精确的，不用估算覆盖
+    if (!(chunk.flags[offset] & Estimated))
+        return;
+
+    visualLines = qMax(1, visualLines);
+    qreal heightDelta = float(lineHeight * visualLines) - chunk.heights[offset];
+    int visualLineDelta = visualLines - chunk.visualLines[offset];
+
+    chunk.heights[offset] = float(lineHeight * visualLines);
+    chunk.visualLines[offset] = visualLines;
+    chunk.flags[offset] &= ~Estimated;
+
+    if (chunk.flags[offset] & Hidden) {
+        heightDelta = 0;
+        visualLineDelta = 0;
+    }
+
+    chunk.heightSum += heightDelta;
+    chunk.visualLineSum += visualLineDelta;
+    chunk.estimatedCount--;
+
+    if (!m_indexDirty) {
+        m_heightIndex.add(chunkIndex, heightDelta);
+        m_visualLineIndex.add(chunkIndex, visualLineDelta);
+    }
+}
+
+void LineMetricsStore::setDirty(int line)
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0)
+        return;
+
+    Chunk& chunk = *m_chunks[chunkIndex];
+    if (!(chunk.flags[offset] & Estimated)) {
+        chunk.estimatedCount++;
+    }
+    chunk.flags[offset] |= Dirty | Estimated;
+    chunk.flags[offset] &= ~(Classified | Complex);
+}
+
+void LineMetricsStore::setComplex(int line, bool complex)
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0)
+        return;
+
+    quint8& flags = m_chunks[chunkIndex]->flags[offset];
+    flags = quint8((flags & ~Complex) | Classified | (complex ? Complex : 0));
+}
+
+void LineMetricsStore::setHidden(int first, int count, bool hidden)
+{
+    if (count <= 0 || first < 0 || first >= m_lineCount)
+        return;
+
+    count = qMin(count, m_lineCount - first);
+
+    int offset = 0;
+    int chunkIndex = locate(first, &offset);
+
+    // 顺序处理受影响的块，每块改完标记后重算一次汇总
+    int remaining = count;
+    while (remaining > 0 && chunkIndex < static_cast<int>(m_chunks.size())) {
+        Chunk& chunk = *m_chunks[chunkIndex];
+        int end = qMin(chunk.count, offset + remaining);
+
+        for (int i = offset; i < end; ++i) {
+            if (hidden) {
+                chunk.flags[i] |= Hidden;
+            }
+            else {
+                chunk.flags[i] &= ~Hidden;
+            }
+        }
+        recomputeChunk(chunk);
+
+        remaining -= end - offset;
+        offset = 0;
+        chunkIndex++;
+    }
+
+    m_indexDirty = true;
+}
+
+void LineMetricsStore::resetAll(qreal lineHeight, bool keepVisualLines)
+{
+    for (auto& chunkPtr : m_chunks) {
+        Chunk& chunk = *chunkPtr;
+
+        if (!keepVisualLines) {
+            std::fill_n(chunk.visualLines, chunk.count, 1);
+        }
+
+        for (int i = 0; i < chunk.count; ++i) {
+            chunk.heights[i] = float(lineHeight * chunk.visualLines[i]);
+            chunk.flags[i] |= Dirty | Estimated;
+        }
+
+        recomputeChunk(chunk);
+    }
+
+    m_indexDirty = true;
+}
+
+// ==============================================================================
+// 汇总与定位
+// ==============================================================================
+
+qreal LineMetricsStore::totalHeight() const
+{
+    ensureIndex();
+    return m_heightIndex.total();
+}
+
+int LineMetricsStore::totalVisualLines() const
+{
+    ensureIndex();
+    return m_visualLineIndex.total();
+}
+
+qreal LineMetricsStore::maxWidth() const
+{
+    float result = 0;
+    for (const auto& chunk : m_chunks) {
+        result = qMax(result, chunk->maxWidth);
+    }
+    return result;
+}
+
+int LineMetricsStore::estimatedLineCount() const
+{
+    int result = 0;
+    for (const auto& chunk : m_chunks) {
+        result += chunk->estimatedCount;
+    }
+    return result;
+}
+
+qreal LineMetricsStore::heightBefore(int line) const
+{
+    if (line <= 0 || m_chunks.empty())
+        return 0;
+
+    line = qMin(line, m_lineCount);
+
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    const Chunk& chunk = *m_chunks[chunkIndex];
+
+    qreal result = m_heightIndex.prefixSum(chunkIndex);
+    for (int i = 0; i < offset; ++i) {
+        if (!(chunk.flags[i] & Hidden)) {
+            result += chunk.heights[i];
+        }
+    }
+    return result;
+}
+
+int LineMetricsStore::visualLinesBefore(int line) const
+{
+    if (line <= 0 || m_chunks.empty())
+        return 0;
+
+    line = qMin(line, m_lineCount);
+
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    const Chunk& chunk = *m_chunks[chunkIndex];
+
+    int result = m_visualLineIndex.prefixSum(chunkIndex);
+    for (int i = 0; i < offset; ++i) {
+        if (!(chunk.flags[i] & Hidden)) {
+            result += chunk.visualLines[i];
+        }
+    }
+    return result;
+}
+
+int LineMetricsStore::lineAtHeight(qreal y) const
+{
+    if (m_chunks.empty())
+        return 0;
+
+    ensureIndex();
+
+    y = qMax(qreal(0), y);
+
+    int chunkIndex = m_heightIndex.findIndex(y);
+    const Chunk& chunk = *m_chunks[chunkIndex];
+    int firstLine = m_lineIndex.prefixSum(chunkIndex);
+    qreal remaining = y - m_heightIndex.prefixSum(chunkIndex);
+
+    int last = chunk.count - 1;
+    for (int i = 0; i < chunk.count; ++i) {
+        if (chunk.flags[i] & Hidden)
+            continue;
+        if (remaining < chunk.heights[i])
+            return firstLine + i;
+        remaining -= chunk.heights[i];
+        last = i;
+    }
+
+    return firstLine + last;
+}
+
+int LineMetricsStore::lineAtVisualLine(int visualLine) const
+{
+    if (m_chunks.empty())
+        return 0;
+
+    ensureIndex();
+
+    visualLine = qMax(0, visualLine);
+
+    int chunkIndex = m_visualLineIndex.findIndex(visualLine);
+    const Chunk& chunk = *m_chunks[chunkIndex];
+    int firstLine = m_lineIndex.prefixSum(chunkIndex);
+    int remaining = visualLine - m_visualLineIndex.prefixSum(chunkIndex);
+
+    int last = chunk.count - 1;
+    for (int i = 0; i < chunk.count; ++i) {
+        if (chunk.flags[i] & Hidden)
+            continue;
+        if (remaining < chunk.visualLines[i])
+            return firstLine + i;
+        remaining -= chunk.visualLines[i];
+        last = i;
+    }
+
+    return firstLine + last;
+}
+
+bool LineMetricsStore::hasHiddenLines() const
+{
+    return visibleLineCount() < m_lineCount;
+}
+
+int LineMetricsStore::visibleLineCount() const
+{
+    ensureIndex();
+    return m_visibleLineIndex.total();
+}
+
+int LineMetricsStore::visibleLinesBefore(int line) const
+{
+    if (line <= 0 || m_chunks.empty())
+        return 0;
+
+    line = qMin(line, m_lineCount);
+
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    const Chunk& chunk = *m_chunks[chunkIndex];
+
+    int result = m_visibleLineIndex.prefixSum(chunkIndex);
+    if (chunk.hiddenCount == 0)
+        return result + offset;
+
+    for (int i = 0; i < offset; ++i) {
+        if (!(chunk.flags[i] & Hidden)) {
+            result++;
+        }
+    }
+    return result;
+}
+
+int LineMetricsStore::lineAtVisibleIndex(int index) const
+{
+    if (m_chunks.empty())
+        return 0;
+
+    ensureIndex();
+
+    // 开头的行被隐藏时，序号 0 对应第一个可见行
+    index = qMax(0, index);
+
+    int chunkIndex = m_visibleLineIndex.findIndex(index);
+    const Chunk& chunk = *m_chunks[chunkIndex];
+    int firstLine = m_lineIndex.prefixSum(chunkIndex);
+    int remaining = index - m_visibleLineIndex.prefixSum(chunkIndex);
+
+    if (chunk.hiddenCount == 0)
+        return firstLine + qMin(remaining, chunk.count - 1);
+
+    int last = chunk.count - 1;
+    for (int i = 0; i < chunk.count; ++i) {
+        if (chunk.flags[i] & Hidden)
+            continue;
+        if (remaining == 0)
+            return firstLine + i;
+        remaining--;
+        last = i;
+    }
+
+    return firstLine + last;
+}
+
+int LineMetricsStore::nextEstimatedLine(int line) const
+{
+    line = qMax(0, line);
+    if (line >= m_lineCount)
+        return -1;
+
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0)
+        return -1;
+
+    int firstLine = line - offset;
+    for (; chunkIndex < static_cast<int>(m_chunks.size()); ++chunkIndex) {
+        const Chunk& chunk = *m_chunks[chunkIndex];
+
+        if (chunk.estimatedCount > 0) {
+            for (int i = offset; i < chunk.count; ++i) {
+                if (chunk.flags[i] & Estimated)
+                    return firstLine + i;
+            }
+        }
+
+        firstLine += chunk.count;
+        offset = 0;
+    }
+
+    return -1;
+}
+
+bool LineMetricsStore::validate() const
+{
+    int lines = 0;
+
+    for (const auto& chunkPtr : m_chunks) {
+        const Chunk& chunk = *chunkPtr;
+
+        if (chunk.count <= 0 || chunk.count > CHUNK_CAPACITY) {
+            qWarning() << "LineMetricsStore validation failed: invalid chunk size" << chunk.count;
+            return false;
+        }
+
+        int estimated = 0;
+        int hidden = 0;
+        for (int i = 0; i < chunk.count; ++i) {
+            if (chunk.heights[i] <= 0) {
+                qWarning() << "LineMetricsStore validation failed: invalid height";
+                return false;
+            }
+            if (chunk.flags[i] & Estimated) {
+                estimated++;
+            }
+            if (chunk.flags[i] & Hidden) {
+                hidden++;
+            }
+        }
+
+        if (estimated != chunk.estimatedCount) {
+            qWarning() << "LineMetricsStore validation failed: estimated line count mismatch";
+            return false;
+        }
+
+        if (hidden != chunk.hiddenCount) {
+            qWarning() << "LineMetricsStore validation failed: hidden line count mismatch";
+            return false;
+        }
+
+        lines += chunk.count;
+    }
+
+    if (lines != m_lineCount) {
+        qWarning() << "LineMetricsStore validation failed: line count mismatch";
+        return false;
+    }
+
+    return true;
+}
+
+// ==============================================================================
+// 私有辅助方法
+// ==============================================================================
+
+void LineMetricsStore::ensureIndex() const
+{
+    if (!m_indexDirty)
+        return;
+
+    QList<int> lineCounts;
+    QList<qreal> heights;
+    QList<int> visualLines;
+    QList<int> visibleLines;
+    lineCounts.reserve(static_cast<qsizetype>(m_chunks.size()));
+    heights.reserve(static_cast<qsizetype>(m_chunks.size()));
+    visualLines.reserve(static_cast<qsizetype>(m_chunks.size()));
+    visibleLines.reserve(static_cast<qsizetype>(m_chunks.size()));
+
+    for (const auto& chunk : m_chunks) {
+        lineCounts.append(chunk->count);
+        heights.append(chunk->heightSum);
+        visualLines.append(chunk->visualLineSum);
+        visibleLines.append(chunk->count - chunk->hiddenCount);
+    }
+
+    m_lineIndex.build(lineCounts);
+    m_heightIndex.build(heights);
+    m_visualLineIndex.build(visualLines);
+    m_visibleLineIndex.build(visibleLines);
+    m_indexDirty = false;
+}
+
+int LineMetricsStore::locate(int line, int* offset) const
+{
+    *offset = 0;
+    if (m_chunks.empty() || line < 0 || line > m_lineCount)
+        return -1;
+
+    ensureIndex();
+
+    // line == m_lineCount 时定位到最后一块的末尾，用于追加
+    int chunkIndex = m_lineIndex.findIndex(line);
+    *offset = line - m_lineIndex.prefixSum(chunkIndex);
+
+    if (line < m_lineCount && *offset >= m_chunks[chunkIndex]->count)
+        return -1;
+
+    return chunkIndex;
+}
+
+quint8 LineMetricsStore::lineFlags(int line) const
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0 || line >= m_lineCount)
+        return 0;
+
+    return m_chunks[chunkIndex]->flags[offset];
+}
+
+void LineMetricsStore::splitInsert(int chunkIndex, int offset, int count, qreal height)
+{
+    const Chunk& source = *m_chunks[chunkIndex];
+
+    // 原块前半部分、新行、原块后半部分依次写入新块，每块写满目标行数
+    std::vector<std::unique_ptr<Chunk>> pieces;
+    auto target = [&]() -> Chunk& {
+        if (pieces.empty() || pieces.back()->count == CHUNK_LINES) {
+            pieces.push_back(std::make_unique<Chunk>());
+        }
+        return *pieces.back();
+    };
+
+    auto copyFromSource = [&](int from, int to) {
+        for (int i = from; i < to; ++i) {
+            Chunk& chunk = target();
+            int index = chunk.count++;
+            chunk.heights[index] = source.heights[i];
+            chunk.widths[index] = source.widths[i];
+            chunk.visualLines[index] = source.visualLines[i];
+            chunk.flags[index] = source.flags[i];
+        }
+    };
+
+    copyFromSource(0, offset);
+
+    for (int i = 0; i < count; ++i) {
+        Chunk& chunk = target();
+        int index = chunk.count++;
+        chunk.heights[index] = float(height);
+        chunk.widths[index] = 0;
+        chunk.visualLines[index] = 1;
+        chunk.flags[index] = NEW_LINE_FLAGS;
+    }
+
+    copyFromSource(offset, source.count);
+
+    for (auto& piece : pieces) {
+        recomputeChunk(*piece);
+    }
+
+    m_chunks.erase(m_chunks.begin() + chunkIndex);
+    m_chunks.insert(m_chunks.begin() + chunkIndex,
+        std::make_move_iterator(pieces.begin()), std::make_move_iterator(pieces.end()));
+}
+
+void LineMetricsStore::mergeSmallChunks(int chunkIndex)
+{
+    // 检查删除位置附近的块，过小的块并入相邻块
+    int end = qMin(chunkIndex + 2, static_cast<int>(m_chunks.size()) - 1);
+
+    for (int i = end; i > chunkIndex && i > 0; --i) {
+        Chunk& previous = *m_chunks[i - 1];
+        Chunk& current = *m_chunks[i];
+
+        bool tooSmall = previous.count < CHUNK_LINES / 4 || current.count < CHUNK_LINES / 4;
+        if (!tooSmall || previous.count + current.count > CHUNK_CAPACITY)
+            continue;
+
+        std::memcpy(previous.heights + previous.count, current.heights, current.count * sizeof(float));
+        std::memcpy(previous.widths + previous.count, current.widths, current.count * sizeof(float));
+        std::memcpy(previous.visualLines + previous.count, current.visualLines, current.count * sizeof(qint32));
+        std::memcpy(previous.flags + previous.count, current.flags, current.count * sizeof(quint8));
+        previous.count += current.count;
+        recomputeChunk(previous);
+
+        m_chunks.erase(m_chunks.begin() + i);
+    }
+}
+
+void LineMetricsStore::recomputeChunk(Chunk& chunk)
+{
+    chunk.heightSum = 0;
+    chunk.visualLineSum = 0;
+    chunk.estimatedCount = 0;
+    chunk.hiddenCount = 0;
+    chunk.maxWidth = 0;
+
+    for (int i = 0; i < chunk.count; ++i) {
+        if (chunk.flags[i] & Estimated) {
+            chunk.estimatedCount++;
+        }
+        if (chunk.flags[i] & Hidden) {
+            chunk.hiddenCount++;
+        }
+        else {
+            chunk.heightSum += chunk.heights[i];
+            chunk.visualLineSum += chunk.visualLines[i];
+        }
+        chunk.maxWidth = qMax(chunk.maxWidth, chunk.widths[i]);
+    }
+}
+
+void LineMetricsStore::moveLines(Chunk& chunk, int from, int to, int count)
+{
+    if (count <= 0 || from == to)
+        return;
+
+    std::memmove(chunk.heights + to, chunk.heights + from, count * sizeof(float));
+    std::memmove(chunk.widths + to, chunk.widths + from, count * sizeof(float));
+    std::memmove(chunk.visualLines + to, chunk.visualLines + from, count * sizeof(qint32));
+    std::memmove(chunk.flags + to, chunk.flags + from, count * sizeof(quint8));
+}
@@ -0,0 +1,124 @@
+#ifndef LINE_METRICS_STORE_H
+#define LINE_METRICS_STORE_H
+
+#include "FenwickTree.h"
+#include <QtGlobal>
+#include <memory>
+#include <vector>
+
+// 行度量存储
+// 每行的高度、宽度、视觉行数和状态位按块存放在连续的定长数组中（结构数组），
+// 每块一次分配；块级的行数、高度和视觉行数由树状数组索引，
+// 定位某行或按纵坐标查找行为 O(log 块数 + 块大小)。
+// 折叠隐藏的行保留自身度量，但不计入高度、视觉行数和可见行的汇总
+class LineMetricsStore {
+public:
+    enum Flag : quint8 {
+        Dirty = 0x01,       // 度量需要重新计算
+        Estimated = 0x02,   // 视觉行数为估算值，尚未经换行计算或塑形确定
+        Classified = 0x04,  // 已检查行内字符，Complex 位有效
+        Complex = 0x08,     // 含宽字符、组合字符或从右到左文字，坐标换算需要塑形
+        Hidden = 0x10       // 位于折叠区域内，不参与布局
+    };
+
+    static constexpr int CHUNK_LINES = 1024;            // 重新切分时每块的目标行数
+    static constexpr int CHUNK_CAPACITY = 2 * CHUNK_LINES;
+
+    LineMetricsStore();
+    ~LineMetricsStore();
+
+    LineMetricsStore(const LineMetricsStore&) = delete;
+    LineMetricsStore& operator=(const LineMetricsStore&) = delete;
+
+    // 结构操作
+    void reset(int lineCount, qreal height);
+    void clear();
+    void insertLines(int line, int count, qreal height);
+    void removeLines(int line, int count);
+
+    // 单行访问
+    int lineCount() const { return m_lineCount; }
+    qreal height(int line) const;
+    qreal width(int line) const;
+    int visualLines(int line) const;
+    bool isDirty(int line) const;
+    bool isEstimated(int line) const;
+    bool isClassified(int line) const;
+    bool isComplex(int line) const;
+    bool isHidden(int line) const;
+
+    // 塑形得到的精确度量，清除全部状态位
+    void setMetrics(int line, qreal height, int visualLines, qreal width);
+    // 换行计算得到的视觉行数：只更新仍为估算状态的行，保留脏标记
+    void setEstimatedVisualLines(int line, int visualLines, qreal lineHeight);
+    // 行内容变化：度量、视觉行数和字符分类都需要重新确定
+    void setDirty(int line);
+    void setComplex(int line, bool complex);
+    // 折叠/展开 [first, first + count) 行；只重算涉及的块，O(count + 块数)
+    void setHidden(int first, int count, bool hidden);
+
+    // 全部标记为脏；行高按 lineHeight 乘以视觉行数估算
+    void resetAll(qreal lineHeight, bool keepVisualLines);
+
+    // 汇总与定位
+    qreal totalHeight() const;
+    int totalVisualLines() const;
+    qreal maxWidth() const;
+    int estimatedLineCount() const;
+
+    qreal heightBefore(int line) const;
+    int visualLinesBefore(int line) const;
+    int lineAtHeight(qreal y) const;
+    int lineAtVisualLine(int visualLine) const;
+
+    // 可见行（未隐藏的行）的序号与行号互相换算
+    bool hasHiddenLines() const;
+    int visibleLineCount() const;
+    int visibleLinesBefore(int line) const;
+    int lineAtVisibleIndex(int index) const;
+
+    // 从 line 开始（含）的第一个估算状态的行，没有时返回 -1；跳过没有估算行的块
+    int nextEstimatedLine(int line) const;
+
+    // 调试
+    int chunkCount() const { return static_cast<int>(m_chunks.size()); }
+    bool validate() const;
+
+private:
+    static constexpr quint8 NEW_LINE_FLAGS = Dirty | Estimated;
+
+    struct Chunk {
+        int count = 0;
+        qreal heightSum = 0;
+        int visualLineSum = 0;
+        int estimatedCount = 0;
+        int hiddenCount = 0;
+        float maxWidth = 0;
+
+        float heights[CHUNK_CAPACITY];
+        float widths[CHUNK_CAPACITY];
+        qint32 visualLines[CHUNK_CAPACITY];
+        quint8 flags[CHUNK_CAPACITY];
+    };
+
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    int m_lineCount = 0;
+
+    // 块级索引：结构变化后惰性重建（O(块数)），单行更新时 O(log 块数)
+    mutable FenwickTree<int> m_lineIndex;
+    mutable FenwickTree<qreal> m_heightIndex;
+    mutable FenwickTree<int> m_visualLineIndex;
+    mutable FenwickTree<int> m_visibleLineIndex;
+    mutable bool m_indexDirty = true;
+
+    void ensureIndex() const;
+    int locate(int line, int* offset) const;
+    quint8 lineFlags(int line) const;
+    void splitInsert(int chunkIndex, int offset, int count, qreal height);
+    void mergeSmallChunks(int chunkIndex);
+
+    static void recomputeChunk(Chunk& chunk);
+    static void moveLines(Chunk& chunk, int from, int to, int count);
+};
+
+#endif // LINE_METRICS_STORE_H
@@ -0,0 +1,701 @@
+#include "SemanticTokenClient.h"
+#include "SyntaxHighlighter.h"
+#include "../core/DocumentModel.h"
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QStringList>
+#include <QUrl>
+#include <memory>
+
+SemanticTokenClient::SemanticTokenClient(SyntaxHighlighter* highlighter, QObject* parent)
+    : QObject(parent)
+    , m_highlighter(highlighter)
+{
+    m_requestTimer.setSingleShot(true);
+    m_requestTimer.setInterval(REQUEST_DELAY_MS);
+    connect(&m_requestTimer, &QTimer::timeout, this, &SemanticTokenClient::requestTokens);
+
+    // 换语言时高亮器清空了叠加层，文档未变也要重新请求
+    if (m_highlighter) {
+        connect(m_highlighter, &SyntaxHighlighter::languageChanged,
+            this, [this]() { scheduleRequest(); });
+    }
+}
+
+SemanticTokenClient::~SemanticTokenClient()
+{
+    stop();
+}
+
+// ==============================================================================
+// 进程管理
+// ==============================================================================
+
+void SemanticTokenClient::start(const QString& program, const QStringList& arguments)
+{
+    stop();
+
+    if (program.isEmpty()) {
+        emit serverError(QStringLiteral("No semantic token server specified"));
+        return;
+    }
+
+    m_process = new QProcess(this);
+    m_process->setProgram(program);
+    m_process->setArguments(arguments);
+
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &SemanticTokenClient::onReadyRead);
+    connect(m_process, &QProcess::started, this, &SemanticTokenClient::sendInitialize);
+
+    // 进程自行退出（崩溃或启动失败）：清除叠加层，回到纯词法高亮
+    connect(m_process, &QProcess::finished, this, [this]() {
+        m_process->deleteLater();
+        m_process = nullptr;
+        resetState();
+        emit serverStopped();
+    });
+    connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (!m_process)
+            return;
+
+        emit serverError(m_process->errorString());
+
+        // 启动失败不会再有 finished 信号
+        if (error == QProcess::FailedToStart) {
+            m_process->deleteLater();
+            m_process = nullptr;
+            resetState();
+            emit serverStopped();
+        }
+    });
+
+    m_process->start();
+}
+
+void SemanticTokenClient::sendInitialize()
+{
+    QJsonObject semanticTokens;
+    semanticTokens["requests"] = QJsonObject{ { "full", true } };
+    semanticTokens["tokenTypes"] = QJsonArray{
+        "namespace", "type", "class", "enum", "interface", "struct", "typeParameter",
+        "parameter", "variable", "property", "enumMember", "function", "method",
+        "macro", "keyword", "modifier", "comment", "string", "number", "regexp", "operator" };
+    semanticTokens["tokenModifiers"] = QJsonArray();
+    semanticTokens["formats"] = QJsonArray{ "relative" };
+
+    QJsonObject capabilities;
+    capabilities["textDocument"] = QJsonObject{ { "semanticTokens", semanticTokens } };
+    capabilities["general"] = QJsonObject{ { "positionEncodings", QJsonArray{ "utf-16" } } };
+
+    QJsonObject params;
+    params["processId"] = static_cast<qint64>(QCoreApplication::applicationPid());
+    params["rootUri"] = QJsonValue::Null;
+    params["capabilities"] = capabilities;
+
+    sendRequest(QStringLiteral("initialize"), params);
+    emit serverStarted();
+}
+
+void SemanticTokenClient::stop()
+{
+    if (!m_process)
+        return;
+
+    closeDocument();
+
+    // 不等待退出：进程与本对象分离，自行退出后释放，超时则结束进程
+    QProcess* process = m_process;
+    m_process = nullptr;
+    disconnect(process, nullptr, this, nullptr);
+    process->setParent(nullptr);
+
+    if (process->state() == QProcess::NotRunning) {
+        process->deleteLater();
+    }
+    else {
+        connect(process, &QProcess::finished, process, &QObject::deleteLater);
+        QTimer::singleShot(STOP_TIMEOUT_MS, process, [process]() { process->kill(); });
+
+        if (m_initialized) {
+            // exit 必须在 shutdown 的应答之后发送：分离后的进程只等待这一条应答，其余消息丢弃
+            const int shutdownId = m_nextRequestId++;
+            writeMessage(process, QJsonObject{
+                { "jsonrpc", "2.0" }, { "id", shutdownId }, { "method", "shutdown" } });
+
+            auto buffer = std::make_shared<QByteArray>(m_buffer);
+            connect(process, &QProcess::readyReadStandardOutput, process, [process, buffer, shutdownId]() {
+                buffer->append(process->readAllStandardOutput());
+
+                QJsonObject message;
+                QString error;
+                while (takeMessage(*buffer, &message, &error)) {
+                    if (error.isEmpty() && !message.contains("method") &&
+                        message.value("id").toInt() == shutdownId) {
+                        writeMessage(process, QJsonObject{ { "jsonrpc", "2.0" }, { "method", "exit" } });
+                        process->closeWriteChannel();
+                        return;
+                    }
+                }
+            });
+        }
+        else {
+            process->closeWriteChannel();
+        }
+    }
+
+    resetState();
+    emit serverStopped();
+}
+
+bool SemanticTokenClient::isRunning() const
+{
+    return m_process && m_process->state() != QProcess::NotRunning;
+}
+
+void SemanticTokenClient::resetState()
+{
+    m_requestTimer.stop();
+    m_buffer.clear();
+    m_pendingRequests.clear();
+    m_legend.clear();
+    m_initialized = false;
+    m_documentOpen = false;
+    m_syncedVersion = -1;
+    m_tokensRequestId = -1;
+    m_requestedVersion = -1;
+    m_incrementalSync = false;
+    m_serverLines = LineIndex();
+    m_pendingChanges = QJsonArray();
+    m_fullSyncPending = false;
+    m_editsSinceRequest.clear();
+
+    if (m_highlighter) {
+        m_highlighter->clearSemanticTokens();
+    }
+}
+
+// ==============================================================================
+// 文档同步
+// ==============================================================================
+
+void SemanticTokenClient::setDocument(DocumentModel* document)
+{
+    if (m_document == document)
+        return;
+
+    if (m_document) {
+        disconnect(m_document, nullptr, this, nullptr);
+        closeDocument();
+    }
+
+    m_document = document;
+    m_version++;
+
+    if (m_document) {
+        connect(m_document, &DocumentModel::textChanged, this, &SemanticTokenClient::onTextChanged);
+        // 文档的 URI 随文件路径变化，以新的 URI 重新打开
+        connect(m_document, &DocumentModel::filePathChanged, this, [this]() {
+            closeDocument();
+            openDocument();
+        });
+        openDocument();
+    }
+}
+
+void SemanticTokenClient::setLanguageId(const QString& languageId)
+{
+    if (m_languageId == languageId)
+        return;
+
+    m_languageId = languageId;
+
+    // languageId 只能在打开文档时告知分析器
+    if (m_documentOpen) {
+        closeDocument();
+        openDocument();
+    }
+}
+
+void SemanticTokenClient::openDocument()
+{
+    if (!m_initialized || !m_document || m_documentOpen)
+        return;
+
+    const QString filePath = m_document->filePath();
+    m_documentUri = filePath.isEmpty()
+        ? QStringLiteral("untitled:Untitled-%1").arg(reinterpret_cast<quintptr>(m_document.data()))
+        : QUrl::fromLocalFile(QFileInfo(filePath).absoluteFilePath()).toString();
+
+    QJsonObject textDocument;
+    textDocument["uri"] = m_documentUri;
+    textDocument["languageId"] = languageId();
+    textDocument["version"] = m_version;
+
+    // 打开时发送一次全文，之后只发送变更
+    const QString text = m_document->getFullText();
+    textDocument["text"] = text;
+    m_serverLines.build(text);
+    m_pendingChanges = QJsonArray();
+    m_fullSyncPending = false;
+
+    sendNotification(QStringLiteral("textDocument/didOpen"), QJsonObject{ { "textDocument", textDocument } });
+    m_documentOpen = true;
+    m_syncedVersion = m_version;
+
+    requestTokens();
+}
+
+void SemanticTokenClient::closeDocument()
+{
+    if (!m_documentOpen)
+        return;
+
+    sendNotification(QStringLiteral("textDocument/didClose"),
+        QJsonObject{ { "textDocument", QJsonObject{ { "uri", m_documentUri } } } });
+    m_documentOpen = false;
+    m_syncedVersion = -1;
+    m_tokensRequestId = -1;
+    m_requestTimer.stop();
+    m_serverLines = LineIndex();
+    m_pendingChanges = QJsonArray();
+    m_editsSinceRequest.clear();
+
+    if (m_highlighter) {
+        m_highlighter->clearSemanticTokens();
+    }
+}
+
+void SemanticTokenClient::onTextChanged(const TextChange& change)
+{
+    m_version++;
+
+    if (m_documentOpen) {
+        // 按编辑前的文本换算行列：分析器依次应用 contentChanges，每条的范围都相对于前一条之后的文本
+        const int end = change.position + change.removedLength;
+        const int startLine = m_serverLines.lineAt(change.position);
+        const int endLine = m_serverLines.lineAt(end);
+
+        if (m_incrementalSync && !m_fullSyncPending) {
+            if (m_pendingChanges.size() >= MAX_PENDING_CHANGES) {
+                m_pendingChanges = QJsonArray();
+                m_fullSyncPending = true;
+            }
+            else {
+                auto position = [](int line, int character) {
+                    return QJsonObject{ { "line", line }, { "character", character } };
+                };
+
+                QJsonObject range;
+                range["start"] = position(startLine, change.position - m_serverLines.lineStart(startLine));
+                range["end"] = position(endLine, end - m_serverLines.lineStart(endLine));
+                m_pendingChanges.append(QJsonObject{ { "range", range }, { "text", change.insertedText } });
+            }
+        }
+
+        m_serverLines.remove(change.position, change.removedLength);
+        m_serverLines.insert(change.position, change.insertedText);
+
+        // 请求进行中：记下行的变化，结果返回时据此映射
+        if (m_tokensRequestId >= 0) {
+            const int addedLines = static_cast<int>(change.insertedText.count(QLatin1Char('\n')));
+            m_editsSinceRequest.append(LineEdit{ startLine, endLine - startLine, addedLines });
+        }
+    }
+
+    scheduleRequest();
+}
+
+void SemanticTokenClient::scheduleRequest()
+{
+    if (m_documentOpen) {
+        m_requestTimer.start();
+    }
+}
+
+void SemanticTokenClient::requestTokens()
+{
+    // 上一个请求还未返回时等待，返回后按版本决定是否重新请求
+    if (!m_documentOpen || m_tokensRequestId >= 0)
+        return;
+
+    // 防抖期间的多次编辑合并为一次同步，按发生顺序发送各条变更
+    if (m_syncedVersion != m_version) {
+        QJsonObject params;
+        params["textDocument"] = QJsonObject{ { "uri", m_documentUri }, { "version", m_version } };
+        if (m_incrementalSync && !m_fullSyncPending) {
+            params["contentChanges"] = m_pendingChanges;
+            m_incrementalSyncs++;
+        }
+        else {
+            // 分析器只支持全文同步，或累积的变更超过上限
+            params["contentChanges"] = QJsonArray{ QJsonObject{ { "text", m_document->getFullText() } } };
+            m_fullSyncs++;
+        }
+        sendNotification(QStringLiteral("textDocument/didChange"), params);
+
+        m_pendingChanges = QJsonArray();
+        m_fullSyncPending = false;
+        m_syncedVersion = m_version;
+    }
+
+    m_requestedVersion = m_version;
+    m_editsSinceRequest.clear();
+    m_tokensRequestId = sendRequest(QStringLiteral("textDocument/semanticTokens/full"),
+        QJsonObject{ { "textDocument", QJsonObject{ { "uri", m_documentUri } } } });
+}
+
+// ==============================================================================
+// 消息收发
+// ==============================================================================
+
+int SemanticTokenClient::sendRequest(const QString& method, const QJsonValue& params)
+{
+    const int id = m_nextRequestId++;
+
+    QJsonObject message;
+    message["jsonrpc"] = "2.0";
+    message["id"] = id;
+    message["method"] = method;
+    if (!params.isNull()) {
+        message["params"] = params;
+    }
+
+    m_pendingRequests.insert(id, method);
+    sendMessage(message);
+    return id;
+}
+
+void SemanticTokenClient::sendNotification(const QString& method, const QJsonValue& params)
+{
+    QJsonObject message;
+    message["jsonrpc"] = "2.0";
+    message["method"] = method;
+    if (!params.isNull()) {
+        message["params"] = params;
+    }
+
+    sendMessage(message);
+}
+
+void SemanticTokenClient::sendMessage(const QJsonObject& message)
+{
+    if (m_process) {
+        writeMessage(m_process, message);
+    }
+}
+
+void SemanticTokenClient::writeMessage(QProcess* process, const QJsonObject& message)
+{
+    const QByteArray body = QJsonDocument(message).toJson(QJsonDocument::Compact);
+    process->write("Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n");
+    process->write(body);
+}
+
+bool SemanticTokenClient::takeMessage(QByteArray& buffer, QJsonObject* message, QString* error)
+{
+    error->clear();
+
+    // 每条消息：头部（至少有 Content-Length）、空行、JSON 正文
+    const qsizetype headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
+        return false;
+
+    qsizetype contentLength = -1;
+    const QList<QByteArray> headers = buffer.left(headerEnd).split('\n');
+    for (const QByteArray& header : headers) {
+        const qsizetype colon = header.indexOf(':');
+        if (colon > 0 && header.left(colon).trimmed().compare("Content-Length", Qt::CaseInsensitive) == 0) {
+            contentLength = header.mid(colon + 1).trimmed().toLongLong();
+        }
+    }
+
+    if (contentLength < 0) {
+        // 无法解析的头部：丢弃到空行为止，继续处理之后的内容
+        buffer.remove(0, headerEnd + 4);
+        *error = QStringLiteral("Malformed message header from semantic token server");
+        return true;
+    }
+
+    const qsizetype bodyStart = headerEnd + 4;
+    if (buffer.size() < bodyStart + contentLength)
+        return false;
+
+    const QByteArray body = buffer.mid(bodyStart, contentLength);
+    buffer.remove(0, bodyStart + contentLength);
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(body, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+        *error = QStringLiteral("Invalid JSON from semantic token server: %1").arg(parseError.errorString());
+        return true;
+    }
+
+    *message = document.object();
+    return true;
+}
+
+void SemanticTokenClient::onReadyRead()
+{
+    if (!m_process)
+        return;
+
+    m_buffer.append(m_process->readAllStandardOutput());
+
+    QJsonObject message;
+    QString error;
+    while (takeMessage(m_buffer, &message, &error)) {
+        if (!error.isEmpty()) {
+            emit serverError(error);
+            continue;
+        }
+
+        handleMessage(message);
+
+        // 处理消息时进程可能已被停止
+        if (!m_process)
+            return;
+    }
+}
+
+void SemanticTokenClient::handleMessage(const QJsonObject& message)
+{
+    const bool hasId = message.contains("id");
+    const bool hasMethod = message.contains("method");
+
+    // 分析器发来的请求需要应答，否则部分实现会一直等待；通知（诊断、日志等）忽略
+    if (hasMethod) {
+        if (hasId) {
+            handleServerRequest(message);
+        }
+        return;
+    }
+
+    if (!hasId)
+        return;
+
+    const int id = message.value("id").toInt();
+    const QString method = m_pendingRequests.take(id);
+
+    if (message.contains("error")) {
+        const QString text = message.value("error").toObject().value("message").toString();
+        emit serverError(QStringLiteral("%1 failed: %2").arg(method, text));
+
+        if (id == m_tokensRequestId) {
+            m_tokensRequestId = -1;
+            m_editsSinceRequest.clear();
+        }
+        return;
+    }
+
+    if (method == QLatin1String("initialize")) {
+        handleInitializeResult(message.value("result").toObject());
+    }
+    else if (id == m_tokensRequestId) {
+        handleTokensResult(message.value("result"));
+    }
+}
+
+void SemanticTokenClient::handleServerRequest(const QJsonObject& message)
+{
+    const QString method = message.value("method").toString();
+
+    QJsonObject response;
+    response["jsonrpc"] = "2.0";
+    response["id"] = message.value("id");
+
+    if (method == QLatin1String("workspace/configuration")) {
+        // 每一项配置都回答为未设置
+        const QJsonArray items = message.value("params").toObject().value("items").toArray();
+        QJsonArray result;
+        for (qsizetype i = 0; i < items.size(); ++i) {
+            result.append(QJsonValue::Null);
+        }
+        response["result"] = result;
+    }
+    else {
+        response["result"] = QJsonValue::Null;
+    }
+
+    sendMessage(response);
+
+    // 分析器认为已有结果过期（例如依赖的其他文件变化）
+    if (method == QLatin1String("workspace/semanticTokens/refresh")) {
+        scheduleRequest();
+    }
+}
+
+void SemanticTokenClient::handleInitializeResult(const QJsonObject& result)
+{
+    const QJsonObject capabilities = result.value("capabilities").toObject();
+    const QJsonObject provider = capabilities.value("semanticTokensProvider").toObject();
+
+    // textDocumentSync 可以是同步方式本身，也可以是带 change 字段的对象；2 为增量
+    const QJsonValue sync = capabilities.value("textDocumentSync");
+    const int syncKind = sync.isObject() ? sync.toObject().value("change").toInt() : sync.toInt();
+    m_incrementalSync = syncKind == 2;
+    const QJsonArray tokenTypes = provider.value("legend").toObject().value("tokenTypes").toArray();
+
+    m_legend.clear();
+    m_legend.reserve(tokenTypes.size());
+    for (const QJsonValue& name : tokenTypes) {
+        m_legend.append(tokenTypeForLegend(name.toString()));
+    }
+
+    if (provider.isEmpty()) {
+        emit serverError(QStringLiteral("Server does not provide semantic tokens"));
+    }
+
+    sendNotification(QStringLiteral("initialized"), QJsonObject());
+    m_initialized = true;
+
+    openDocument();
+}
+
+void SemanticTokenClient::handleTokensResult(const QJsonValue& result)
+{
+    m_tokensRequestId = -1;
+    const QList<LineEdit> edits = m_editsSinceRequest;
+    m_editsSinceRequest.clear();
+
+    if (!m_highlighter || !m_document)
+        return;
+
+    // 每个 token 五个整数：相对上一个 token 的行差、起始列（同一行时为相对值）、长度、类型、修饰符
+    struct LineToken {
+        int line;
+        Token token;
+    };
+
+    const QJsonArray data = result.toObject().value("data").toArray();
+    QList<LineToken> decoded;
+    decoded.reserve(data.size() / 5);
+
+    int line = 0;
+    int column = 0;
+    for (qsizetype i = 0; i + 4 < data.size(); i += 5) {
+        const int deltaLine = data[i].toInt();
+        const int deltaColumn = data[i + 1].toInt();
+        const int length = data[i + 2].toInt();
+        const int typeIndex = data[i + 3].toInt();
+
+        line += deltaLine;
+        column = deltaLine == 0 ? column + deltaColumn : deltaColumn;
+
+        const TokenType type = typeIndex >= 0 && typeIndex < m_legend.size()
+            ? m_legend[typeIndex] : TokenType::None;
+        if (type == TokenType::None || length <= 0)
+            continue;
+
+        decoded.append(LineToken{ line, Token(column, length, type) });
+    }
+
+    // 请求之后文档又被编辑过：按编辑顺序把行号映射到当前版本，被编辑的行丢弃（回退到词法 token），
+    // 与叠加层随编辑移动的方式一致；再以新版本重新请求
+    if (!edits.isEmpty()) {
+        for (const LineEdit& edit : edits) {
+            const int lastEdited = edit.startLine + edit.removedLines;
+            const int shift = edit.addedLines - edit.removedLines;
+
+            qsizetype kept = 0;
+            for (qsizetype i = 0; i < decoded.size(); ++i) {
+                LineToken entry = decoded[i];
+                if (entry.line >= edit.startLine && entry.line <= lastEdited)
+                    continue;
+                if (entry.line > lastEdited) {
+                    entry.line += shift;
+                }
+                decoded[kept++] = entry;
+            }
+            decoded.resize(kept);
+        }
+
+        m_mappedResults++;
+        scheduleRequest();
+    }
+
+    const int lineCount = m_document->lineCount();
+    QList<Token> tokens;
+    QList<int> lineTokenCounts;
+    tokens.reserve(decoded.size());
+
+    for (const LineToken& entry : std::as_const(decoded)) {
+        if (entry.line >= lineCount)
+            break;
+
+        if (lineTokenCounts.size() <= entry.line) {
+            lineTokenCounts.resize(entry.line + 1, 0);
+        }
+        lineTokenCounts[entry.line]++;
+        tokens.append(entry.token);
+    }
+
+    m_highlighter->setSemanticTokens(tokens, lineTokenCounts);
+    m_appliedResults++;
+}
+
+// ==============================================================================
+// 辅助方法
+// ==============================================================================
+
+QString SemanticTokenClient::languageId() const
+{
+    if (!m_languageId.isEmpty())
+        return m_languageId;
+
+    static const QHash<QString, QString> ids = {
+        { "c", "c" }, { "h", "cpp" }, { "cpp", "cpp" }, { "cc", "cpp" }, { "cxx", "cpp" },
+        { "hpp", "cpp" }, { "py", "python" }, { "js", "javascript" }, { "ts", "typescript" },
+        { "json", "json" }, { "java", "java" }, { "rs", "rust" }, { "go", "go" }
+    };
+
+    const QString suffix = m_document ? QFileInfo(m_document->filePath()).suffix().toLower() : QString();
+    return ids.value(suffix, QStringLiteral("plaintext"));
+}
+
+TokenType SemanticTokenClient::tokenTypeForLegend(const QString& name)
+{
+    // LSP 标准 token 类型到本编辑器的 TokenType；没有对应类型的保留词法结果
+    static const QHash<QString, TokenType> types = {
+        { "namespace", TokenType::Type }, { "type", TokenType::Type }, { "class", TokenType::Type },
+        { "enum", TokenType::Type }, { "interface", TokenType::Type }, { "struct", TokenType::Type },
+        { "typeParameter", TokenType::Type },
+        { "parameter", TokenType::Identifier }, { "variable", TokenType::Identifier },
+        { "property", TokenType::Identifier }, { "enumMember", TokenType::Identifier },
+        { "function", TokenType::Function }, { "method", TokenType::Function },
+        { "macro", TokenType::Preprocessor },
+        { "keyword", TokenType::Keyword }, { "modifier", TokenType::Keyword },
+        { "comment", TokenType::Comment },
+        { "string", TokenType::String }, { "regexp", TokenType::String },
+        { "number", TokenType::Number },
+        { "operator", TokenType::Operator }
+    };
+
+    return types.value(name, TokenType::None);
+}
+
+QString SemanticTokenClient::getDebugInfo() const
+{
+    QStringList info;
+
+    info << "SemanticTokenClient Debug Info:";
+    info << QString("  Server: %1").arg(isRunning() ? m_process->program() : QString("not running"));
+    info << QString("  Initialized: %1").arg(m_initialized ? "Yes" : "No");
+    info << QString("  Document: %1 (version %2, synced %3)")
+        .arg(m_documentOpen ? m_documentUri : QString("not open"))
+        .arg(m_version)
+        .arg(m_syncedVersion);
+    info << QString("  Legend types: %1").arg(m_legend.size());
+    info << QString("  Sync: %1 (incremental: %2, full: %3)")
+        .arg(m_incrementalSync ? "incremental" : "full text")
+        .arg(m_incrementalSyncs)
+        .arg(m_fullSyncs);
+    info << QString("  Results applied: %1 (mapped from older versions: %2)")
+        .arg(m_appliedResults)
+        .arg(m_mappedResults);
+    info << QString("  Pending requests: %1").arg(m_pendingRequests.size());
+
+    return info.join("\n");
+}
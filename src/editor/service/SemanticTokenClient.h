@@ -0,0 +1,124 @@
+#ifndef SEMANTIC_TOKEN_CLIENT_H
+#define SEMANTIC_TOKEN_CLIENT_H
+
+#include <QObject>
+#include <QPointer>
+#include <QByteArray>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QList>
+#include <QStringList>
+#include <QTimer>
+#include "TokenTypes.h"
+#include "../core/LineIndex.h"
+
+class DocumentModel;
+class QProcess;
+class SyntaxHighlighter;
+struct TextChange;
+
+// 语义 token 客户端
+// 启动本地的分析器进程（语言服务器），经标准输入输出按 LSP 的 JSON-RPC 格式通信：
+// 打开文档、同步编辑、请求 textDocument/semanticTokens/full。结果按图例映射到 TokenType，
+// 解开增量编码后交给 SyntaxHighlighter 的语义叠加层，绘制时与词法 token 合并。
+// 通信全部异步，绘制不等待分析器；编辑按文档的变更逐条换算为行列范围，
+// 防抖一段时间后以增量的 contentChanges 同步并请求，期间叠加层随行号移动。
+// 结果对应的版本已过期时按请求之后的编辑把 token 的行号映射到当前版本，被编辑的行丢弃
+class SemanticTokenClient : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int REQUEST_DELAY_MS = 300;
+    static constexpr int STOP_TIMEOUT_MS = 2000;    // 停止时等待进程自行退出的时间，超时后结束进程
+    static constexpr int MAX_PENDING_CHANGES = 256; // 一次同步累积的增量变更上限，超过后改为发送全文
+
+    explicit SemanticTokenClient(SyntaxHighlighter* highlighter, QObject* parent = nullptr);
+    ~SemanticTokenClient();
+
+    // 启动分析器进程；已有进程时先停止。启动失败通过 serverError 通知
+    void start(const QString& program, const QStringList& arguments = QStringList());
+    void stop();
+    bool isRunning() const;
+
+    void setDocument(DocumentModel* document);
+    // LSP 的 languageId，未设置时按文件扩展名推断
+    void setLanguageId(const QString& languageId);
+
+    QString getDebugInfo() const;
+
+signals:
+    void serverStarted();
+    void serverStopped();
+    void serverError(const QString& message);
+
+private:
+    QPointer<SyntaxHighlighter> m_highlighter;
+    QPointer<DocumentModel> m_document;
+    QProcess* m_process = nullptr;
+    QString m_languageId;
+
+    // 收到的字节流，按 Content-Length 切分出完整消息
+    QByteArray m_buffer;
+    int m_nextRequestId = 1;
+    QHash<int, QString> m_pendingRequests;   // 请求号 -> 方法名
+
+    bool m_initialized = false;
+    bool m_documentOpen = false;
+    QString m_documentUri;
+    int m_version = 0;              // 本地文档版本，每次编辑递增
+    int m_syncedVersion = -1;       // 已发送给分析器的版本
+    int m_tokensRequestId = -1;     // 进行中的语义 token 请求
+    int m_requestedVersion = -1;    // 该请求对应的版本
+
+    // 分析器一侧文档的行索引，用于把编辑前的字符位置换算为 LSP 的行列（UTF-16 列号）
+    LineIndex m_serverLines;
+    bool m_incrementalSync = false;     // 分析器支持增量同步（TextDocumentSyncKind.Incremental）
+    QJsonArray m_pendingChanges;        // 尚未发送的增量变更，按发生顺序
+    bool m_fullSyncPending = false;     // 下一次同步发送全文
+
+    // 请求发出后的编辑，按行记录；过期的结果据此把行号映射到当前版本
+    struct LineEdit {
+        int startLine;
+        int removedLines;
+        int addedLines;
+    };
+    QList<LineEdit> m_editsSinceRequest;
+
+    // 分析器的图例：tokenTypes 下标 -> TokenType
+    QList<TokenType> m_legend;
+    QTimer m_requestTimer;
+
+    quint64 m_appliedResults = 0;
+    quint64 m_mappedResults = 0;
+    quint64 m_incrementalSyncs = 0;
+    quint64 m_fullSyncs = 0;
+
+    // 消息收发
+    int sendRequest(const QString& method, const QJsonValue& params = QJsonValue());
+    void sendNotification(const QString& method, const QJsonValue& params = QJsonValue());
+    void sendMessage(const QJsonObject& message);
+    static void writeMessage(QProcess* process, const QJsonObject& message);
+    // 从缓冲区取出一条完整的消息；不完整时返回 false。头部或正文无法解析时 error 非空
+    static bool takeMessage(QByteArray& buffer, QJsonObject* message, QString* error);
+    void onReadyRead();
+    void sendInitialize();
+    void handleMessage(const QJsonObject& message);
+    void handleInitializeResult(const QJsonObject& result);
+    void handleTokensResult(const QJsonValue& result);
+    void handleServerRequest(const QJsonObject& message);
+    void resetState();
+
+    // 文档同步
+    void openDocument();
+    void closeDocument();
+    void onTextChanged(const TextChange& change);
+    void scheduleRequest();
+    void requestTokens();
+
+    QString languageId() const;
+    static TokenType tokenTypeForLegend(const QString& name);
+};
+
+#endif // SEMANTIC_TOKEN_CLIENT_H
@@ -1,19 +1,36 @@
 #include "SyntaxHighlighter.h"
+#include "LanguageRegistry.h"
+#include "../core/DocumentModel.h"
 #include <QDebug>
 #include <QStringList>
 #include <QFileInfo>
+#include <QtConcurrent/QtConcurrent>
 #include <algorithm>
+#include <limits>
 
 SyntaxHighlighter::SyntaxHighlighter(QObject* parent)
     : QObject(parent)
+    , m_highlightWatcher(new QFutureWatcher<HighlightResult>(this))
 {
-    // 加载内置语言定义
-    loadBuiltinLanguages();
+    // 合并连续的绘制请求和编辑，后续各轮之间也经由事件循环让出
+    m_highlightTimer.setSingleShot(true);
+    m_highlightTimer.setInterval(10);
+    connect(&m_highlightTimer, &QTimer::timeout, this, &SyntaxHighlighter::startHighlightPass);
+
+    connect(m_highlightWatcher, &QFutureWatcher<HighlightResult>::resultReadyAt,
+        this, &SyntaxHighlighter::onHighlightResultReady);
+    connect(m_highlightWatcher, &QFutureWatcher<HighlightResult>::finished,
+        this, &SyntaxHighlighter::onHighlightPassFinished);
+
+    // 默认语言为纯文本；语言定义由共享的注册表一次性加载
+    rebuildPalette();
+    setLanguage("text");
+}
 
-    // 设置默认语言为纯文本
-    if (m_languages.contains("text")) {
-        setLanguage("text");
-    }
+SyntaxHighlighter::~SyntaxHighlighter()
+{
+    // 分析任务只持有行文本的副本和共享的词法分析器，不引用 this，取消即可
+    m_highlightWatcher->cancel();
 }
 
 // ==============================================================================
@@ -22,12 +39,13 @@ SyntaxHighlighter::SyntaxHighlighter(QObject* parent)
 
 void SyntaxHighlighter::registerLanguage(const LanguageDefinition& language)
 {
-    m_languages[language.name] = language;
+    LanguageRegistry::instance().registerLanguage(language);
 }
 
 void SyntaxHighlighter::setLanguage(const QString& languageName)
 {
-    if (!m_languages.contains(languageName)) {
+    auto language = LanguageRegistry::instance().language(languageName);
+    if (!language) {
         qWarning() << "Language not found:" << languageName;
         return;
     }
@@ -35,25 +53,23 @@ void SyntaxHighlighter::setLanguage(const QString& languageName)
     if (m_currentLanguage.name == languageName)
         return;
 
-    m_currentLanguage = m_languages[languageName];
+    // 定义和编译好的词法分析器都与其他高亮器共享
+    m_currentLanguage = language->definition;
+    m_lexer = language->lexer;
+    rebuildPalette();
 
     // 清除缓存的tokens
-    m_lineTokens.clear();
+    resetCache();
 
     emit languageChanged(languageName);
 }
 
 void SyntaxHighlighter::setLanguageByFileExtension(const QString& extension)
 {
-    QString lowercaseExt = extension.toLower();
-
     // 查找匹配的语言
-    for (auto it = m_languages.begin(); it != m_languages.end(); ++it) {
-        const LanguageDefinition& lang = it.value();
-        if (lang.fileExtensions.contains(lowercaseExt)) {
-            setLanguage(lang.name);
-            return;
-        }
+    if (auto language = LanguageRegistry::instance().languageForExtension(extension)) {
+        setLanguage(language->definition.name);
+        return;
     }
 
     // 如果没有找到匹配的语言，设置为纯文本
@@ -67,7 +83,7 @@ LanguageDefinition SyntaxHighlighter::currentLanguage() const
 
 QStringList SyntaxHighlighter::availableLanguages() const
 {
-    return m_languages.keys();
+    return LanguageRegistry::instance().availableLanguages();
 }
 
 // ==============================================================================
@@ -81,13 +97,14 @@ QList<Token> SyntaxHighlighter::tokenize(const QString& text) const
     if (text.isEmpty() || m_currentLanguage.name.isEmpty())
         return tokens;
 
-    // 分行处理
+    // 分行处理，行尾状态传给下一行
     QStringList lines = text.split('\n');
     int currentPosition = 0;
+    LexerState state;
 
     for (int lineNumber = 0; lineNumber < lines.size(); ++lineNumber) {
         const QString& line = lines[lineNumber];
-        QList<Token> lineTokens = tokenizeLine(line, lineNumber);
+        QList<Token> lineTokens = tokenizeLine(line, state, &state);
 
         // 调整token位置到全文坐标
         for (Token& token : lineTokens) {
@@ -101,273 +118,479 @@ QList<Token> SyntaxHighlighter::tokenize(const QString& text) const
     return tokens;
 }
 
-QList<Token> SyntaxHighlighter::tokenizeLine(const QString& line, int lineNumber,
-    const QList<Token>& previousLineTokens) const
+QList<Token> SyntaxHighlighter::tokenizeLine(const QString& line, const LexerState& startState,
+    LexerState* endState) const
 {
-    QList<Token> tokens;
+    if (!m_lexer) {
+        if (endState) {
+            *endState = LexerState();
+        }
+        return QList<Token>();
+    }
 
-    if (line.isEmpty())
-        return tokens;
+    return m_lexer->tokenizeLine(line, startState, endState);
+}
 
-    // 检查是否在多行注释中
-    bool inMultiLineComment = false;
-    bool inString = false;
-    QChar stringDelimiter;
+QList<Token> SyntaxHighlighter::lineTokens(int lineNumber) const
+{
+    if (!m_document || lineNumber < 0)
+        return QList<Token>();
 
-    // 从上一行的状态继续
-    if (!previousLineTokens.isEmpty()) {
-        const Token& lastToken = previousLineTokens.last();
-        if (lastToken.type == TokenType::Comment) {
-            inMultiLineComment = true;
-        }
-        else if (lastToken.type == TokenType::String) {
-            inString = true;
-            // 需要确定字符串分隔符，这里简化处理
-            stringDelimiter = '"';
-        }
+    // 文档在没有通知的情况下改变了行数时按纯文本绘制，回到所属线程后整体重建
+    if (m_lines.size() != m_document->lineCount()) {
+        postPaintRequest(-1, true);
+        return QList<Token>();
     }
 
-    int i = 0;
-    while (i < line.length()) {
-        QChar ch = line.at(i);
-
-        // 处理多行注释
-        if (!inString && !m_currentLanguage.multiLineCommentStart.isEmpty()) {
-            if (!inMultiLineComment &&
-                line.mid(i).startsWith(m_currentLanguage.multiLineCommentStart)) {
-                inMultiLineComment = true;
-                int commentStart = i;
-                i += m_currentLanguage.multiLineCommentStart.length();
-
-                // 查找注释结束
-                int commentEnd = line.indexOf(m_currentLanguage.multiLineCommentEnd, i);
-                if (commentEnd != -1) {
-                    // 注释在同一行结束
-                    Token token;
-                    token.position = commentStart;
-                    token.length = commentEnd + m_currentLanguage.multiLineCommentEnd.length() - commentStart;
-                    token.type = TokenType::Comment;
-                    tokens.append(token);
-
-                    i = commentEnd + m_currentLanguage.multiLineCommentEnd.length();
-                    inMultiLineComment = false;
-                }
-                else {
-                    // 注释延续到行尾
-                    Token token;
-                    token.position = commentStart;
-                    token.length = line.length() - commentStart;
-                    token.type = TokenType::Comment;
-                    tokens.append(token);
-                    break;
-                }
-                continue;
-            }
-            else if (inMultiLineComment) {
-                int commentEnd = line.indexOf(m_currentLanguage.multiLineCommentEnd, i);
-                if (commentEnd != -1) {
-                    // 注释结束
-                    Token token;
-                    token.position = 0;
-                    token.length = commentEnd + m_currentLanguage.multiLineCommentEnd.length();
-                    token.type = TokenType::Comment;
-                    tokens.append(token);
-
-                    i = commentEnd + m_currentLanguage.multiLineCommentEnd.length();
-                    inMultiLineComment = false;
-                }
-                else {
-                    // 整行都是注释
-                    Token token;
-                    token.position = 0;
-                    token.length = line.length();
-                    token.type = TokenType::Comment;
-                    tokens.append(token);
-                    break;
-                }
-                continue;
+    if (lineNumber >= m_lines.size())
+        return QList<Token>();
+
+    requestLine(lineNumber);
+
+    if (m_semanticTokens.lineCount() > lineNumber)
+        return mergeTokens(m_tokens.tokens(lineNumber), m_semanticTokens.tokens(lineNumber));
+
+    return m_tokens.tokens(lineNumber);
+}
+
+QList<Token> SyntaxHighlighter::lineTokens(int lineNumber, const QString& lineText,
+    int firstColumn, int lastColumn, bool lexWindow) const
+{
+    if (!m_document || lineNumber < 0)
+        return QList<Token>();
+
+    if (m_lines.size() != m_document->lineCount()) {
+        postPaintRequest(-1, true);
+        return QList<Token>();
+    }
+
+    if (lineNumber >= m_lines.size())
+        return QList<Token>();
+
+    requestLine(lineNumber);
+
+    const QList<Token> semantic = m_semanticTokens.lineCount() > lineNumber
+        ? m_semanticTokens.tokens(lineNumber, firstColumn, lastColumn) : QList<Token>();
+
+    if (m_lines[lineNumber].lexed) {
+        // 起始列超过 TokenStore::MAX_START 的 token 不在存储中（单行数 MB 的文本），
+        // 窗口伸到这之后的部分总是按窗口分析
+        constexpr int storedEnd = TokenStore::MAX_START + 1;
+        if (lastColumn <= storedEnd)
+            return mergeTokens(m_tokens.tokens(lineNumber, firstColumn, lastColumn), semantic);
+
+        QList<Token> tokens;
+        if (firstColumn < storedEnd) {
+            tokens = m_tokens.tokens(lineNumber, firstColumn, storedEnd);
+            for (Token& token : tokens) {
+                token.length = qMin(token.length, storedEnd - token.position);
             }
         }
+        if (lexWindow) {
+            tokens += windowTokens(lineNumber, lineText, qMax(firstColumn, storedEnd), lastColumn);
+        }
+        else {
+            // 这一行不会再有后台结果触发重绘，由之后的一帧补上
+            postRepaint(lineNumber);
+        }
+        return mergeTokens(tokens, semantic);
+    }
 
-        // 处理单行注释
-        if (!inString && !inMultiLineComment &&
-            !m_currentLanguage.singleLineComment.isEmpty() &&
-            line.mid(i).startsWith(m_currentLanguage.singleLineComment)) {
-            Token token;
-            token.position = i;
-            token.length = line.length() - i;
-            token.type = TokenType::Comment;
-            tokens.append(token);
+    // 普通长度的行等后台结果，按纯文本绘制
+    if (!lexWindow || lineText.length() <= m_longLineThreshold)
+        return semantic;
+
+    return mergeTokens(windowTokens(lineNumber, lineText, firstColumn, lastColumn), semantic);
+}
+
+QList<Token> SyntaxHighlighter::windowTokens(int lineNumber, const QString& lineText,
+    int firstColumn, int lastColumn) const
+{
+    if (!m_lexer)
+        return QList<Token>();
+
+    firstColumn = qBound(0, firstColumn, static_cast<int>(lineText.length()));
+    lastColumn = qBound(firstColumn, lastColumn, static_cast<int>(lineText.length()));
+    if (firstColumn == lastColumn)
+        return QList<Token>();
+
+    // 没有行内的中间状态，以行首状态把窗口当作一行的开头来分析：
+    // 窗口从字符串、块注释或某个 token 中间开始时，窗口内的着色是错的，只是近似
+    const LexerState state = lineNumber > 0 ? m_lines[lineNumber - 1].endState : LexerState();
+    QList<Token> tokens = m_lexer->tokenizeLine(lineText.mid(firstColumn, lastColumn - firstColumn), state);
+    for (Token& token : tokens) {
+        token.position += firstColumn;
+    }
+    {
+        QMutexLocker locker(&m_paintRequestMutex);
+        m_paintRequests.windowLexCount++;
+    }
+
+    return tokens;
+}
+
+int SyntaxHighlighter::pendingLineCount() const
+{
+    return static_cast<int>(m_lines.size()) - m_validLines;
+}
+
+void SyntaxHighlighter::setLongLineThreshold(int length)
+{
+    m_longLineThreshold = qMax(1, length);
+}
+
+// ==============================================================================
+// 增量更新
+// ==============================================================================
+
+void SyntaxHighlighter::updateHighlighting(int startLine, int removedLines, int addedLines)
+{
+    if (!m_document)
+        return;
+
+    // 变更与缓存的行数对不上时整体重建
+    if (startLine < 0 || removedLines < 0 || addedLines < 0 ||
+        startLine + removedLines >= m_lines.size() ||
+        m_lines.size() - removedLines + addedLines != m_document->lineCount()) {
+        resetCache();
+        emit highlightingUpdated(0, -1);
+        return;
+    }
+
+    // 被编辑的行换成未分析的新条目，之后的条目随行号移动
+    m_lines[startLine] = LineEntry();
+    m_tokens.setTokens(startLine, nullptr, 0);
+    if (removedLines > 0) {
+        m_lines.remove(startLine + 1, removedLines);
+        m_tokens.removeLines(startLine + 1, removedLines);
+    }
+    if (addedLines > 0) {
+        m_lines.insert(startLine + 1, addedLines, LineEntry());
+        m_tokens.insertLines(startLine + 1, addedLines);
+    }
+
+    if (hasSemanticTokens()) {
+        m_semanticTokens.setTokens(startLine, nullptr, 0);
+        m_semanticTokens.removeLines(startLine + 1, removedLines);
+        m_semanticTokens.insertLines(startLine + 1, addedLines);
+    }
+    m_validLines = qMin(m_validLines, startLine);
+
+    if (removedLines > 0 || addedLines > 0) {
+        m_lineIndexesDirty = true;
+    }
+
+    // 进行中的后台结果按旧行号计算，全部作废
+    m_highlightGeneration++;
+
+    // 编辑行总是同步分析（前面的行尚未分析时以最近的结束状态为假定起点），
+    // 再向后继续到某行的开始状态与缓存一致为止（后续行都不受影响）
+    int lastEditedLine = startLine + addedLines;
+    int limit = qMin(static_cast<int>(m_lines.size()), lastEditedLine + 1 + MAX_EAGER_RELEX_LINES);
+    int line = startLine;
+    while (line < limit && (line <= lastEditedLine || !isLineCurrent(line))) {
+        // 超长行不在编辑时同步分析，连同其后的行交给后台
+        if (!lexLine(line))
             break;
-        }
+        line++;
+    }
 
-        // 处理字符串
-        if (!inMultiLineComment) {
-            for (const QString& delimiter : m_currentLanguage.stringDelimiters) {
-                if (delimiter.length() == 1 && ch == delimiter.at(0)) {
-                    if (!inString) {
-                        // 字符串开始
-                        inString = true;
-                        stringDelimiter = ch;
-                        int stringStart = i;
-                        i++;
-
-                        // 查找字符串结束
-                        bool escaped = false;
-                        while (i < line.length()) {
-                            QChar currentChar = line.at(i);
-
-                            if (escaped) {
-                                escaped = false;
-                            }
-                            else if (!m_currentLanguage.escapeCharacter.isEmpty() &&
-                                currentChar == m_currentLanguage.escapeCharacter.at(0)) {
-                                escaped = true;
-                            }
-                            else if (currentChar == stringDelimiter) {
-                                // 字符串结束
-                                Token token;
-                                token.position = stringStart;
-                                token.length = i - stringStart + 1;
-                                token.type = TokenType::String;
-                                tokens.append(token);
-
-                                inString = false;
-                                i++;
-                                goto next_char;
-                            }
-                            i++;
-                        }
-
-                        // 字符串延续到行尾
-                        if (inString) {
-                            Token token;
-                            token.position = stringStart;
-                            token.length = line.length() - stringStart;
-                            token.type = TokenType::String;
-                            tokens.append(token);
-                            goto line_end;
-                        }
-                    }
-                    else if (ch == stringDelimiter) {
-                        // 字符串结束（这种情况在上面已经处理了）
-                        inString = false;
-                        i++;
-                        continue;
-                    }
-                }
-            }
+    advanceValidLines();
+    emit highlightingUpdated(startLine, qMax(startLine, line - 1));
+
+    // 状态变化波及的行超过上限（例如插入了块注释开始符）或文档尚未分析完时，由后台继续
+    if (m_validLines < m_lines.size()) {
+        scheduleHighlightPass();
+    }
+}
+
+void SyntaxHighlighter::setDocument(DocumentModel* document)
+{
+    if (m_document == document)
+        return;
+
+    m_document = document;
+    resetCache();
+}
+
+void SyntaxHighlighter::resetCache()
+{
+    m_lines = QList<LineEntry>(m_document ? m_document->lineCount() : 0);
+    m_tokens.reset(static_cast<int>(m_lines.size()));
+    m_semanticTokens.clear();
+    m_validLines = 0;
+    m_requestedFirstLine = -1;
+    m_requestedLastLine = -1;
+    m_highlightGeneration++;
+    m_lineIndexesDirty = true;
+
+    if (m_document) {
+        scheduleHighlightPass();
+    }
+}
+
+bool SyntaxHighlighter::isLineCurrent(int line) const
+{
+    const LineEntry& entry = m_lines[line];
+    LexerState expected = line > 0 ? m_lines[line - 1].endState : LexerState();
+    return entry.lexed && entry.startState == expected;
+}
+
+bool SyntaxHighlighter::lexLine(int line)
+{
+    LineEntry& entry = m_lines[line];
+    const QString text = m_document->getLine(line);
+    if (text.length() > m_longLineThreshold)
+        return false;
+
+    entry.startState = line > 0 ? m_lines[line - 1].endState : LexerState();
+    const QList<Token> tokens = tokenizeLine(text, entry.startState, &entry.endState);
+    entry.brackets = bracketBalance(text, tokens);
+    entry.indent = lineIndentation(text);
+    entry.lexed = true;
+    m_tokens.setTokens(line, tokens);
+    m_lexedLineCount++;
+
+    updateLineIndexes(line);
+    return true;
+}
+
+void SyntaxHighlighter::requestLine(int line) const
+{
+    // 过期或缺失的行记入请求范围，下一轮后台分析优先处理；绘制不等待结果
+    if (line >= m_validLines && !isLineCurrent(line)) {
+        postPaintRequest(line, false);
+    }
+}
+
+void SyntaxHighlighter::postPaintRequest(int line, bool resync) const
+{
+    QMutexLocker locker(&m_paintRequestMutex);
+
+    if (line >= 0) {
+        m_paintRequests.firstLine = m_paintRequests.firstLine < 0
+            ? line : qMin(m_paintRequests.firstLine, line);
+        m_paintRequests.lastLine = qMax(m_paintRequests.lastLine, line);
+    }
+    m_paintRequests.resync = m_paintRequests.resync || resync;
+    queuePaintRequests();
+}
+
+void SyntaxHighlighter::postRepaint(int line) const
+{
+    QMutexLocker locker(&m_paintRequestMutex);
+
+    m_paintRequests.repaintFirstLine = m_paintRequests.repaintFirstLine < 0
+        ? line : qMin(m_paintRequests.repaintFirstLine, line);
+    m_paintRequests.repaintLastLine = qMax(m_paintRequests.repaintLastLine, line);
+    queuePaintRequests();
+}
+
+void SyntaxHighlighter::queuePaintRequests() const
+{
+    // 调用方持有 m_paintRequestMutex；同一帧的请求只排队一次
+    if (!m_paintRequests.posted) {
+        m_paintRequests.posted = true;
+        QMetaObject::invokeMethod(const_cast<SyntaxHighlighter*>(this),
+            &SyntaxHighlighter::applyPaintRequests, Qt::QueuedConnection);
+    }
+}
+
+void SyntaxHighlighter::applyPaintRequests()
+{
+    PaintRequests requests;
+    {
+        QMutexLocker locker(&m_paintRequestMutex);
+        requests = m_paintRequests;
+        m_paintRequests.firstLine = -1;
+        m_paintRequests.lastLine = -1;
+        m_paintRequests.repaintFirstLine = -1;
+        m_paintRequests.repaintLastLine = -1;
+        m_paintRequests.resync = false;
+        m_paintRequests.posted = false;
+    }
+
+    if (!m_document)
+        return;
+
+    // 重建后全部行都会分析，登记的行号也已失效
+    if (requests.resync && m_lines.size() != m_document->lineCount()) {
+        resetCache();
+        emit highlightingUpdated(0, -1);
+        return;
+    }
+
+    // 登记之后可能已有编辑，超出当前行数的部分由后台分析的正常顺序处理
+    const int size = static_cast<int>(m_lines.size());
+    if (requests.firstLine >= 0 && requests.firstLine < size) {
+        m_requestedFirstLine = m_requestedFirstLine < 0
+            ? requests.firstLine : qMin(m_requestedFirstLine, requests.firstLine);
+        m_requestedLastLine = qMax(m_requestedLastLine, qMin(requests.lastLine, size - 1));
+        scheduleHighlightPass();
+    }
+
+    if (requests.repaintFirstLine >= 0 && requests.repaintFirstLine < size) {
+        emit highlightingUpdated(requests.repaintFirstLine,
+            qMin(requests.repaintLastLine, size - 1));
+    }
+}
+
+void SyntaxHighlighter::advanceValidLines()
+{
+    // 假定起点正确的行在这里只比较状态即并入有效前缀
+    while (m_validLines < m_lines.size() && isLineCurrent(m_validLines)) {
+        m_validLines++;
+    }
+}
+
+// ==============================================================================
+// 后台分析
+// ==============================================================================
+
+void SyntaxHighlighter::scheduleHighlightPass()
+{
+    if (m_document && !m_highlightTimer.isActive()) {
+        m_highlightTimer.start();
+    }
+}
+
+void SyntaxHighlighter::startHighlightPass()
+{
+    // 上一轮还在计算，完成后会继续检查
+    if (!m_document || !m_lexer || m_highlightWatcher->isRunning())
+        return;
+
+    advanceValidLines();
+
+    const int size = static_cast<int>(m_lines.size());
+
+    HighlightJob prototype;
+    prototype.generation = m_highlightGeneration;
+    prototype.lexer = m_lexer;
+
+    QList<HighlightJob> jobs;
+
+    auto addJob = [&](int from, int to, const LexerState& startState) {
+        HighlightJob job = prototype;
+        job.firstLine = from;
+        job.startState = startState;
+
+        // 字符数达到上限时提前结束，剩余的行由下一轮继续；超长行因此不会拖住同批的其他行
+        qsizetype characters = 0;
+        for (int line = from; line < to && characters < JOB_CHARACTER_BUDGET; ++line) {
+            job.lines.append(m_document->getLine(line));
+            characters += job.lines.last().size();
         }
+        jobs.append(std::move(job));
+    };
 
-        // 处理数字
-        if (!inString && !inMultiLineComment && ch.isDigit()) {
-            int numberStart = i;
-            i++;
-
-            // 继续读取数字
-            while (i < line.length()) {
-                QChar nextChar = line.at(i);
-                if (nextChar.isDigit() || nextChar == '.' ||
-                    nextChar.toLower() == 'x' || nextChar.toLower() == 'e' ||
-                    (nextChar >= 'a' && nextChar <= 'f') || (nextChar >= 'A' && nextChar <= 'F')) {
-                    i++;
-                }
-                else {
-                    break;
-                }
-            }
+    int frontierEnd = qMin(size, m_validLines + FRONTIER_BATCH_LINES);
 
-            Token token;
-            token.position = numberStart;
-            token.length = i - numberStart;
-            token.type = TokenType::Number;
-            tokens.append(token);
-            continue;
+    // 绘制请求过的行及其下方：紧接前沿时并入前沿任务，否则以前一行最近的结束状态为假定起点先行分析
+    if (m_requestedFirstLine >= 0) {
+        int first = qBound(0, m_requestedFirstLine, size);
+        int last = qMin(m_requestedLastLine + 1, first + FRONTIER_BATCH_LINES);
+        last = qMin(size, last + VIEWPORT_LOOKAHEAD_LINES);
+
+        if (first <= frontierEnd) {
+            frontierEnd = qMax(frontierEnd, last);
+        }
+        else if (first < last) {
+            addJob(first, last, m_lines[first - 1].endState);
         }
 
-        // 处理标识符和关键字
-        if (!inString && !inMultiLineComment && (ch.isLetter() || ch == '_')) {
-            int identifierStart = i;
-            i++;
+        m_requestedFirstLine = -1;
+        m_requestedLastLine = -1;
+    }
 
-            // 继续读取标识符
-            while (i < line.length()) {
-                QChar nextChar = line.at(i);
-                if (nextChar.isLetterOrNumber() || nextChar == '_') {
-                    i++;
-                }
-                else {
-                    break;
-                }
-            }
+    // 有效前缀之后的一批，起点状态可靠
+    if (m_validLines < frontierEnd) {
+        addJob(m_validLines, frontierEnd,
+            m_validLines > 0 ? m_lines[m_validLines - 1].endState : LexerState());
+    }
 
-            QString identifier = line.mid(identifierStart, i - identifierStart);
-            TokenType tokenType = classifyToken(identifier);
+    if (jobs.isEmpty())
+        return;
 
-            Token token;
-            token.position = identifierStart;
-            token.length = i - identifierStart;
-            token.type = tokenType;
-            tokens.append(token);
-            continue;
-        }
+    m_highlightWatcher->setFuture(QtConcurrent::mapped(std::move(jobs), &SyntaxHighlighter::runHighlightJob));
+}
 
-        // 处理运算符
-        if (!inString && !inMultiLineComment && !ch.isLetterOrNumber() && !ch.isSpace()) {
-            // 检查多字符运算符
-            bool foundOperator = false;
-            for (int len = 3; len >= 1; len--) {
-                if (i + len <= line.length()) {
-                    QString op = line.mid(i, len);
-                    if (isOperator(op)) {
-                        Token token;
-                        token.position = i;
-                        token.length = len;
-                        token.type = TokenType::Operator;
-                        tokens.append(token);
-
-                        i += len;
-                        foundOperator = true;
-                        break;
-                    }
-                }
-            }
+void SyntaxHighlighter::onHighlightResultReady(int index)
+{
+    HighlightResult result = m_highlightWatcher->resultAt(index);
+    if (result.generation != m_highlightGeneration)
+        return;
 
-            if (!foundOperator) {
-                i++;
-            }
+    int firstChanged = -1;
+    int lastChanged = -1;
+    int tokenOffset = 0;
+
+    for (int i = 0; i < result.entries.size(); ++i) {
+        int line = result.firstLine + i;
+        if (line >= m_lines.size())
+            break;
+
+        const Token* tokens = result.tokens.constData() + tokenOffset;
+        const int tokenCount = result.tokenCounts[i];
+        tokenOffset += tokenCount;
+
+        // 已经与前一行衔接的条目不被起点不一致的结果覆盖
+        const LineEntry& entry = result.entries[i];
+        LexerState expected = line > 0 ? m_lines[line - 1].endState : LexerState();
+        if (entry.startState != expected && isLineCurrent(line))
             continue;
-        }
 
-    next_char:
-        if (i < line.length()) {
-            i++;
+        m_lines[line] = entry;
+        m_tokens.setTokens(line, tokens, tokenCount);
+        m_lexedLineCount++;
+        updateLineIndexes(line);
+
+        if (firstChanged < 0) {
+            firstChanged = line;
         }
+        lastChanged = line;
     }
 
-line_end:
-    Q_UNUSED(lineNumber) // 避免未使用参数警告
-        return tokens;
-}
+    advanceValidLines();
 
-// ==============================================================================
-// 增量更新
-// ==============================================================================
+    if (firstChanged >= 0) {
+        emit highlightingUpdated(firstChanged, lastChanged);
+    }
+}
 
-void SyntaxHighlighter::updateHighlighting(const QString& text, int changedPosition,
-    int removedLength, int addedLength)
+void SyntaxHighlighter::onHighlightPassFinished()
 {
-    Q_UNUSED(text)
-        Q_UNUSED(changedPosition)
-        Q_UNUSED(removedLength)
-        Q_UNUSED(addedLength)
+    advanceValidLines();
 
-        // 简化的增量更新：清除所有缓存
-        // 在实际实现中，可以只更新受影响的行
-        m_lineTokens.clear();
+    // 还有未确定的行或新的绘制请求（包括本轮期间因变更而丢弃的）时继续下一轮
+    if (m_validLines < m_lines.size() || m_requestedFirstLine >= 0) {
+        scheduleHighlightPass();
+    }
+}
 
-    // 发送更新信号
-    emit highlightingUpdated(0, -1, QList<Token>());
+SyntaxHighlighter::HighlightResult SyntaxHighlighter::runHighlightJob(const HighlightJob& job)
+{
+    HighlightResult result;
+    result.generation = job.generation;
+    result.firstLine = job.firstLine;
+    result.entries.reserve(job.lines.size());
+    result.tokenCounts.reserve(job.lines.size());
+
+    LexerState state = job.startState;
+    for (const QString& line : job.lines) {
+        LineEntry entry;
+        entry.startState = state;
+        const QList<Token> tokens = job.lexer->tokenizeLine(line, state, &entry.endState);
+        entry.brackets = bracketBalance(line, tokens);
+        entry.indent = lineIndentation(line);
+        entry.lexed = true;
+        state = entry.endState;
+        result.entries.append(std::move(entry));
+        result.tokens.append(tokens);
+        result.tokenCounts.append(static_cast<int>(tokens.size()));
+    }
+
+    return result;
 }
 
 // ==============================================================================
@@ -421,6 +644,22 @@ QTextCharFormat SyntaxHighlighter::getFormat(TokenType type) const
 void SyntaxHighlighter::setFormat(TokenType type, const QTextCharFormat& format)
 {
     m_currentLanguage.defaultFormats[type] = format;
+
+    // 格式不影响 token，只需重建样式并重绘
+    rebuildPalette();
+    emit highlightingUpdated(0, -1);
+}
+
+void SyntaxHighlighter::rebuildPalette()
+{
+    for (int i = 0; i < TOKEN_TYPE_COUNT; ++i) {
+        const QTextCharFormat format = getFormat(static_cast<TokenType>(i));
+
+        TokenStyle& style = m_palette[i];
+        style.hasColor = format.hasProperty(QTextFormat::ForegroundBrush);
+        style.color = style.hasColor ? format.foreground().color() : QColor();
+        style.bold = format.fontWeight() == QFont::Bold;
+    }
 }
 
 // ==============================================================================
@@ -514,8 +753,9 @@ void SyntaxHighlighter::setCustomTheme(const QHash<TokenType, QTextCharFormat>&
         m_currentLanguage.defaultFormats[it.key()] = it.value();
     }
 
-    // 清除缓存，强制重新高亮
-    m_lineTokens.clear();
+    // 格式不影响 token，缓存无需失效；样式整体重建一次，已绘制的行需要按新颜色重绘
+    rebuildPalette();
+    emit highlightingUpdated(0, -1);
 }
 
 // ==============================================================================
@@ -542,83 +782,114 @@ Token SyntaxHighlighter::getTokenAtPosition(const QString& text, int position) c
 
 QPair<int, int> SyntaxHighlighter::findMatchingBracket(const QString& text, int position) const
 {
-    if (position < 0 || position >= text.length())
+    if (position < 0 || position >= text.length() || bracketDelta(text.at(position)) == 0)
         return QPair<int, int>(-1, -1);
 
-    QChar ch = text.at(position);
-    QChar openBracket, closeBracket;
-    bool searchForward = true;
-
-    // 确定括号类型和搜索方向
-    if (ch == '(') {
-        openBracket = '(';
-        closeBracket = ')';
-    }
-    else if (ch == ')') {
-        openBracket = '(';
-        closeBracket = ')';
-        searchForward = false;
-    }
-    else if (ch == '[') {
-        openBracket = '[';
-        closeBracket = ']';
-    }
-    else if (ch == ']') {
-        openBracket = '[';
-        closeBracket = ']';
-        searchForward = false;
-    }
-    else if (ch == '{') {
-        openBracket = '{';
-        closeBracket = '}';
-    }
-    else if (ch == '}') {
-        openBracket = '{';
-        closeBracket = '}';
-        searchForward = false;
+    // 只有词法分析得到的单字符运算符才是括号，字符串和注释中的括号随之排除
+    QList<int> brackets;
+    int self = -1;
+    const QList<Token> tokens = tokenize(text);
+    for (const Token& token : tokens) {
+        if (token.type == TokenType::Operator && token.length == 1 &&
+            bracketDelta(text.at(token.position)) != 0) {
+            if (token.position == position) {
+                self = brackets.size();
+            }
+            brackets.append(token.position);
+        }
     }
-    else {
+
+    if (self < 0)
         return QPair<int, int>(-1, -1);
-    }
 
-    // 搜索匹配的括号
-    int depth = 1;
-    int searchPos = searchForward ? position + 1 : position - 1;
+    // 开括号向后、闭括号向前，深度回到 0 处即配对
+    const int direction = bracketDelta(text.at(position));
+    int depth = 0;
+    for (int i = self; i >= 0 && i < brackets.size(); i += direction) {
+        depth += bracketDelta(text.at(brackets[i]));
+        if (depth == 0) {
+            if (text.at(brackets[i]) != counterpartBracket(text.at(position)))
+                break;
+            return QPair<int, int>(position, brackets[i]);
+        }
+    }
 
-    while (searchPos >= 0 && searchPos < text.length()) {
-        QChar currentChar = text.at(searchPos);
+    return QPair<int, int>(-1, -1);
+}
 
-        // 跳过字符串和注释中的括号
-        if (isInsideString(searchPos, text) || isInsideMultiLineComment(searchPos, text)) {
-            searchPos += searchForward ? 1 : -1;
-            continue;
+QPair<int, int> SyntaxHighlighter::findMatchingBracket(int position)
+{
+    const QPair<int, int> none(-1, -1);
+    if (!m_document || position < 0)
+        return none;
+
+    int line = m_document->positionToLine(position);
+    if (line < 0 || line >= m_lines.size() || !m_lines[line].lexed)
+        return none;
+
+    const QString lineText = m_document->getLine(line);
+    const int column = m_document->positionToColumn(position);
+    if (column < 0 || column >= lineText.length())
+        return none;
+
+    const QChar bracket = lineText.at(column);
+    const int direction = bracketDelta(bracket);
+    if (direction == 0)
+        return none;
+
+    QList<int> columns = bracketColumns(lineText, m_tokens.tokens(line));
+    int self = columns.indexOf(column);
+    if (self < 0)
+        return none;
+
+    // 开括号向后、闭括号向前，深度回到 0 处即配对：先在本行内查找
+    int depth = 0;
+    int matchLine = -1;
+    int matchColumn = -1;
+    QString matchText;
+
+    for (int i = self; i >= 0 && i < columns.size(); i += direction) {
+        depth += bracketDelta(lineText.at(columns[i]));
+        if (depth == 0) {
+            matchLine = line;
+            matchColumn = columns[i];
+            matchText = lineText;
+            break;
         }
+    }
 
-        if (currentChar == openBracket) {
-            if (searchForward) {
-                depth++;
+    // 本行未配对时由索引定位配对所在的行，再在该行内找到具体的列
+    if (matchLine < 0) {
+        ensureLineIndexes();
+
+        int remaining = 0;
+        matchLine = direction > 0
+            ? m_bracketIndex.findForward(line + 1, depth, &remaining)
+            : m_bracketIndex.findBackward(line - 1, -depth, &remaining);
+        if (matchLine < 0)
+            return none;
+
+        matchText = m_document->getLine(matchLine);
+        columns = bracketColumns(matchText, m_tokens.tokens(matchLine));
+        depth = direction * remaining;
+
+        int i = direction > 0 ? 0 : columns.size() - 1;
+        for (; i >= 0 && i < columns.size(); i += direction) {
+            depth += bracketDelta(matchText.at(columns[i]));
+            if (depth == 0) {
+                matchColumn = columns[i];
+                break;
             }
-            else {
-                depth--;
-            }
-        }
-        else if (currentChar == closeBracket) {
-            if (searchForward) {
-                depth--;
-            }
-            else {
-                depth++;
-            }
-        }
-
-        if (depth == 0) {
-            return QPair<int, int>(position, searchPos);
         }
 
-        searchPos += searchForward ? 1 : -1;
+        if (matchColumn < 0)
+            return none;
     }
 
-    return QPair<int, int>(-1, -1);
+    if (matchText.at(matchColumn) != counterpartBracket(bracket))
+        return none;
+
+    return QPair<int, int>(position, m_document->lineColumnToPosition(matchLine, matchColumn));
 }
 
 QList<QPair<int, int>> SyntaxHighlighter::getCodeFoldingRanges(const QString& text) const
@@ -681,10 +952,130 @@ QList<QPair<int, int>> SyntaxHighlighter::getCodeFoldingRanges(const QString& te
     return ranges;
 }
 
+int SyntaxHighlighter::foldingEnd(int line)
+{
+    if (line < 0 || line >= m_lines.size() || !m_lines[line].lexed)
+        return -1;
+
+    ensureLineIndexes();
+    const LineEntry& entry = m_lines[line];
+    int end = -1;
+
+    if (m_currentLanguage.foldingByIndentation) {
+        if (entry.indent == IndentIndex::BLANK)
+            return -1;
+
+        // 下一个缩进不更深的行之前都属于本块，块末尾的空白行留在外面
+        int next = m_indentIndex.findNextAtMost(line + 1, entry.indent);
+        end = (next < 0 ? static_cast<int>(m_lines.size()) : next) - 1;
+        while (end > line && m_lines[end].indent == IndentIndex::BLANK) {
+            end--;
+        }
+    }
+    else {
+        // 行尾仍未配对的开括号，其中最外层的配对所在行保持可见
+        if (entry.brackets.maxSuffix <= 0)
+            return -1;
+
+        int remaining = 0;
+        int matchLine = m_bracketIndex.findForward(line + 1, entry.brackets.maxSuffix, &remaining);
+        if (matchLine < 0)
+            return -1;
+        end = matchLine - 1;
+    }
+
+    return end > line ? end : -1;
+}
+
+QList<QPair<int, int>> SyntaxHighlighter::foldingRanges(int firstLine, int lastLine)
+{
+    QList<QPair<int, int>> ranges;
+
+    firstLine = qMax(0, firstLine);
+    lastLine = qMin(lastLine, static_cast<int>(m_lines.size()) - 1);
+    for (int line = firstLine; line <= lastLine; ++line) {
+        int end = foldingEnd(line);
+        if (end > line) {
+            ranges.append(QPair<int, int>(line, end));
+        }
+    }
+
+    return ranges;
+}
+
+// ==============================================================================
+// 语义 token
+// ==============================================================================
+
+void SyntaxHighlighter::setSemanticTokens(const QList<Token>& tokens, const QList<int>& lineTokenCounts)
+{
+    const int lineCount = static_cast<int>(m_lines.size());
+    if (lineCount == 0)
+        return;
+
+    if (!hasSemanticTokens()) {
+        m_semanticTokens.reset(lineCount);
+    }
+
+    auto sameTokens = [](const QList<Token>& previous, const Token* current, int count) {
+        if (previous.size() != count)
+            return false;
+        for (int i = 0; i < count; ++i) {
+            if (previous[i].position != current[i].position || previous[i].length != current[i].length ||
+                previous[i].type != current[i].type)
+                return false;
+        }
+        return true;
+    };
+
+    // 逐行比较，只重绘语义 token 有变化的行
+    int firstChanged = -1;
+    int lastChanged = -1;
+    qsizetype offset = 0;
+
+    for (int line = 0; line < lineCount; ++line) {
+        int count = line < lineTokenCounts.size() ? lineTokenCounts[line] : 0;
+        count = static_cast<int>(qBound<qsizetype>(0, count, tokens.size() - offset));
+        const Token* lineTokens = tokens.constData() + offset;
+        offset += count;
+
+        if (count == 0 && m_semanticTokens.recordCount(line) == 0)
+            continue;
+        if (sameTokens(m_semanticTokens.tokens(line), lineTokens, count))
+            continue;
+
+        m_semanticTokens.setTokens(line, lineTokens, count);
+
+        if (firstChanged < 0) {
+            firstChanged = line;
+        }
+        lastChanged = line;
+    }
+
+    if (firstChanged >= 0) {
+        emit highlightingUpdated(firstChanged, lastChanged);
+    }
+}
+
+void SyntaxHighlighter::clearSemanticTokens()
+{
+    if (!hasSemanticTokens())
+        return;
+
+    m_semanticTokens.clear();
+    emit highlightingUpdated(0, -1);
+}
+
 QString SyntaxHighlighter::getDebugInfo() const
 {
     QStringList info;
 
+    quint64 windowLexCount = 0;
+    {
+        QMutexLocker locker(&m_paintRequestMutex);
+        windowLexCount = m_paintRequests.windowLexCount;
+    }
+
     info << "SyntaxHighlighter Debug Info:";
     info << QString("  Current language: %1").arg(m_currentLanguage.name);
     info << QString("  Available languages: %1").arg(availableLanguages().join(", "));
@@ -696,7 +1087,23 @@ QString SyntaxHighlighter::getDebugInfo() const
         .arg(m_currentLanguage.multiLineCommentStart)
         .arg(m_currentLanguage.multiLineCommentEnd);
     info << QString("  String delimiters: %1").arg(m_currentLanguage.stringDelimiters.join(", "));
-    info << QString("  Cached line tokens: %1").arg(m_lineTokens.size());
+    if (m_lexer) {
+        info << QString("  Keyword table: %1 words, %2 slots, %3 buckets")
+            .arg(m_lexer->keywordCount())
+            .arg(m_lexer->keywordTableSize())
+            .arg(m_lexer->keywordBucketCount());
+    }
+    info << QString("  Cached lines: %1 (valid: %2)").arg(m_lines.size()).arg(m_validLines);
+    info << QString("  Lines lexed: %1").arg(m_lexedLineCount);
+    info << QString("  Semantic tokens: %1").arg(m_semanticTokens.tokenCount());
+    info << QString("  Long line threshold: %1 (window lexes: %2)")
+        .arg(m_longLineThreshold)
+        .arg(windowLexCount);
+    info << QString("  Tokens: %1 in %2 chunks (%3 KB)")
+        .arg(m_tokens.tokenCount())
+        .arg(m_tokens.chunkCount())
+        .arg(m_tokens.memoryUsage() / 1024);
+    info << QString("  Pending lines: %1").arg(pendingLineCount());
 
     return info.join("\n");
 }
@@ -705,222 +1112,155 @@ QString SyntaxHighlighter::getDebugInfo() const
 // 私有辅助方法
 // ==============================================================================
 
-void SyntaxHighlighter::loadBuiltinLanguages()
-{
-    // C++ 语言定义
-    LanguageDefinition cpp;
-    cpp.name = "cpp";
-    cpp.fileExtensions = QStringList{ "cpp", "cxx", "cc", "c", "h", "hpp", "hxx" };
-    cpp.keywords = QStringList{
-        "auto", "break", "case", "catch", "class", "const", "continue", "default",
-        "delete", "do", "else", "enum", "explicit", "extern", "false", "for",
-        "friend", "goto", "if", "inline", "namespace", "new", "nullptr", "operator",
-        "private", "protected", "public", "return", "sizeof", "static", "struct",
-        "switch", "template", "this", "throw", "true", "try", "typedef", "typename",
-        "union", "using", "virtual", "void", "volatile", "while"
-    };
-    cpp.types = QStringList{
-        "bool", "char", "double", "float", "int", "long", "short", "signed",
-        "unsigned", "wchar_t", "char16_t", "char32_t", "size_t", "ptrdiff_t",
-        "string", "vector", "map", "set", "list", "queue", "stack", "pair"
-    };
-    cpp.functions = QStringList{
-        "printf", "scanf", "malloc", "free", "sizeof", "strlen", "strcpy", "strcmp",
-        "std", "cout", "cin", "endl", "cerr", "clog"
-    };
-    cpp.singleLineComment = "//";
-    cpp.multiLineCommentStart = "/*";
-    cpp.multiLineCommentEnd = "*/";
-    cpp.stringDelimiters = QStringList{ "\"", "'" };
-    cpp.escapeCharacter = "\\";
-    registerLanguage(cpp);
-
-    // JavaScript 语言定义
-    LanguageDefinition js;
-    js.name = "javascript";
-    js.fileExtensions = QStringList{ "js", "jsx", "ts", "tsx" };
-    js.keywords = QStringList{
-        "abstract", "arguments", "boolean", "break", "byte", "case", "catch", "char",
-        "class", "const", "continue", "debugger", "default", "delete", "do", "double",
-        "else", "enum", "eval", "export", "extends", "false", "final", "finally",
-        "float", "for", "function", "goto", "if", "implements", "import", "in",
-        "instanceof", "int", "interface", "let", "long", "native", "new", "null",
-        "package", "private", "protected", "public", "return", "short", "static",
-        "super", "switch", "synchronized", "this", "throw", "throws", "transient",
-        "true", "try", "typeof", "var", "void", "volatile", "while", "with", "yield"
-    };
-    js.types = QStringList{
-        "Array", "Boolean", "Date", "Error", "Function", "Number", "Object",
-        "RegExp", "String", "undefined", "null"
-    };
-    js.functions = QStringList{
-        "console", "log", "alert", "confirm", "prompt", "setTimeout", "setInterval",
-        "parseInt", "parseFloat", "isNaN", "isFinite"
-    };
-    js.singleLineComment = "//";
-    js.multiLineCommentStart = "/*";
-    js.multiLineCommentEnd = "*/";
-    js.stringDelimiters = QStringList{ "\"", "'", "`" };
-    js.escapeCharacter = "\\";
-    registerLanguage(js);
-
-    // Python 语言定义
-    LanguageDefinition python;
-    python.name = "python";
-    python.fileExtensions = QStringList{ "py", "pyw", "pyx" };
-    python.keywords = QStringList{
-        "False", "None", "True", "and", "as", "assert", "break", "class", "continue",
-        "def", "del", "elif", "else", "except", "finally", "for", "from", "global",
-        "if", "import", "in", "is", "lambda", "nonlocal", "not", "or", "pass",
-        "raise", "return", "try", "while", "with", "yield"
-    };
-    python.types = QStringList{
-        "int", "float", "str", "bool", "list", "tuple", "dict", "set", "frozenset",
-        "bytes", "bytearray", "memoryview", "complex"
-    };
-    python.functions = QStringList{
-        "print", "input", "len", "range", "enumerate", "zip", "map", "filter",
-        "sorted", "reversed", "sum", "min", "max", "abs", "round", "type", "isinstance"
-    };
-    python.singleLineComment = "#";
-    python.multiLineCommentStart = "\"\"\"";
-    python.multiLineCommentEnd = "\"\"\"";
-    python.stringDelimiters = QStringList{ "\"", "'", "\"\"\"", "'''" };
-    python.escapeCharacter = "\\";
-    registerLanguage(python);
-
-    // HTML 语言定义
-    LanguageDefinition html;
-    html.name = "html";
-    html.fileExtensions = QStringList{ "html", "htm", "xhtml" };
-    html.keywords = QStringList{
-        "a", "abbr", "address", "area", "article", "aside", "audio", "b", "base",
-        "bdi", "bdo", "blockquote", "body", "br", "button", "canvas", "caption",
-        "cite", "code", "col", "colgroup", "data", "datalist", "dd", "del", "details",
-        "dfn", "dialog", "div", "dl", "dt", "em", "embed", "fieldset", "figcaption",
-        "figure", "footer", "form", "h1", "h2", "h3", "h4", "h5", "h6", "head",
-        "header", "hr", "html", "i", "iframe", "img", "input", "ins", "kbd", "label",
-        "legend", "li", "link", "main", "map", "mark", "meta", "meter", "nav",
-        "noscript", "object", "ol", "optgroup", "option", "output", "p", "param",
-        "picture", "pre", "progress", "q", "rp", "rt", "ruby", "s", "samp", "script",
-        "section", "select", "small", "source", "span", "strong", "style", "sub",
-        "summary", "sup", "table", "tbody", "td", "template", "textarea", "tfoot",
-        "th", "thead", "time", "title", "tr", "track", "u", "ul", "var", "video", "wbr"
-    };
-    html.singleLineComment = "";
-    html.multiLineCommentStart = "<!--";
-    html.multiLineCommentEnd = "-->";
-    html.stringDelimiters = QStringList{ "\"", "'" };
-    html.escapeCharacter = "&";
-    registerLanguage(html);
-
-    // CSS 语言定义
-    LanguageDefinition css;
-    css.name = "css";
-    css.fileExtensions = QStringList{ "css", "scss", "sass", "less" };
-    css.keywords = QStringList{
-        "color", "background", "border", "margin", "padding", "width", "height",
-        "font", "text", "display", "position", "float", "clear", "overflow",
-        "visibility", "z-index", "top", "bottom", "left", "right", "line-height",
-        "letter-spacing", "word-spacing", "text-align", "text-decoration",
-        "text-transform", "white-space", "vertical-align", "list-style"
-    };
-    css.singleLineComment = "//";
-    css.multiLineCommentStart = "/*";
-    css.multiLineCommentEnd = "*/";
-    css.stringDelimiters = QStringList{ "\"", "'" };
-    css.escapeCharacter = "\\";
-    registerLanguage(css);
-
-    // JSON 语言定义
-    LanguageDefinition json;
-    json.name = "json";
-    json.fileExtensions = QStringList{ "json" };
-    json.keywords = QStringList{ "true", "false", "null" };
-    json.singleLineComment = "";
-    json.multiLineCommentStart = "";
-    json.multiLineCommentEnd = "";
-    json.stringDelimiters = QStringList{ "\"" };
-    json.escapeCharacter = "\\";
-    registerLanguage(json);
-
-    // Markdown 语言定义
-    LanguageDefinition markdown;
-    markdown.name = "markdown";
-    markdown.fileExtensions = QStringList{ "md", "markdown", "mdown", "mkd" };
-    markdown.keywords = QStringList{}; // Markdown 没有传统意义的关键字
-    markdown.singleLineComment = "";
-    markdown.multiLineCommentStart = "";
-    markdown.multiLineCommentEnd = "";
-    markdown.stringDelimiters = QStringList{ "`", "```" };
-    markdown.escapeCharacter = "\\";
-    registerLanguage(markdown);
-
-    // 纯文本语言定义
-    LanguageDefinition text;
-    text.name = "text";
-    text.fileExtensions = QStringList{ "txt", "text", "log" };
-    text.keywords = QStringList{};
-    text.singleLineComment = "";
-    text.multiLineCommentStart = "";
-    text.multiLineCommentEnd = "";
-    text.stringDelimiters = QStringList{};
-    text.escapeCharacter = "";
-    registerLanguage(text);
-}
-
-bool SyntaxHighlighter::isInsideMultiLineComment(int position, const QString& text) const
-{
-    Q_UNUSED(position)
-        Q_UNUSED(text)
-        // 简化实现，在实际应用中需要更复杂的状态跟踪
-        return false;
+void SyntaxHighlighter::updateLineIndexes(int line)
+{
+    // 索引待重建时不必逐行更新
+    if (!m_lineIndexesDirty) {
+        m_bracketIndex.update(line, m_lines[line].brackets);
+        m_indentIndex.update(line, m_lines[line].indent);
+    }
 }
 
-bool SyntaxHighlighter::isInsideString(int position, const QString& text) const
+void SyntaxHighlighter::ensureLineIndexes()
 {
-    Q_UNUSED(position)
-        Q_UNUSED(text)
-        // 简化实现，在实际应用中需要更复杂的状态跟踪
-        return false;
+    if (!m_lineIndexesDirty)
+        return;
+
+    QList<BracketBalance> balances;
+    QList<qint32> indents;
+    balances.reserve(m_lines.size());
+    indents.reserve(m_lines.size());
+    for (const LineEntry& entry : std::as_const(m_lines)) {
+        balances.append(entry.brackets);
+        indents.append(entry.indent);
+    }
+
+    m_bracketIndex.build(balances);
+    m_indentIndex.build(indents);
+    m_lineIndexesDirty = false;
 }
 
-TokenType SyntaxHighlighter::classifyToken(const QString& token) const
+QList<int> SyntaxHighlighter::bracketColumns(const QString& line, const QList<Token>& tokens)
 {
-    if (m_currentLanguage.keywords.contains(token)) {
-        return TokenType::Keyword;
+    // 括号只会是单字符运算符，字符串和注释整体是一个 token，其中的括号不会出现在这里
+    QList<int> columns;
+    for (const Token& token : tokens) {
+        if (token.type == TokenType::Operator && token.length == 1 &&
+            token.position < line.length() && bracketDelta(line.at(token.position)) != 0) {
+            columns.append(token.position);
+        }
     }
+    return columns;
+}
 
-    if (m_currentLanguage.types.contains(token)) {
-        return TokenType::Type;
+BracketBalance SyntaxHighlighter::bracketBalance(const QString& line, const QList<Token>& tokens)
+{
+    BracketBalance balance;
+    for (int column : bracketColumns(line, tokens)) {
+        balance.sum += bracketDelta(line.at(column));
+        balance.minPrefix = qMin(balance.minPrefix, balance.sum);
     }
 
-    if (m_currentLanguage.functions.contains(token)) {
-        return TokenType::Function;
+    // 每个后缀和都是总和减去对应的前缀和，最大后缀和即总和减去最小前缀和
+    balance.maxSuffix = balance.sum - balance.minPrefix;
+    return balance;
+}
+
+qint32 SyntaxHighlighter::lineIndentation(const QString& line)
+{
+    // 制表符按 4 列对齐；只有空白的行不参与缩进比较
+    qint32 indent = 0;
+    for (QChar ch : line) {
+        if (ch == ' ') {
+            indent++;
+        }
+        else if (ch == '\t') {
+            indent += 4 - indent % 4;
+        }
+        else {
+            return indent;
+        }
     }
+    return IndentIndex::BLANK;
+}
 
-    // 检查是否为预处理指令
-    if (token.startsWith('#')) {
-        return TokenType::Preprocessor;
+int SyntaxHighlighter::bracketDelta(QChar ch)
+{
+    switch (ch.unicode()) {
+    case '(':
+    case '[':
+    case '{':
+        return 1;
+    case ')':
+    case ']':
+    case '}':
+        return -1;
+    default:
+        return 0;
     }
+}
 
-    return TokenType::Identifier;
+QChar SyntaxHighlighter::counterpartBracket(QChar ch)
+{
+    switch (ch.unicode()) {
+    case '(': return ')';
+    case ')': return '(';
+    case '[': return ']';
+    case ']': return '[';
+    case '{': return '}';
+    case '}': return '{';
+    default: return QChar();
+    }
 }
 
-bool SyntaxHighlighter::isOperator(const QString& op) const
+QList<Token> SyntaxHighlighter::mergeTokens(const QList<Token>& base, const QList<Token>& overlay)
 {
-    static const QStringList operators = {
-        // 三字符运算符
-        "<<<", ">>>", "<<=", ">>=", "...",
+    if (overlay.isEmpty())
+        return base;
+    if (base.isEmpty())
+        return overlay;
 
-        // 双字符运算符
-        "++", "--", "==", "!=", "<=", ">=", "&&", "||", "<<", ">>",
-        "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "->", "::",
+    QList<Token> result;
+    result.reserve(base.size() + overlay.size());
 
-        // 单字符运算符
-        "+", "-", "*", "/", "%", "=", "<", ">", "!", "&", "|", "^",
-        "~", "?", ":", ";", ",", ".", "(", ")", "[", "]", "{", "}"
-    };
+    // covered 之前的列都已输出；base 的 token 在下一个 overlay token 开始处截断，被覆盖的部分跳过
+    int covered = 0;
+    int i = 0;
+    int j = 0;
+
+    while (i < base.size() || j < overlay.size()) {
+        const int nextOverlay = j < overlay.size()
+            ? qMax(overlay[j].position, covered) : std::numeric_limits<int>::max();
+
+        if (i < base.size()) {
+            const Token& token = base[i];
+            const int start = qMax(token.position, covered);
+            const int end = token.position + token.length;
+
+            if (start >= end) {
+                i++;
+                continue;
+            }
 
-    return operators.contains(op);
-}
\ No newline at end of file
+            if (start < nextOverlay) {
+                const int stop = qMin(end, nextOverlay);
+                result.append(Token(start, stop - start, token.type));
+                covered = stop;
+                if (stop == end) {
+                    i++;
+                }
+                continue;
+            }
+        }
+
+        const Token& token = overlay[j++];
+        const int start = qMax(token.position, covered);
+        const int end = token.position + token.length;
+        if (start < end) {
+            result.append(Token(start, end - start, token.type));
+            covered = end;
+        }
+    }
+
+    return result;
+}
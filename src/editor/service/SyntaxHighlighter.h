@@ -9,7 +9,18 @@
 #include <QColor>
 #include <QStringList>
 #include <QPair>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QMutex>
+#include <array>
+#include <memory>
 #include "TokenTypes.h"
+#include "CompiledLexer.h"
+#include "BracketIndex.h"
+#include "IndentIndex.h"
+#include "TokenStore.h"
+
+class DocumentModel;
 
 struct HighlightRule {
     QRegularExpression pattern;
@@ -34,10 +45,15 @@ public:
     QString singleLineComment;
     QString multiLineCommentStart;
     QString multiLineCommentEnd;
+    bool nestedComments = false;    // 块注释可以嵌套（按层数匹配结束符）
 
     // 字符串规则
     QStringList stringDelimiters;
+    QStringList multiLineStringDelimiters;  // 未闭合时延续到下一行的定界符
     QString escapeCharacter;
+
+    // 代码折叠按缩进划分（否则按括号）
+    bool foldingByIndentation = false;
 };
 
 // 增量语法高亮器
@@ -46,6 +62,7 @@ class SyntaxHighlighter : public QObject {
 
 public:
     explicit SyntaxHighlighter(QObject* parent = nullptr);
+    ~SyntaxHighlighter();
 
     // 语言管理
     void registerLanguage(const LanguageDefinition& language);
@@ -54,19 +71,50 @@ public:
     LanguageDefinition currentLanguage() const;
     QStringList availableLanguages() const;
 
+    // 关联的文档：按行缓存 token 和行尾状态，在后台线程中按视口优先的顺序分析
+    void setDocument(DocumentModel* document);
+    DocumentModel* document() const { return m_document; }
+
     // 高亮处理
     QList<Token> tokenize(const QString& text) const;
-    QList<Token> tokenizeLine(const QString& line, int lineNumber,
-        const QList<Token>& previousLineTokens = QList<Token>()) const;
+    QList<Token> tokenizeLine(const QString& line, const LexerState& startState = LexerState(),
+        LexerState* endState = nullptr) const;
+    // 返回该行最近一次分析的 token（尚未分析时为空，按纯文本绘制），
+    // 结果过期或缺失时请求后台分析，完成后通过 highlightingUpdated 通知。
+    // 绘制时调用：场景图渲染线程上也只读取缓存，请求经排队调用交回高亮器所属的线程
+    QList<Token> lineTokens(int lineNumber) const;
+    // 只取与 [firstColumn, lastColumn) 相交的 token（行内列号），lineText 为该行文本。
+    // lexWindow 为 true 时，尚未分析的超长行只分析这一段，后台分析完整行后通过 highlightingUpdated 重绘；
+    // 已分析的行中超出 TokenStore::MAX_START 的列不在存储中，始终这样按窗口分析。
+    // 窗口分析以行首状态为起点，窗口从字符串或注释中间开始时着色是错的，只是近似
+    QList<Token> lineTokens(int lineNumber, const QString& lineText, int firstColumn, int lastColumn,
+        bool lexWindow) const;
+    int pendingLineCount() const;
 
-    // 增量更新
-    void updateHighlighting(const QString& text, int changedPosition,
-        int removedLength, int addedLength);
+    // 超长行：超过该长度的行（压缩后的脚本、单行的大 JSON 等）编辑时不同步分析，
+    // 绘制时只处理横向可见的一段，整行交给后台
+    static constexpr int DEFAULT_LONG_LINE_LENGTH = 10000;
+    int longLineThreshold() const { return m_longLineThreshold; }
+    void setLongLineThreshold(int length);
+
+    // 增量更新：文档中 startLine 起的 removedLines + 1 行被替换为 addedLines + 1 行。
+    // 同步重新分析编辑行，并向后继续到某行的开始状态与缓存一致为止（有上限，
+    // 其余交给后台）；受影响的行范围通过 highlightingUpdated 发出
+    void updateHighlighting(int startLine, int removedLines, int addedLines);
 
     // 格式获取
     QTextCharFormat getFormat(TokenType type) const;
     void setFormat(TokenType type, const QTextCharFormat& format);
 
+    // 绘制用的样式：由 getFormat 解析出的颜色和粗体，按 TokenType 下标存放，
+    // 只在语言、格式或主题变化时重建，绘制时不再查表和复制格式
+    struct TokenStyle {
+        QColor color;
+        bool hasColor = false;   // 格式没有前景色时使用编辑器的文本颜色
+        bool bold = false;
+    };
+    const TokenStyle& tokenStyle(TokenType type) const { return m_palette[static_cast<int>(type)]; }
+
     // 主题支持
     void applyTheme(const QString& themeName);
     void setCustomTheme(const QHash<TokenType, QTextCharFormat>& theme);
@@ -74,24 +122,140 @@ public:
     // 高级功能
     Token getTokenAtPosition(const QString& text, int position) const;
     QPair<int, int> findMatchingBracket(const QString& text, int position) const;
+    // 文档中 position 处括号的配对位置，基于行缓存和括号配对索引（跨行查找 O(log n)）。
+    // 字符串和注释中的括号、类型不符的配对返回 (-1, -1)；尚未分析的行按没有括号处理
+    QPair<int, int> findMatchingBracket(int position);
+    // 整段文本中顶层大括号的字符范围，每次调用都扫描全文；关联文档时使用下面基于行缓存的接口
     QList<QPair<int, int>> getCodeFoldingRanges(const QString& text) const;
+    // 以 line 为标题行折叠时隐藏的最后一行，不能折叠时返回 -1。O(log n)：
+    // 按括号折叠时隐藏到行尾未配对开括号的配对行之前；按缩进折叠时隐藏其后缩进更深的行（不含末尾的空白行）。
+    // 尚未分析的行按没有括号、空白行处理
+    int foldingEnd(int line);
+    // [firstLine, lastLine] 内可折叠的行：(标题行, 隐藏的最后一行)
+    QList<QPair<int, int>> foldingRanges(int firstLine, int lastLine);
+
+    // 语义 token 叠加层：外部分析器（SemanticTokenClient）给出的 token 在取行 token 时
+    // 覆盖词法 token 的对应范围。按行保存，编辑后与行缓存一起随行号移动；
+    // 编辑行上的语义 token 丢弃，回退到词法 token，直到下一次结果到达。
+    // tokens 为各行 token 依次连续存放，lineTokenCounts[i] 为第 i 行的 token 数
+    void setSemanticTokens(const QList<Token>& tokens, const QList<int>& lineTokenCounts);
+    void clearSemanticTokens();
+    bool hasSemanticTokens() const { return m_semanticTokens.lineCount() > 0; }
+
     QString getDebugInfo() const;
 
 signals:
-    void highlightingUpdated(int startLine, int endLine, const QList<Token>& tokens);
+    // startLine 到 endLine 的 token 已更新（endLine 为 -1 表示之后所有行），通过 lineTokens() 重新读取
+    void highlightingUpdated(int startLine, int endLine);
     void languageChanged(const QString& languageName);
 
 private:
     LanguageDefinition m_currentLanguage;
-    QHash<QString, LanguageDefinition> m_languages;
-    QHash<int, QList<Token>> m_lineTokens; // 缓存每行的tokens
-
-    // 私有辅助方法
-    void loadBuiltinLanguages();
-    bool isInsideMultiLineComment(int position, const QString& text) const;
-    bool isInsideString(int position, const QString& text) const;
-    TokenType classifyToken(const QString& token) const;
-    bool isOperator(const QString& op) const;
+    std::array<TokenStyle, TOKEN_TYPE_COUNT> m_palette;
+
+    void rebuildPalette();
+
+    // 当前语言编译好的词法分析器，只读，来自 LanguageRegistry，与其他高亮器和后台分析任务共享
+    std::shared_ptr<const CompiledLexer> m_lexer;
+
+    // 行缓存：[0, m_validLines) 内每行的开始状态都等于上一行的结束状态，可直接使用；
+    // 之后的条目保留上次的分析结果，开始状态仍然一致时无需重新分析。
+    // 各行的 token 不放在条目里，而是与条目按行对应地保存在 m_tokens 的紧凑存储中
+    struct LineEntry {
+        LexerState startState;
+        LexerState endState;
+        BracketBalance brackets;
+        qint32 indent = IndentIndex::BLANK;
+        bool lexed = false;
+    };
+
+    static constexpr int MAX_EAGER_RELEX_LINES = 64;   // 编辑时同步重新分析的行数上限
+
+    DocumentModel* m_document = nullptr;
+    QList<LineEntry> m_lines;
+    TokenStore m_tokens;
+    TokenStore m_semanticTokens;   // 没有语义 token 时为空（0 行）
+    int m_validLines = 0;
+    quint64 m_lexedLineCount = 0;
+    int m_longLineThreshold = DEFAULT_LONG_LINE_LENGTH;
+
+    // 后台分析：每轮提交绘制请求过的行（以前一行最近的结束状态为假定起点，
+    // 连同下方若干行）和从有效前缀开始的一批行（起点可靠）。
+    // 假定起点正确的行在前沿到达时只需比较状态；文档或语言变化时旧结果被丢弃
+    static constexpr int FRONTIER_BATCH_LINES = 4096;
+    static constexpr qsizetype JOB_CHARACTER_BUDGET = 1024 * 1024;   // 每个任务的字符数上限，超长行单独成批
+    static constexpr int VIEWPORT_LOOKAHEAD_LINES = 256;
+
+    struct HighlightJob {
+        quint64 generation = 0;
+        std::shared_ptr<const CompiledLexer> lexer;
+        int firstLine = 0;
+        LexerState startState;
+        QStringList lines;
+    };
+
+    struct HighlightResult {
+        quint64 generation = 0;
+        int firstLine = 0;
+        QList<LineEntry> entries;
+        // 各行的 token 依次连续存放，tokenCounts[i] 为第 i 个条目的 token 数
+        QList<Token> tokens;
+        QList<int> tokenCounts;
+    };
+
+    QFutureWatcher<HighlightResult>* m_highlightWatcher = nullptr;
+    QTimer m_highlightTimer;
+    quint64 m_highlightGeneration = 0;
+    int m_requestedFirstLine = -1;
+    int m_requestedLastLine = -1;
+
+    // 绘制时记下的请求：绘制可能在场景图渲染线程进行，不能改动行缓存或启动定时器，
+    // 只在这里登记，并排队一次 applyPaintRequests 回到所属线程合并到请求范围
+    struct PaintRequests {
+        int firstLine = -1;
+        int lastLine = -1;
+        int repaintFirstLine = -1;  // 本帧预算用完、跳过了窗口分析的已分析行，之后需要重绘
+        int repaintLastLine = -1;
+        bool resync = false;        // 文档行数与行缓存不一致，需要整体重建
+        bool posted = false;
+        quint64 windowLexCount = 0;
+    };
+    mutable QMutex m_paintRequestMutex;
+    mutable PaintRequests m_paintRequests;
+
+    // 括号配对索引和缩进索引：与行缓存一一对应，单行重新分析时就地更新，行数变化后在下次查询时重建
+    BracketIndex m_bracketIndex;
+    IndentIndex m_indentIndex;
+    bool m_lineIndexesDirty = true;
+
+    // 行缓存
+    void resetCache();
+    bool isLineCurrent(int line) const;
+    bool lexLine(int line);
+    void requestLine(int line) const;
+    QList<Token> windowTokens(int lineNumber, const QString& lineText, int firstColumn, int lastColumn) const;
+    void postPaintRequest(int line, bool resync) const;
+    void postRepaint(int line) const;
+    void queuePaintRequests() const;
+    void applyPaintRequests();
+    void advanceValidLines();
+    void updateLineIndexes(int line);
+    void ensureLineIndexes();
+
+    void scheduleHighlightPass();
+    void startHighlightPass();
+    void onHighlightResultReady(int index);
+    void onHighlightPassFinished();
+
+    // 纯函数，可在工作线程中调用
+    static HighlightResult runHighlightJob(const HighlightJob& job);
+    static QList<int> bracketColumns(const QString& line, const QList<Token>& tokens);
+    static BracketBalance bracketBalance(const QString& line, const QList<Token>& tokens);
+    static int bracketDelta(QChar ch);
+    static qint32 lineIndentation(const QString& line);
+    static QChar counterpartBracket(QChar ch);
+    // 两组各自按起始列有序的 token 合并，overlay 覆盖的范围内丢弃 base 的部分
+    static QList<Token> mergeTokens(const QList<Token>& base, const QList<Token>& overlay);
 };
 
 #endif // SYNTAX_HIGHLIGHTER_H
\ No newline at end of file
@@ -0,0 +1,400 @@
+#include "TokenStore.h"
+#include <QDebug>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+// 依次给出一行 token 的各条记录：过长的 token 按 MAX_LENGTH 拆开，起始列超出范围的丢弃。
+// 计算记录数和编码共用同一遍历，两者始终一致
+template <typename Emit>
+void forEachRecord(const Token* tokens, int count, Emit emit)
+{
+    for (int i = 0; i < count; ++i) {
+        int start = tokens[i].position;
+        int remaining = tokens[i].length;
+
+        while (remaining > 0 && start >= 0 && start <= TokenStore::MAX_START) {
+            int length = qMin(remaining, TokenStore::MAX_LENGTH);
+            emit(start, length, tokens[i].type);
+            start += length;
+            remaining -= length;
+        }
+    }
+}
+}
+
+// ==============================================================================
+// 结构操作
+// ==============================================================================
+
+void TokenStore::reset(int lineCount)
+{
+    m_chunks.clear();
+    m_lineCount = qMax(0, lineCount);
+
+    int remaining = m_lineCount;
+    m_chunks.reserve(static_cast<size_t>((remaining + CHUNK_LINES - 1) / CHUNK_LINES));
+    while (remaining > 0) {
+        int count = qMin(remaining, CHUNK_LINES);
+        m_chunks.push_back(makeChunk(count));
+        remaining -= count;
+    }
+
+    m_indexDirty = true;
+}
+
+void TokenStore::clear()
+{
+    m_chunks.clear();
+    m_lineCount = 0;
+    m_indexDirty = true;
+}
+
+void TokenStore::insertLines(int line, int count)
+{
+    if (count <= 0)
+        return;
+
+    if (m_chunks.empty()) {
+        reset(count);
+        return;
+    }
+
+    line = qBound(0, line, m_lineCount);
+
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    Chunk& chunk = m_chunks[chunkIndex];
+
+    // 新行没有 token：起止下标都等于插入位置原来那一行的起始下标
+    chunk.offsets.insert(chunk.offsets.begin() + offset, count, chunk.offsets[offset]);
+    chunk.count += count;
+    m_lineCount += count;
+
+    if (chunk.count > CHUNK_CAPACITY) {
+        splitChunk(chunkIndex);
+        m_indexDirty = true;
+    }
+    else if (!m_indexDirty) {
+        m_lineIndex.add(chunkIndex, count);
+    }
+}
+
+void TokenStore::removeLines(int line, int count)
+{
+    if (count <= 0 || line < 0 || line >= m_lineCount)
+        return;
+
+    count = qMin(count, m_lineCount - line);
+
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    int firstChunk = chunkIndex;
+
+    // 顺序处理受影响的块，不再逐块重新定位
+    int remaining = count;
+    while (remaining > 0 && chunkIndex < static_cast<int>(m_chunks.size())) {
+        Chunk& chunk = m_chunks[chunkIndex];
+        int removed = qMin(remaining, chunk.count - offset);
+
+        quint32 begin = chunk.offsets[offset];
+        quint32 end = chunk.offsets[offset + removed];
+        chunk.tokens.erase(chunk.tokens.begin() + begin, chunk.tokens.begin() + end);
+        chunk.offsets.erase(chunk.offsets.begin() + offset, chunk.offsets.begin() + offset + removed);
+        for (size_t i = offset; i < chunk.offsets.size(); ++i) {
+            chunk.offsets[i] -= end - begin;
+        }
+
+        chunk.count -= removed;
+        remaining -= removed;
+        m_lineCount -= removed;
+
+        if (chunk.count == 0) {
+            m_chunks.erase(m_chunks.begin() + chunkIndex);
+        }
+        else {
+            chunkIndex++;
+        }
+
+        offset = 0;
+    }
+
+    mergeSmallChunks(qMax(0, firstChunk - 1));
+    m_indexDirty = true;
+}
+
+// ==============================================================================
+// 单行访问
+// ==============================================================================
+
+void TokenStore::setTokens(int line, const Token* tokens, int count)
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0 || line >= m_lineCount)
+        return;
+
+    Chunk& chunk = m_chunks[chunkIndex];
+
+    int records = 0;
+    forEachRecord(tokens, count, [&](int, int, TokenType) { records++; });
+
+    // 先把该行的区间调整到新的记录数，再原地编码，不经过临时数组
+    const quint32 begin = chunk.offsets[offset];
+    const quint32 end = chunk.offsets[offset + 1];
+    const qint64 delta = records - static_cast<qint64>(end - begin);
+
+    if (delta > 0) {
+        chunk.tokens.insert(chunk.tokens.begin() + end, static_cast<size_t>(delta), PackedToken());
+    }
+    else if (delta < 0) {
+        chunk.tokens.erase(chunk.tokens.begin() + begin + records, chunk.tokens.begin() + end);
+    }
+
+    if (delta != 0) {
+        for (int i = offset + 1; i <= chunk.count; ++i) {
+            chunk.offsets[i] = static_cast<quint32>(chunk.offsets[i] + delta);
+        }
+    }
+
+    PackedToken* out = chunk.tokens.data() + begin;
+    forEachRecord(tokens, count, [&](int start, int length, TokenType type) {
+        out->startLow = static_cast<quint16>(start & 0xFFFF);
+        out->startHigh = static_cast<quint8>(start >> 16);
+        out->type = static_cast<quint8>(type);
+        out->length = static_cast<quint16>(length);
+        ++out;
+    });
+}
+
+void TokenStore::setTokens(int line, const QList<Token>& tokens)
+{
+    setTokens(line, tokens.constData(), static_cast<int>(tokens.size()));
+}
+
+QList<Token> TokenStore::tokens(int line) const
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0 || line >= m_lineCount)
+        return QList<Token>();
+
+    const Chunk& chunk = m_chunks[chunkIndex];
+    const PackedToken* records = chunk.tokens.data();
+    return decode(records + chunk.offsets[offset], records + chunk.offsets[offset + 1]);
+}
+
+QList<Token> TokenStore::tokens(int line, int firstColumn, int lastColumn) const
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0 || line >= m_lineCount || lastColumn <= firstColumn)
+        return QList<Token>();
+
+    // 一行内的记录按起始列升序且互不重叠，结束列同样有序
+    const Chunk& chunk = m_chunks[chunkIndex];
+    const PackedToken* records = chunk.tokens.data();
+    const PackedToken* begin = records + chunk.offsets[offset];
+    const PackedToken* end = records + chunk.offsets[offset + 1];
+
+    const PackedToken* first = std::partition_point(begin, end, [firstColumn](const PackedToken& packed) {
+        return recordStart(packed) + packed.length <= firstColumn;
+    });
+    const PackedToken* last = std::partition_point(first, end, [lastColumn](const PackedToken& packed) {
+        return recordStart(packed) < lastColumn;
+    });
+
+    return decode(first, last);
+}
+
+int TokenStore::recordCount(int line) const
+{
+    int offset = 0;
+    int chunkIndex = locate(line, &offset);
+    if (chunkIndex < 0 || line >= m_lineCount)
+        return 0;
+
+    const Chunk& chunk = m_chunks[chunkIndex];
+    return static_cast<int>(chunk.offsets[offset + 1] - chunk.offsets[offset]);
+}
+
+QList<Token> TokenStore::decode(const PackedToken* first, const PackedToken* last)
+{
+    QList<Token> result;
+    result.reserve(last - first);
+
+    int previousLength = 0;
+    for (const PackedToken* record = first; record != last; ++record) {
+        const PackedToken& packed = *record;
+        int start = recordStart(packed);
+        TokenType type = static_cast<TokenType>(packed.type);
+
+        // 写入时拆开的长 token：上一条记录满长度、类型相同且首尾相接
+        if (previousLength == MAX_LENGTH && !result.isEmpty()) {
+            Token& previous = result.last();
+            if (previous.type == type && previous.position + previous.length == start) {
+                previous.length += packed.length;
+                previousLength = packed.length;
+                continue;
+            }
+        }
+
+        result.append(Token(start, packed.length, type));
+        previousLength = packed.length;
+    }
+
+    return result;
+}
+
+// ==============================================================================
+// 调试
+// ==============================================================================
+
+qint64 TokenStore::tokenCount() const
+{
+    qint64 result = 0;
+    for (const Chunk& chunk : m_chunks) {
+        result += static_cast<qint64>(chunk.tokens.size());
+    }
+    return result;
+}
+
+qint64 TokenStore::memoryUsage() const
+{
+    qint64 result = static_cast<qint64>(m_chunks.capacity() * sizeof(Chunk));
+    for (const Chunk& chunk : m_chunks) {
+        result += static_cast<qint64>(chunk.offsets.capacity() * sizeof(quint32));
+        result += static_cast<qint64>(chunk.tokens.capacity() * sizeof(PackedToken));
+    }
+    return result;
+}
+
+bool TokenStore::validate() const
+{
+    int lines = 0;
+
+    for (const Chunk& chunk : m_chunks) {
+        if (chunk.count <= 0 || chunk.count > CHUNK_CAPACITY ||
+            chunk.offsets.size() != static_cast<size_t>(chunk.count) + 1) {
+            qWarning() << "TokenStore validation failed: invalid chunk size" << chunk.count;
+            return false;
+        }
+
+        if (chunk.offsets.front() != 0 || chunk.offsets.back() != chunk.tokens.size() ||
+            !std::is_sorted(chunk.offsets.begin(), chunk.offsets.end())) {
+            qWarning() << "TokenStore validation failed: invalid line offsets";
+            return false;
+        }
+
+        lines += chunk.count;
+    }
+
+    if (lines != m_lineCount) {
+        qWarning() << "TokenStore validation failed: line count mismatch";
+        return false;
+    }
+
+    return true;
+}
+
+// ==============================================================================
+// 私有辅助方法
+// ==============================================================================
+
+void TokenStore::ensureIndex() const
+{
+    if (!m_indexDirty)
+        return;
+
+    QList<int> lineCounts;
+    lineCounts.reserve(static_cast<qsizetype>(m_chunks.size()));
+    for (const Chunk& chunk : m_chunks) {
+        lineCounts.append(chunk.count);
+    }
+
+    m_lineIndex.build(lineCounts);
+    m_indexDirty = false;
+}
+
+int TokenStore::locate(int line, int* offset) const
+{
+    *offset = 0;
+    if (m_chunks.empty() || line < 0 || line > m_lineCount)
+        return -1;
+
+    ensureIndex();
+
+    // line == m_lineCount 时定位到最后一块的末尾，用于追加
+    int chunkIndex = m_lineIndex.findIndex(line);
+    *offset = line - m_lineIndex.prefixSum(chunkIndex);
+
+    if (line < m_lineCount && *offset >= m_chunks[chunkIndex].count)
+        return -1;
+
+    return chunkIndex;
+}
+
+void TokenStore::splitChunk(int chunkIndex)
+{
+    Chunk source = std::move(m_chunks[chunkIndex]);
+
+    // 按目标行数切开，每块的记录和下标从 0 开始
+    std::vector<Chunk> pieces;
+    for (int first = 0; first < source.count; first += CHUNK_LINES) {
+        int count = qMin(CHUNK_LINES, source.count - first);
+        quint32 base = source.offsets[first];
+
+        Chunk piece;
+        piece.count = count;
+        piece.offsets.reserve(count + 1);
+        for (int i = 0; i <= count; ++i) {
+            piece.offsets.push_back(source.offsets[first + i] - base);
+        }
+        piece.tokens.assign(source.tokens.begin() + base,
+            source.tokens.begin() + source.offsets[first + count]);
+
+        pieces.push_back(std::move(piece));
+    }
+
+    m_chunks.erase(m_chunks.begin() + chunkIndex);
+    m_chunks.insert(m_chunks.begin() + chunkIndex,
+        std::make_move_iterator(pieces.begin()), std::make_move_iterator(pieces.end()));
+}
+
+void TokenStore::mergeSmallChunks(int chunkIndex)
+{
+    // 检查删除位置附近的块，过小的块并入相邻块
+    int end = qMin(chunkIndex + 2, static_cast<int>(m_chunks.size()) - 1);
+
+    for (int i = end; i > chunkIndex && i > 0; --i) {
+        Chunk& previous = m_chunks[i - 1];
+        Chunk& current = m_chunks[i];
+
+        bool tooSmall = previous.count < CHUNK_LINES / 4 || current.count < CHUNK_LINES / 4;
+        if (!tooSmall || previous.count + current.count > CHUNK_CAPACITY)
+            continue;
+
+        quint32 base = static_cast<quint32>(previous.tokens.size());
+        previous.offsets.pop_back();
+        for (quint32 offset : current.offsets) {
+            previous.offsets.push_back(base + offset);
+        }
+        previous.tokens.insert(previous.tokens.end(), current.tokens.begin(), current.tokens.end());
+        previous.count += current.count;
+
+        m_chunks.erase(m_chunks.begin() + i);
+    }
+}
+
+int TokenStore::recordStart(const PackedToken& packed)
+{
+    return packed.startLow | (int(packed.startHigh) << 16);
+}
+
+TokenStore::Chunk TokenStore::makeChunk(int lineCount)
+{
+    Chunk chunk;
+    chunk.count = lineCount;
+    chunk.offsets.assign(static_cast<size_t>(lineCount) + 1, 0);
+    return chunk;
+}
@@ -0,0 +1,80 @@
+#ifndef TOKEN_STORE_H
+#define TOKEN_STORE_H
+
+#include "FenwickTree.h"
+#include "TokenTypes.h"
+#include <QList>
+#include <QtGlobal>
+#include <vector>
+
+// 按行保存的 token 存储
+// 行按块分组，每块的 token 以 6 字节的紧凑记录（起始列 24 位、长度 16 位、类型 8 位）
+// 连续存放在同一个数组中，另有每行的起始下标；块级行数由树状数组索引。
+// 插入或删除行只改动所在的块，之后各行的 token 随块整体移动，不需要按行号重新散列；
+// 读取一行只访问一块内连续的内存
+class TokenStore {
+public:
+    static constexpr int CHUNK_LINES = 256;             // 重新切分时每块的目标行数
+    static constexpr int CHUNK_CAPACITY = 2 * CHUNK_LINES;
+
+    // 起始列超过 24 位的 token 不保存（按纯文本绘制）；长度超过 16 位的拆成多条记录，读取时合并
+    static constexpr int MAX_START = (1 << 24) - 1;
+    static constexpr int MAX_LENGTH = 0xFFFF;
+
+    TokenStore() = default;
+
+    // 结构操作
+    void reset(int lineCount);
+    void clear();
+    void insertLines(int line, int count);
+    void removeLines(int line, int count);
+
+    int lineCount() const { return m_lineCount; }
+
+    // 替换一行的 token（按起始列升序）
+    void setTokens(int line, const Token* tokens, int count);
+    void setTokens(int line, const QList<Token>& tokens);
+    QList<Token> tokens(int line) const;
+    // 与 [firstColumn, lastColumn) 相交的 token，二分定位，超长行只解码这一段
+    QList<Token> tokens(int line, int firstColumn, int lastColumn) const;
+    int recordCount(int line) const;    // 该行的记录数（拆开的长 token 按多条计），不解码
+
+    // 调试
+    int chunkCount() const { return static_cast<int>(m_chunks.size()); }
+    qint64 tokenCount() const;
+    qint64 memoryUsage() const;
+    bool validate() const;
+
+private:
+    struct PackedToken {
+        quint16 startLow;
+        quint8 startHigh;
+        quint8 type;
+        quint16 length;
+    };
+    static_assert(sizeof(PackedToken) == 6, "PackedToken must stay 6 bytes");
+
+    struct Chunk {
+        int count = 0;
+        std::vector<quint32> offsets;       // count + 1 项，第 i 行的记录为 [offsets[i], offsets[i + 1])
+        std::vector<PackedToken> tokens;
+    };
+
+    std::vector<Chunk> m_chunks;
+    int m_lineCount = 0;
+
+    // 块级行数索引：结构变化后惰性重建
+    mutable FenwickTree<int> m_lineIndex;
+    mutable bool m_indexDirty = true;
+
+    void ensureIndex() const;
+    int locate(int line, int* offset) const;
+    void splitChunk(int chunkIndex);
+    void mergeSmallChunks(int chunkIndex);
+
+    static Chunk makeChunk(int lineCount);
+    static QList<Token> decode(const PackedToken* first, const PackedToken* last);
+    static int recordStart(const PackedToken& packed);
+};
+
+#endif // TOKEN_STORE_H
@@ -14,6 +14,8 @@ enum class TokenType {
     Preprocessor
 };
 
+constexpr int TOKEN_TYPE_COUNT = static_cast<int>(TokenType::Preprocessor) + 1;
+
 struct Token {
     int position = 0;
     int length = 0;